@@ -0,0 +1,131 @@
+/**
+ * Copyright (C) 2025, Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * This header file declares the pipelined execution of the frame analysis.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <glib.h>
+#include <mutex>
+#include <opencv2/core/mat.hpp>
+#include <thread>
+
+#include "Gauge.hpp"
+#include "ImageProvider.hpp"
+
+#define PIPELINE_FRAMES (3)
+
+/**
+ * brief A frame on its way through the analysis, with its results.
+ */
+struct PipelineFrame
+{
+    cv::Mat image;
+    cv::Rect crop;
+    GaugeParams params;
+    unsigned long generation;
+    bool skipped;
+    bool valid;
+    bool accepted;
+    double value;
+    double filtered;
+    double confidence;
+    double preprocess_avg_us;
+    Gauge::TrackingStats tracking_stats;
+};
+
+/**
+ * brief Three stage pipeline from VDO frame to published reading.
+ *
+ * The capture stage copies what the analysis needs out of the VDO buffer and
+ * returns the buffer at once, the analysis stage reads the gauge and the
+ * publish stage runs in the main loop. Each stage works on its own frame, so
+ * the capture of frame N+1, the analysis of frame N and the publishing of
+ * frame N-1 can run at the same time on different cores. The frames come from
+ * a fixed pool; when all of them are in use the capture stage waits, which
+ * lets the newest VDO frame replace older ones meanwhile.
+ */
+class AnalysisPipeline
+{
+  public:
+    struct Stats
+    {
+        unsigned long frames;   // Frames published
+        unsigned long captured; // Frames through the capture stage, including skipped ones
+        unsigned long analyzed; // Frames through the analysis stage
+        gint64 capture_us;      // Time spent in the capture stage
+        gint64 analyze_us;      // Time spent in the analysis stage
+        gint64 publish_us;      // Time spent in the publish stage
+        gint64 running_us;      // Time since start
+        unsigned long stalls;   // Times the capture stage waited for a free frame
+    };
+
+    AnalysisPipeline(
+        ImageProvider &provider,
+        void (*Capture)(VdoBuffer &, PipelineFrame &),
+        void (*Analyze)(PipelineFrame &),
+        void (*Publish)(PipelineFrame &));
+    ~AnalysisPipeline();
+    Stats GetStats() const;
+
+  private:
+    class FrameQueue
+    {
+      public:
+        FrameQueue() : closed_(false)
+        {
+        }
+        void Push(PipelineFrame *frame);
+        PipelineFrame *Pop(bool &waited);
+        PipelineFrame *TryPop();
+        void Close();
+
+      private:
+        std::mutex mutex_;
+        std::condition_variable cond_;
+        std::deque<PipelineFrame *> frames_;
+        bool closed_;
+    };
+
+    static void RunCapture(AnalysisPipeline *parent);
+    static void RunAnalyze(AnalysisPipeline *parent);
+    static gboolean PublishDispatch(gpointer data);
+
+    ImageProvider &provider_;
+    void (*Capture_)(VdoBuffer &, PipelineFrame &);
+    void (*Analyze_)(PipelineFrame &);
+    void (*Publish_)(PipelineFrame &);
+    PipelineFrame frames_[PIPELINE_FRAMES];
+    FrameQueue free_;
+    FrameQueue analyze_;
+    FrameQueue publish_;
+    std::atomic_bool running_;
+    std::thread *capture_thread_;
+    std::thread *analyze_thread_;
+    gint64 started_at_;
+    std::atomic<unsigned long> published_;
+    std::atomic<unsigned long> captured_;
+    std::atomic<unsigned long> analyzed_;
+    std::atomic<gint64> capture_us_;
+    std::atomic<gint64> analyze_us_;
+    std::atomic<gint64> publish_us_;
+    std::atomic<unsigned long> stalls_;
+};
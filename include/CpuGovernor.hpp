@@ -0,0 +1,102 @@
+/**
+ * Copyright (C) 2025, Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * This header file declares the governor that keeps the application within
+ * its CPU budget.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <glib.h>
+
+// Period (seconds) over which the CPU usage is measured
+#define GOVERNOR_PERIOD_S (2)
+// Least tracking window (degrees) of the tiers that force tracking on
+#define GOVERNOR_TRACKING_WINDOW (10)
+
+/**
+ * brief Closed-loop control of the analysis cost.
+ *
+ * Every GOVERNOR_PERIOD_S the CPU time used by the whole process is compared
+ * to the budget, in percent of one core. Above the budget the governor steps
+ * to the next cheaper operating point; well below it for a few periods, it
+ * steps back, and waits longer each time that took it over budget again. The
+ * operating points first trade detection tier (the configured pipeline, forced
+ * tracking, then skipping frames where the gauge did not change) and then the
+ * analysis interval. With no budget the configured
+ * pipeline runs on every frame.
+ */
+class CpuGovernor
+{
+  public:
+    enum Tier
+    {
+        TIER_FULL,        // Analysis as configured
+        TIER_TRACKING,    // Tracking forced on
+        TIER_CHANGE_GATE, // Tracking forced on, unchanged frames skipped
+    };
+
+    struct Stats
+    {
+        double cpu_percent;      // CPU usage in the last period, percent of one core
+        double cpu_per_frame_ms; // CPU time per analyzed frame in the last period
+        unsigned int level;      // Operating point, 0 is the most expensive
+        Tier tier;               // Detection tier of the operating point
+        guint interval_ms;       // Least time between analyzed frames
+        unsigned long analyzed;  // Frames analyzed
+        unsigned long skipped;   // Frames skipped by the interval or the change gate
+    };
+
+    CpuGovernor();
+    void SetBudget(const guint32 percent);
+    void Evaluate();
+    bool AnalysisDue(const guint min_interval_ms = 0);
+    void CountAnalysis()
+    {
+        analyzed_++;
+    };
+    void CountSkip()
+    {
+        skipped_++;
+    };
+    Tier GetTier() const
+    {
+        return tier_;
+    };
+    Stats GetStats() const;
+
+  private:
+    static gint64 CpuTimeUs();
+
+    std::atomic<guint32> budget_;
+    std::atomic<unsigned int> level_;
+    std::atomic<Tier> tier_;
+    std::atomic<guint> interval_ms_;
+    std::atomic<unsigned long> analyzed_;
+    std::atomic<unsigned long> skipped_;
+    std::atomic<double> cpu_percent_;
+    std::atomic<double> cpu_per_frame_ms_;
+    unsigned int calm_periods_;
+    unsigned int relax_periods_;
+    bool stepped_back_;
+    guint32 last_budget_;
+    gint64 last_cpu_us_;
+    gint64 last_wall_us_;
+    unsigned long last_analyzed_;
+    gint64 last_analysis_us_;
+};
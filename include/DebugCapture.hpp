@@ -0,0 +1,91 @@
+/**
+ * Copyright (C) 2025, Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * This header file declares the runtime capture of Gauge analysis images.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <opencv2/core/mat.hpp>
+#include <string>
+#include <thread>
+
+#define DEBUG_CAPTURE_FRAMES (8)
+
+/**
+ * brief A ring of the analysis images of the most recent frames.
+ *
+ * When enabled, the Gauge copies a few stage images of each frame into
+ * preallocated crop-sized buffers. On a detection failure or on request, the
+ * ring is handed over to a background thread of idle priority, which writes
+ * the images to storage as PGM files. The analysis never waits for storage;
+ * frames captured while the ring is being handed over are skipped.
+ */
+class DebugCapture
+{
+  public:
+    enum Stage
+    {
+        STAGE_GRAY,    // Crop after the dark check
+        STAGE_BLURRED, // Blurred crop that is thresholded
+        STAGE_NEEDLE,  // Binary image searched for the needle
+        NUM_STAGES
+    };
+
+    DebugCapture(const std::string &directory);
+    ~DebugCapture();
+    void SetEnabled(const bool enabled);
+    bool Enabled() const
+    {
+        return enabled_.load(std::memory_order_relaxed);
+    };
+    void Configure(const cv::Size &size);
+    void Capture(const cv::Mat &gray, const cv::Mat &blurred, const int blurred_row, const cv::Mat &needle);
+    void Trigger(const char *reason, const bool forced = false);
+
+  private:
+    struct Frame
+    {
+        unsigned long number;
+        bool valid;
+        cv::Mat stages[NUM_STAGES];
+    };
+
+    static void RunEncoder(DebugCapture *parent);
+    void CopyStage(const cv::Mat &img, const int row, cv::Mat &dst) const;
+    void WriteDump(const char *reason, const unsigned int newest);
+    bool WritePgm(const std::string &filename, const cv::Mat &img) const;
+
+    std::string directory_;
+    std::atomic_bool enabled_;
+    std::atomic_bool running_;
+    cv::Size size_;
+    unsigned long frames_;
+    unsigned int current_;
+    Frame ring_[DEBUG_CAPTURE_FRAMES];
+    Frame dump_[DEBUG_CAPTURE_FRAMES];
+    std::mutex ring_mutex_;
+    std::mutex trigger_mutex_;
+    std::condition_variable trigger_cond_;
+    const char *pending_reason_;
+    std::chrono::steady_clock::time_point last_dump_;
+    std::thread *encoder_;
+};
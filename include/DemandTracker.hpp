@@ -0,0 +1,63 @@
+/**
+ * Copyright (C) 2025, Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * This header file declares the tracker of the demand for the gauge reading.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <glib.h>
+
+/**
+ * brief Demand of the OPC UA clients for the gauge reading.
+ *
+ * Counts the reads of the reading, direct or sampled for a subscription, and
+ * the monitored items on it. A frame is wanted when a read came in since the
+ * last analyzed frame, so the analysis follows the rate of the consumers and
+ * answers a read after an idle period within a frame. Monitored items that
+ * are not seen reading, e.g. sampled on change, leave no trace of their rate,
+ * so they get the idle rate of the caller like no consumer at all.
+ */
+class DemandTracker
+{
+  public:
+    DemandTracker();
+    void Reset();
+    void CountRead();
+    void CountMonitoredItem(const bool removed);
+    bool Pending() const;
+    void Served(const gint64 now_us)
+    {
+        served_us_ = now_us;
+    };
+    gint GetMonitoredItems() const
+    {
+        return monitored_items_;
+    };
+    unsigned long GetReads() const
+    {
+        return reads_;
+    };
+
+  private:
+    std::atomic<gint> monitored_items_;
+    std::atomic<gint64> last_read_us_;
+    std::atomic<unsigned long> reads_;
+    gint64 served_us_; // Time the last analyzed frame was taken
+};
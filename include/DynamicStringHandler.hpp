@@ -16,16 +16,20 @@
 
 #pragma once
 
+#include <atomic>
 #include <chrono>
 #include <curl/curl.h>
 #include <glib.h>
 #include <string>
+#include <thread>
 
 /**
  * brief A type for handling setting dynamic text overlay string via VAPIX.
  *
  * This is not needed for OPC UA, but enables the camera to use the extracted
- * Gauge reading in overlays, which can add value to the live view.
+ * Gauge reading in overlays, which can add value to the live view. The VAPIX
+ * credentials are retrieved on a thread of its own, so that startup does not
+ * wait for D-Bus; updates before that are dropped.
  */
 class DynamicStringHandler
 {
@@ -39,10 +43,13 @@ class DynamicStringHandler
     void UpdateStr(const std::string &value_str);
 
   private:
+    static void Init(DynamicStringHandler *handler);
     std::string RetrieveVapixCredentials(const gchar &username) const;
     gboolean VapixGet(const std::string &url);
 
     CURL *curl_;
+    std::thread init_thread_;
+    std::atomic_bool ready_;
     guint8 nbr_;
     std::chrono::time_point<std::chrono::steady_clock> lastupdate_;
 };
@@ -18,15 +18,29 @@
 
 #include <axevent.h>
 
+#include "LimitAlarm.hpp"
+
+// Threshold bands, each declared as a stateful event next to the data event
+#define NUM_EVENT_THRESHOLDS (2)
+
 class EventPusher
 {
   public:
     EventPusher();
     ~EventPusher();
     gboolean Send(const gdouble value, const gboolean verbose_logs = FALSE) const;
+    void SetThreshold(const guint index, const gdouble threshold);
+    void SetHysteresis(const gdouble hysteresis);
+    void UpdateThresholds(const gdouble value);
 
   private:
+    gboolean DeclareThreshold(const guint index);
+    gboolean SendThreshold(const guint index, const gboolean active);
     AXEventHandler *event_handler_;
     gboolean initialized_;
     guint event_id_;
+    LimitAlarm thresholds_[NUM_EVENT_THRESHOLDS];
+    guint threshold_ids_[NUM_EVENT_THRESHOLDS];
+    gboolean threshold_initialized_[NUM_EVENT_THRESHOLDS];
+    gboolean threshold_active_[NUM_EVENT_THRESHOLDS]; // State last sent
 };
@@ -18,30 +18,135 @@
 
 #include <opencv2/core/mat.hpp>
 #include <opencv2/core/types.hpp>
+#include <stdint.h>
+#include <vector>
+
+#include "DebugCapture.hpp"
+#include "MaskSpans.hpp"
+#include "WorkerPool.hpp"
+
+/**
+ * brief Calibration and settings that a Gauge is set up with.
+ */
+struct GaugeParams
+{
+    cv::Point center;             // Center of the gauge
+    cv::Point min;                // Needle tip at the minimum
+    cv::Point max;                // Needle tip at the maximum
+    bool clockwise;               // Direction from the minimum to the maximum
+    double tracking_window;       // Tracking window (degrees), 0 for no tracking
+    unsigned int tracking_rescan; // Frames between full scans, 0 for none
+    unsigned int average_frames;  // Frames averaged per reading
+    bool background_model;        // Drop needle candidates that match the dial face
+};
 
 class Gauge
 {
   public:
+    struct TrackingStats
+    {
+        unsigned long hits;       // Needle found in the initial tracking window
+        unsigned long widened;    // Needle found in a widened tracking window
+        unsigned long misses;     // Needle lost by tracking, full scan needed
+        unsigned long full_scans; // All full scans, including periodic ones
+    };
+
     Gauge(
-        const cv::Mat &img,
+        const cv::Size &img_size,
         const cv::Point &point_center,
         const cv::Point &point_min,
         const cv::Point &point_max,
-        const bool clockwise = true);
+        const bool clockwise = true,
+        const double tracking_window = 0,
+        const unsigned int tracking_rescan = 0,
+        const unsigned int average_frames = 1,
+        const bool background_model = false);
     ~Gauge();
-    double ComputeGaugeValue(const cv::Mat &img) const;
+    static cv::Rect CropRect(
+        const cv::Size &img_size,
+        const cv::Point &point_center,
+        const cv::Point &point_min,
+        const cv::Point &point_max);
+    cv::Rect GetCropRect() const
+    {
+        return cv::Rect(croprange_x_.start, croprange_y_.start, croprange_x_.size(), croprange_y_.size());
+    };
+    bool CropChanged(const cv::Mat &crop);
+    bool AddCrop(const cv::Mat &crop);
+    double ComputeCropValue(const cv::Mat &crop);
+    TrackingStats GetTrackingStats() const
+    {
+        return tracking_stats_;
+    };
+    double GetConfidence() const
+    {
+        return confidence_;
+    };
+    double GetPreprocessAvgUs() const
+    {
+        return 0 < preprocess_frames_ ? preprocess_us_ / preprocess_frames_ : 0;
+    };
+    const cv::Mat &GetNeedleImage() const
+    {
+        return needle_;
+    };
+    cv::Mat GetGlobalMask() const;
+    void SetDebugCapture(DebugCapture *capture);
+    void SetWorkerPool(WorkerPool *pool);
+    void SetTrackingWindow(const double tracking_window);
 
   private:
+    // Scratch images of the preprocessing, holding the rows scratch_rows_
+    struct PreprocessScratch
+    {
+        cv::Mat blurred;
+        cv::Mat blurred_f;
+        cv::Mat mean_f;
+        cv::Mat mean;
+        std::vector<uint64_t> thresh_bits;
+        std::vector<uint64_t> dilated_bits;
+    };
+
     bool clockwise_;
-    cv::Mat big_mask_;
-    cv::Mat global_mask_;
-    cv::Mat small_mask_;
+    MaskSpans big_spans_;
+    MaskSpans global_spans_;
+    PreprocessScratch scratch_;
+    std::vector<PreprocessScratch> band_scratch_;
+    cv::Mat needle_;
+    cv::Mat frame_sum_;
+    cv::Mat frame_average_;
+    cv::Mat background_;
+    cv::Mat background_learned_;
+    cv::Mat gate_crop_;
+    std::vector<uint64_t> mask_bits_;
+    std::vector<uint64_t> window_bits_;
     cv::Point point_center_;
     cv::Point point_min_;
     cv::Point point_max_;
     cv::Range croprange_x_;
     cv::Range croprange_y_;
+    cv::Range needle_rows_;
+    cv::Range needle_written_;
+    cv::Range scratch_rows_;
+    cv::Range window_rows_;
     cv::Size img_size_;
+    int words_per_row_;
+    bool tracking_;
+    double tracked_angle_;
+    double tracking_window_;
+    unsigned int tracking_rescan_;
+    unsigned int frames_since_full_scan_;
+    TrackingStats tracking_stats_;
+    unsigned int average_frames_;
+    unsigned int frames_added_;
+    double confidence_;
+    bool background_model_;
+    bool background_dark_;
+    unsigned int background_phase_;
+    DebugCapture *capture_;
+    WorkerPool *pool_;
+    double preprocess_us_;
+    unsigned long preprocess_frames_;
     double angle_max_ = 0;
     double angle_min_ = 0;
     double angle_min_max_ = 0;
@@ -49,9 +154,20 @@ class Gauge
     unsigned int small_radii_;
     double EuclidianDistance(const cv::Point &a, const cv::Point &b) const;
     double GetDegree(const cv::Point &origo, const cv::Point &point) const;
-    bool IsDark(const cv::Mat &img, const cv::Mat &mask) const;
+    bool IsDark(const cv::Mat &img, const MaskSpans &mask) const;
     double AngleDifference(const double base_point, const double mesh_point) const;
-    void CreateMask(const cv::Mat &img, cv::Mat &mask, const unsigned int radii) const;
+    void CreateMask(const cv::Size &size, cv::Mat &mask, const unsigned int radii) const;
     inline void InvertImg(cv::Mat &img) const;
-    bool ContourEdgePoint(const cv::Mat &img, cv::Point &edge_point) const;
+    bool FindNeedle(const cv::Mat &crop, cv::Point &pointer_edge);
+    bool BuildWindowMask(const double angle_start, const double angle_end);
+    void AllocateScratch(PreprocessScratch &scratch) const;
+    void PreprocessRows(const cv::Mat &crop, const cv::Range &rows, const std::vector<uint64_t> &mask);
+    void PreprocessBand(
+        const cv::Mat &crop,
+        const cv::Range &rows,
+        const std::vector<uint64_t> &mask,
+        PreprocessScratch &scratch);
+    cv::Mat UnpackBits(const std::vector<uint64_t> &bits) const;
+    bool ContourEdgePoint(const cv::Mat &img, cv::Point &edge_point);
+    void UpdateBackground(const cv::Mat &crop, const cv::Point &pointer_edge);
 };
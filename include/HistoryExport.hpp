@@ -0,0 +1,55 @@
+/**
+ * Copyright (C) 2025, Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * This header file declares the local export of the reading history.
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+#include "ReadingHistory.hpp"
+
+// Local port of the export, behind the reverse proxy of the web server
+#define HISTORY_EXPORT_PORT (2001)
+
+/**
+ * brief HTTP endpoint serving ranges of the reading history as CSV.
+ *
+ * Listens on the loopback interface only; the web server of the camera
+ * forwards /local/<app>/history to it for authenticated users. A request
+ * takes the parameters from and to (Unix time in ms) and limit, all optional.
+ */
+class HistoryExport
+{
+  public:
+    HistoryExport(ReadingHistory &history);
+    ~HistoryExport();
+    bool Start(const unsigned int port = HISTORY_EXPORT_PORT);
+
+  private:
+    static gboolean HandleConnection(
+        GThreadedSocketService *service,
+        GSocketConnection *connection,
+        GObject *source_object,
+        gpointer user_data);
+    void Serve(const gchar *request, GOutputStream *out);
+
+    ReadingHistory &history_;
+    GSocketService *service_;
+};
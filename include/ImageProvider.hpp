@@ -21,6 +21,7 @@
 #pragma once
 
 #include <atomic>
+#include <glib.h>
 #include <pthread.h>
 #include <stdbool.h>
 
@@ -30,14 +31,19 @@
 #pragma GCC diagnostic pop
 
 #define _Atomic(X) std::atomic<X>
+// Frame buffers shared with VDO: the number to start with, and the bounds the
+// pool is resized within to follow the measured use of the buffers
 #define NUM_VDO_BUFFERS (8)
+#define MIN_VDO_BUFFERS (3)
+#define MAX_VDO_BUFFERS (12)
 
 /**
  * brief A type representing a provider of frames from VDO.
  *
  * Keep track of what kind of images the user wants, all the necessary
  * VDO types to setup and maintain a stream, as well as parameters to make
- * the streaming thread safe.
+ * the streaming thread safe. The state of each buffer is tracked, and the
+ * number of buffers follows the number the application holds at once.
  */
 class ImageProvider
 {
@@ -50,6 +56,7 @@ class ImageProvider
     static bool StartFrameFetch(ImageProvider &provider);
     static bool StopFrameFetch(ImageProvider &provider);
     static void *threadEntry(void *data);
+    static gboolean FrameSourceDispatch(GSource *source, GSourceFunc callback, gpointer data);
 
     ImageProvider(
         const unsigned int width,
@@ -58,12 +65,56 @@ class ImageProvider
         const VdoFormat format);
     ~ImageProvider();
     VdoBuffer *GetLastFrameBlocking();
+    VdoBuffer *GetLastFrame();
     void ReturnFrame(VdoBuffer &buffer);
+    guint AttachFrameSource(GSourceFunc callback, gpointer data);
+
+    struct FrameSignalStats
+    {
+        guint64 frames;          // Frames signalled by the fetcher thread
+        guint64 wakeups;         // Main loop dispatches of the frame source
+        gint64 total_latency_us; // Sum of signal to dispatch latencies
+        gint64 max_latency_us;   // Worst signal to dispatch latency
+    };
+    FrameSignalStats GetFrameSignalStats() const
+    {
+        return {frames_signalled_, wakeups_, total_latency_us_, max_latency_us_};
+    };
+
+    enum BufferState
+    {
+        BUFFER_FREE,      // Unused slot
+        BUFFER_IN_VDO,    // Enqueued, for VDO to fill
+        BUFFER_DELIVERED, // Filled, not yet taken by the application
+        BUFFER_CLIENT,    // Taken by the application
+        BUFFER_PROCESSED, // Returned by the application, not yet enqueued
+        NUM_BUFFER_STATES
+    };
+    struct BufferStats
+    {
+        unsigned int buffers[NUM_BUFFER_STATES]; // Buffers in each state
+        guint64 drops;                           // Frames enqueued again without being taken
+        guint64 consumer_waits;                  // Requests for a frame when none was delivered
+        guint64 vdo_starved;                     // Frames after which VDO had no buffer to fill
+        guint64 recycles;                        // Buffers enqueued again
+        gint64 total_recycle_us;                 // Sum of delivery to enqueue latencies
+        gint64 max_recycle_us;                   // Worst delivery to enqueue latency
+        guint64 grown;                           // Buffers added by resizing
+        guint64 shrunk;                          // Buffers released by resizing
+    };
+    BufferStats GetBufferStats();
 
   private:
+    void SignalFrame();
+    void AcknowledgeFrames();
     bool AllocateVdoBuffers();
+    bool AddVdoBuffer();
+    void FreeVdoBuffer(const int index);
     void ReleaseVdoBuffers();
     void RunLoopIteration();
+    void ResizeVdoBuffers();
+    int FindBuffer(const VdoBuffer &buffer) const;
+    unsigned int CountBuffers(const BufferState state) const;
 
     GQueue *delivered_frames_;
     GQueue *processed_frames_;
@@ -72,6 +123,19 @@ class ImageProvider
     pthread_t fetcher_thread_;
     std::atomic_bool shutdown_;
     unsigned int num_frames_;
-    VdoBuffer *vdo_buffers_[NUM_VDO_BUFFERS];
+    VdoBuffer *vdo_buffers_[MAX_VDO_BUFFERS];
+    BufferState buffer_states_[MAX_VDO_BUFFERS];
+    gint64 delivered_at_[MAX_VDO_BUFFERS];
+    BufferStats buffer_stats_;
+    unsigned int window_frames_;    // Frames of the current resize window
+    unsigned int window_max_held_;  // Most buffers outside VDO at once in the window
+    guint64 window_starved_;        // VDO starvations before the window
+    unsigned int pending_releases_; // Buffers to release instead of enqueueing
     VdoStream *vdo_stream_;
+    int frame_eventfd_;
+    std::atomic<gint64> signalled_at_;
+    std::atomic<guint64> frames_signalled_;
+    guint64 wakeups_;
+    gint64 total_latency_us_;
+    gint64 max_latency_us_;
 };
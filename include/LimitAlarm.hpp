@@ -0,0 +1,69 @@
+/**
+ * Copyright (C) 2025, Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * This header file declares the limit alarm evaluated on the gauge readings.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * brief State of a limit alarm, from the lowest to the highest limit exceeded.
+ */
+enum LimitState
+{
+    LIMIT_LOWLOW = -2,
+    LIMIT_LOW = -1,
+    LIMIT_NORMAL = 0,
+    LIMIT_HIGH = 1,
+    LIMIT_HIGHHIGH = 2,
+};
+
+/**
+ * brief Limit alarm of the HighHigh, High, Low and LowLow limits of a value.
+ *
+ * The state is the most severe limit exceeded. A limit is exceeded when the
+ * value reaches it, and stays exceeded until the value is back by the
+ * deadband, so a value that hovers at a limit does not toggle the alarm. A
+ * new state must hold for the delay before the alarm takes it.
+ */
+class LimitAlarm
+{
+  public:
+    LimitAlarm();
+    void SetLimit(const LimitState limit, const double value);
+    void SetDeadband(const double deadband);
+    void SetDelay(const unsigned int delay_s);
+    bool Update(const int64_t time_us, const double value);
+    double GetLimit(const LimitState limit) const;
+    LimitState GetState() const
+    {
+        return state_;
+    };
+
+  private:
+    LimitState Classify(const double value) const;
+    double high_[2];    // High and HighHigh limits, NAN when off
+    double low_[2];     // Low and LowLow limits, NAN when off
+    double deadband_;   // Distance the value must be back to leave a limit
+    int64_t delay_us_;  // Time a new state must hold
+    LimitState state_;
+    LimitState pending_;
+    int64_t pending_since_us_;
+};
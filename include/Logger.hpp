@@ -0,0 +1,53 @@
+/**
+ * Copyright (C) 2025, Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * This header file declares the logging backend behind the LOG macros.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+/**
+ * brief Rate limiting state of one LOG call site.
+ */
+struct LogSite
+{
+    std::atomic<int64_t> second;
+    std::atomic<unsigned int> count;
+    std::atomic<unsigned int> suppressed;
+};
+
+/**
+ * brief Asynchronous syslog and stdout writer.
+ *
+ * Each thread formats its messages into a lock-free ring buffer of its own,
+ * which a background thread flushes to syslog and stdout. Messages above the
+ * current level, or from a call site that has logged too much during the
+ * current second, are dropped before they are formatted. Errors, and all
+ * messages while the writer is not running, are written synchronously.
+ */
+class Logger
+{
+  public:
+    static void Start();
+    static void Stop();
+    static void SetLevel(const int priority);
+    static bool Filter(const int priority, LogSite &site);
+    static void Write(const int priority, LogSite &site, const char *fmt, ...) __attribute__((format(printf, 3, 4)));
+};
@@ -0,0 +1,73 @@
+/**
+ * Copyright (C) 2025, Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <opencv2/core/mat.hpp>
+#include <opencv2/core/types.hpp>
+#include <limits.h>
+#include <stdint.h>
+#include <vector>
+
+/**
+ * brief Run-length encoded binary mask.
+ *
+ * The mask is stored as a list of horizontal spans of set pixels, ordered by
+ * row and column, together with the index of the first span of each row. Masked
+ * operations can then visit only the set pixels.
+ */
+class MaskSpans
+{
+  public:
+    struct Span
+    {
+        int row;
+        int x_start;
+        int x_end; // Exclusive
+    };
+
+    MaskSpans();
+    MaskSpans(const cv::Mat &mask);
+    void PackRow(
+        uint64_t *words,
+        const int y,
+        const int words_per_row,
+        const int x_min = 0,
+        const int x_max = INT_MAX) const;
+
+    cv::Range Rows() const
+    {
+        return rows_;
+    };
+    size_t Pixels() const
+    {
+        return pixels_;
+    };
+    const Span *RowBegin(const int y) const
+    {
+        return rows_.start <= y && rows_.end > y ? spans_.data() + row_index_[y - rows_.start] : nullptr;
+    };
+    const Span *RowEnd(const int y) const
+    {
+        return rows_.start <= y && rows_.end > y ? spans_.data() + row_index_[y - rows_.start + 1] : nullptr;
+    };
+
+  private:
+    std::vector<Span> spans_;
+    std::vector<unsigned int> row_index_;
+    cv::Range rows_;
+    size_t pixels_;
+};
@@ -0,0 +1,123 @@
+/**
+ * Copyright (C) 2025, Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * This header file declares the pooled allocator of the image memory.
+ */
+
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <opencv2/core.hpp>
+#include <vector>
+
+/**
+ * brief Image memory allocator that recycles buffers and accounts for them.
+ *
+ * Installed as the default allocator of cv::Mat, it serves all images of the
+ * application and of OpenCV. Released buffers of at least MAT_POOL_MIN_BYTES
+ * are kept by size and handed out again for the next image of that size. The
+ * analysis creates images of the same few sizes for every frame, so after the
+ * first frames these come from the pool instead of the heap. The cached bytes
+ * are bounded; the sizes released least recently are dropped first.
+ *
+ * Each allocation is accounted to the tag of the allocating thread, set with
+ * MatTag, and released from that tag by whichever thread frees it.
+ */
+class MatPool : public cv::MatAllocator
+{
+  public:
+    enum Tag
+    {
+        TAG_OTHER, // Untagged, e.g. OpenCV internals on other threads
+        TAG_FRAME, // Frames taken from the stream
+        TAG_GAUGE, // Gauge analysis
+        TAG_DEBUG, // Debug capture
+        NUM_TAGS
+    };
+
+    struct TagStats
+    {
+        size_t bytes;              // Bytes in use
+        size_t peak_bytes;         // Most bytes in use at once
+        unsigned long allocations; // Images allocated
+    };
+
+    struct Stats
+    {
+        TagStats tags[NUM_TAGS];
+        size_t bytes;              // Bytes in use, all tags
+        size_t peak_bytes;         // Most bytes in use at once, all tags
+        size_t cached_bytes;       // Bytes kept for reuse
+        unsigned long allocations; // Images allocated, all tags
+        unsigned long pooled;      // Allocations of poolable sizes
+        unsigned long pool_hits;   // Poolable allocations served from the pool
+    };
+
+    static void Install();
+    static MatPool &GetInstance();
+    static const char *GetTagName(const Tag tag);
+    static Tag GetTag();
+    static Tag SetTag(const Tag tag);
+    Stats GetStats() const;
+
+    cv::UMatData *allocate(
+        int dims,
+        const int *sizes,
+        int type,
+        void *data,
+        size_t *step,
+        cv::AccessFlag flags,
+        cv::UMatUsageFlags usage_flags) const override;
+    bool allocate(cv::UMatData *data, cv::AccessFlag flags, cv::UMatUsageFlags usage_flags) const override;
+    void deallocate(cv::UMatData *data) const override;
+
+  private:
+    struct SizeClass
+    {
+        std::vector<void *> buffers; // Released buffers of the size
+        unsigned long last_used;     // Allocation count at the last release of the size
+    };
+
+    MatPool();
+    void *Take(const size_t size, const Tag tag) const;
+    void Give(void *data, const size_t size, const Tag tag) const;
+
+    // The allocator interface is const; the pool changes behind it
+    mutable std::mutex mutex_;
+    mutable std::map<size_t, SizeClass> free_;
+    mutable Stats stats_;
+};
+
+/**
+ * brief Scope that accounts the images allocated by the thread to a tag.
+ */
+class MatTag
+{
+  public:
+    MatTag(const MatPool::Tag tag) : previous_(MatPool::SetTag(tag))
+    {
+    }
+    ~MatTag()
+    {
+        MatPool::SetTag(previous_);
+    }
+
+  private:
+    const MatPool::Tag previous_;
+};
@@ -16,10 +16,16 @@
 
 #pragma once
 
+#include <atomic>
+#include <glib.h>
 #include <open62541/server.h>
 #include <open62541/server_config_default.h>
 #include <thread>
 
+#include "DemandTracker.hpp"
+#include "LimitAlarm.hpp"
+#include "ReadingHistory.hpp"
+
 class OpcUaServer
 {
   public:
@@ -29,12 +35,76 @@ class OpcUaServer
     void ShutDownServer();
     bool IsRunning() const;
     void UpdateGaugeValue(double value);
+    void UpdateFilteredValue(double value, double confidence);
+    void UpdateDiagnosticValue(const char *label, double value);
+    void UpdateAggregateValue(const char *label, double value);
+    void RemoveValue(const char *label);
+    void SetHistory(ReadingHistory *history)
+    {
+        history_ = history;
+    };
+    void SetLimitAlarm(const LimitAlarm *alarm)
+    {
+        limit_alarm_ = alarm;
+    };
+    void UpdateAlarmLimits();
+    void UpdateLimitAlarm();
+    guint64 GetIterations() const
+    {
+        return iterations_;
+    };
+    DemandTracker &GetDemand()
+    {
+        return demand_;
+    };
 
   protected:
   private:
-    void AddDouble(char *label, UA_Double value);
+    void AddDouble(
+        char *label,
+        UA_Double value,
+        const UA_NodeId parent_node_id = UA_NODEID_NUMERIC(0, UA_NS0ID_OBJECTSFOLDER));
+    void AddObject(char *label, const UA_Byte event_notifier = 0);
+    void AddHistoryMethod();
+    void AddLimitAlarm();
+    void TrackDemand(char *label);
+    static void OnRead(
+        UA_Server *server,
+        const UA_NodeId *session_id,
+        void *session_context,
+        const UA_NodeId *node_id,
+        void *node_context,
+        const UA_NumericRange *range,
+        const UA_DataValue *value);
+    static void OnMonitoredItem(
+        UA_Server *server,
+        const UA_NodeId *session_id,
+        void *session_context,
+        const UA_NodeId *node_id,
+        void *node_context,
+        UA_UInt32 attribute_id,
+        UA_Boolean removed);
+    static UA_StatusCode ReadHistory(
+        UA_Server *server,
+        const UA_NodeId *session_id,
+        void *session_context,
+        const UA_NodeId *method_id,
+        void *method_context,
+        const UA_NodeId *object_id,
+        void *object_context,
+        size_t input_size,
+        const UA_Variant *input,
+        size_t output_size,
+        UA_Variant *output);
+    void WriteDouble(char *label, double value);
+    void WriteChildDouble(char *parent_label, const char *label, double value);
     static void RunUaServer(OpcUaServer *parent);
     std::thread *serverthread_;
-    UA_Boolean running_;
+    std::atomic_bool running_;
     UA_Server *server_;
+    std::atomic<guint64> iterations_;
+    ReadingHistory *history_;
+    const LimitAlarm *limit_alarm_;
+    bool alarm_active_;
+    DemandTracker demand_;
 };
@@ -19,33 +19,31 @@
 #include <axparameter.h>
 #include <opencv2/core/core.hpp>
 
+#include "Gauge.hpp"
+#include "LimitAlarm.hpp"
+
 class ParamHandler
 {
   public:
     ParamHandler(
         const gchar *app_name,
-        void (*RestartOpcuaserver)(unsigned int),
-        void (*ReplaceGauge)(),
-        void (*SetDynstrNbr)(const guint8));
+        void (*RestartOpcuaserver)(const guint32),
+        void (*ReplaceGauge)(const GaugeParams &),
+        void (*SetDynstrNbr)(const guint8),
+        void (*SetDebugCapture)(const guint32),
+        void (*SetPipelined)(const gboolean),
+        void (*SetPreprocessThreads)(const guint32),
+        void (*SetCpuBudget)(const guint32),
+        void (*SetAggregateWindow)(const guint32, const guint32),
+        void (*SetAlarmLimit)(const LimitState, const guint32),
+        void (*SetAlarmDeadband)(const guint32),
+        void (*SetAlarmDelay)(const guint32),
+        void (*SetEventThreshold)(const guint32, const guint32),
+        void (*SetEventHysteresis)(const guint32),
+        void (*SetDemandIdleInterval)(const guint32));
     ~ParamHandler();
     static void param_callback(const gchar *name, const gchar *value, void *data);
 
-    gboolean GetClockwise() const
-    {
-        return clockwise_;
-    };
-    cv::Point GetCenterPoint() const
-    {
-        return center_point_;
-    };
-    cv::Point GetMinPoint() const
-    {
-        return min_point_;
-    };
-    cv::Point GetMaxPoint() const
-    {
-        return max_point_;
-    };
     gint8 GetRoundToDecimals() const
     {
         return round_to_decimals_;
@@ -58,14 +56,23 @@ class ParamHandler
     gboolean SetupParam(const gchar *name, AXParameterCallback callbackfn);
 
     void (*RestartOpcuaserver_)(const guint32);
-    void (*ReplaceGauge_)();
+    void (*ReplaceGauge_)(const GaugeParams &);
     void (*SetDynstrNbr_)(const guint8);
+    void (*SetDebugCapture_)(const guint32);
+    void (*SetPipelined_)(const gboolean);
+    void (*SetPreprocessThreads_)(const guint32);
+    void (*SetCpuBudget_)(const guint32);
+    void (*SetAggregateWindow_)(const guint32, const guint32);
+    void (*SetAlarmLimit_)(const LimitState, const guint32);
+    void (*SetAlarmDeadband_)(const guint32);
+    void (*SetAlarmDelay_)(const guint32);
+    void (*SetEventThreshold_)(const guint32, const guint32);
+    void (*SetEventHysteresis_)(const guint32);
+    void (*SetDemandIdleInterval_)(const guint32);
 
     AXParameter *axparameter_;
-    gboolean clockwise_;
+    guint32 port_;
     gint8 round_to_decimals_;
-    cv::Point center_point_;
-    cv::Point min_point_;
-    cv::Point max_point_;
+    GaugeParams gauge_params_;
     mutable GMutex mtx_;
 };
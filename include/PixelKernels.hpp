@@ -0,0 +1,69 @@
+/**
+ * Copyright (C) 2025, Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * This header file declares the vectorized pixel kernels used on the hot path
+ * of the Gauge analysis.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * brief Row kernels with one implementation per instruction set.
+ *
+ * The best implementation for the running CPU is picked once, at first use:
+ * NEON on ARM, AVX2 or SSE2 on x86 and plain C++ everywhere else. All
+ * implementations give bit-exact identical results.
+ */
+class PixelKernels
+{
+  public:
+    /**
+     * brief Count the light pixels of a row, i.e. those strictly larger than threshold.
+     *
+     * param img Pointer to the first pixel of the row.
+     * param len Number of pixels in the row.
+     * param threshold Light threshold.
+     * return Number of light pixels.
+     */
+    static unsigned int CountLight(const uint8_t *img, const size_t len, const uint8_t threshold);
+
+    /**
+     * brief Invert all pixels of a row in place (XOR with 0xff).
+     *
+     * param row Pointer to the first pixel of the row.
+     * param len Number of pixels in the row.
+     */
+    static void InvertRow(uint8_t *row, const size_t len);
+
+    /**
+     * brief Name of the instruction set selected at runtime.
+     */
+    static const char *Isa();
+
+    /**
+     * brief Replace the selected implementation, for tools that compare them.
+     *
+     * Must not be called while other threads use the kernels.
+     *
+     * param isa Name of the instruction set, as returned by Isa().
+     * return False if it is not built for this architecture or not supported by the CPU.
+     */
+    static bool SelectIsa(const char *isa);
+};
@@ -0,0 +1,57 @@
+/**
+ * Copyright (C) 2025, Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * This header file declares the filter applied to the gauge readings before
+ * they are published.
+ */
+
+#pragma once
+
+/**
+ * brief Streaming filter of gauge readings with outlier rejection.
+ *
+ * A one-dimensional Kalman filter for a slowly moving value. The measurement
+ * noise of each reading is scaled by the inverse of its detector confidence,
+ * and readings too far from the prediction are rejected as outliers, unless
+ * several consecutive outliers agree with each other on a new value; those
+ * are filtered on their own, and the filter restarts from them. Each update
+ * is O(1).
+ */
+class ReadingFilter
+{
+  public:
+    ReadingFilter();
+    void Reset();
+    bool Update(const double reading, const double detector_confidence);
+    double GetValue() const
+    {
+        return value_;
+    };
+    double GetConfidence() const
+    {
+        return confidence_;
+    };
+
+  private:
+    bool initialized_;
+    double value_;
+    double variance_;
+    double confidence_;
+    unsigned int outliers_;   // Consecutive outliers that agree with each other
+    double outlier_value_;    // Filtered value of those outliers
+    double outlier_variance_; // Variance of outlier_value_
+};
@@ -0,0 +1,158 @@
+/**
+ * Copyright (C) 2025, Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * This header file declares the on-device store of the reading history.
+ */
+
+#pragma once
+
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Size of a block of the history file, one flash page
+#define HISTORY_BLOCK_BYTES (4096)
+// Blocks of the history file; 1 MB holds a few days of readings at one per second
+#define HISTORY_BLOCKS (256)
+// Shortest time between two recorded readings, unless the status changes
+#define HISTORY_INTERVAL_MS (1000)
+// Longest time readings are kept in memory before they are written to the file
+#define HISTORY_FLUSH_PERIOD_S (600)
+
+/**
+ * brief Status of a recorded reading.
+ */
+enum HistoryStatus
+{
+    HISTORY_GOOD,     // Needle read and accepted
+    HISTORY_REJECTED, // Needle read but rejected as an outlier
+    HISTORY_FAILED,   // No needle found, the value is -1
+    NUM_HISTORY_STATUSES
+};
+
+struct HistoryReading
+{
+    int64_t time_ms;      // Unix time (ms)
+    double value;         // Reading (percent), at a resolution of 0.01
+    HistoryStatus status; // Status of the reading
+};
+
+/**
+ * brief Fixed size, memory-mapped ring file of the readings.
+ *
+ * The file is split into blocks of HISTORY_BLOCK_BYTES, written in turn; when
+ * the ring is full the oldest block is overwritten. Within a block, each
+ * reading is encoded as varints of the change from the reading before: the
+ * timestamp as the change of the time step, the value in units of 0.01 and
+ * the status only when it changes. A steady gauge read once per second takes
+ * two to three bytes per reading.
+ *
+ * The block being filled is kept in memory and written to the file when it is
+ * full, at most HISTORY_FLUSH_PERIOD_S after its first unwritten reading and
+ * on Flush(), to bound the wear of the flash. Each block carries a sequence
+ * number and a checksum, so on open the history continues after the newest
+ * valid block and a block torn by a power loss is skipped.
+ */
+class ReadingHistory
+{
+  public:
+    struct Stats
+    {
+        unsigned long readings;      // Readings recorded since open
+        unsigned long skipped;       // Readings within the interval, not recorded
+        unsigned long encoded_bytes; // Bytes of the encoded readings since open
+        unsigned long flushes;       // Writes of a block to the file
+        unsigned long flushed_bytes; // Bytes written to the file
+        unsigned long blocks;        // Blocks holding readings
+        unsigned long stored;        // Readings held
+        int64_t oldest_ms;           // Time of the oldest reading held, 0 if none
+    };
+
+    ReadingHistory(
+        const unsigned int blocks = HISTORY_BLOCKS,
+        const unsigned int interval_ms = HISTORY_INTERVAL_MS,
+        const unsigned int flush_period_s = HISTORY_FLUSH_PERIOD_S);
+    ~ReadingHistory();
+    bool Open(const std::string &filename);
+    void Append(const int64_t time_ms, const double value, const HistoryStatus status);
+    bool Flush();
+    size_t Query(
+        const int64_t from_ms,
+        const int64_t to_ms,
+        const size_t max_readings,
+        std::vector<HistoryReading> &readings);
+    Stats GetStats();
+
+  private:
+    struct BlockHeader
+    {
+        uint32_t magic;    // HISTORY_BLOCK_MAGIC, for a block ever written
+        uint32_t sequence; // Number of the block in the order written, from 1
+        int64_t base_ms;   // Time of its first reading, where the decoding starts
+        int64_t first_ms;  // Earliest time of its readings
+        int64_t last_ms;   // Latest time of its readings
+        uint16_t count;    // Readings in the block
+        uint16_t bytes;    // Bytes of encoded readings
+        uint32_t checksum; // FNV-1a of the header before it and of the readings
+    };
+
+    struct Block
+    {
+        BlockHeader header;
+        uint8_t data[HISTORY_BLOCK_BYTES - sizeof(BlockHeader)];
+    };
+    static_assert(HISTORY_BLOCK_BYTES == sizeof(Block), "Blocks must fill the pages of the file");
+
+    // The reading before the next one to encode or decode
+    struct Cursor
+    {
+        int64_t time_ms;
+        int64_t step_ms;
+        int64_t value;
+        HistoryStatus status;
+    };
+
+    Block *GetBlock(const unsigned int index) const;
+    const Block *GetReadBlock(const unsigned int index) const;
+    void StartBlock();
+    bool WriteBlock();
+    static uint32_t Checksum(const Block &block);
+    static bool ValidBlock(const Block &block);
+    static Cursor Decode(
+        const Block &block,
+        const int64_t from_ms,
+        const int64_t to_ms,
+        const size_t max_readings,
+        std::vector<HistoryReading> *readings);
+
+    const unsigned int blocks_;
+    const int64_t interval_ms_;
+    const int64_t flush_period_ms_;
+    std::mutex mutex_;
+    int fd_;
+    uint8_t *map_;
+    size_t map_bytes_;
+    unsigned int head_;         // Index of the block being filled
+    Block open_block_;          // The block being filled
+    Cursor cursor_;             // The last reading of open_block_
+    int64_t recorded_ms_;       // Time of the last reading recorded, 0 if none
+    HistoryStatus last_status_; // Status of the last reading recorded
+    int64_t unflushed_ms_;      // Time of the first reading not written, 0 if none
+    Stats stats_;
+};
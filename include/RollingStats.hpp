@@ -0,0 +1,103 @@
+/**
+ * Copyright (C) 2025, Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * This header file declares the rolling statistics of the gauge readings.
+ */
+
+#pragma once
+
+#include <deque>
+#include <stdint.h>
+
+// Bound of the time buckets held by one window; a window of up to one hour
+// has buckets of at most one second
+#define ROLLING_STATS_MAX_BUCKETS (3600)
+
+/**
+ * brief Statistics of the readings of the last window of time.
+ *
+ * The readings are merged into ROLLING_STATS_MAX_BUCKETS buckets of equal
+ * length per window, so the memory does not grow with the frame rate or the
+ * window, and the window moves in steps of one bucket. The statistics are
+ * maintained incrementally, in O(1) amortized time per reading: the minimum
+ * and the maximum from monotonic deques of the bucket extremes, the mean, the
+ * variance and the least squares slope of the value over time from moments
+ * updated with Welford's method for new readings, and with the pairwise
+ * formulas of Chan et al. for expired buckets. Failed readings are only
+ * counted.
+ */
+class RollingStats
+{
+  public:
+    struct Values
+    {
+        unsigned long count;  // Readings in the window
+        unsigned long failed; // Failed readings in the window
+        double min;           // Lowest reading
+        double max;           // Highest reading
+        double mean;          // Mean reading
+        double stddev;        // Sample standard deviation
+        double rate_per_min;  // Slope of the readings, per minute
+    };
+
+    RollingStats();
+    void SetWindow(const unsigned int window_s);
+    unsigned int GetWindow() const
+    {
+        return window_s_;
+    };
+    void Add(const int64_t time_us, const double value);
+    void Expire(const int64_t time_us);
+    Values GetValues() const;
+
+  private:
+    struct Moments
+    {
+        unsigned long count; // Readings
+        double mean;         // Mean value
+        double m2;           // Sum of squared deviations of the value
+        double mean_t;       // Mean time (s) after origin_us_
+        double m2_t;         // Sum of squared deviations of the time
+        double c_tv;         // Sum of products of the deviations of time and value
+
+        void Add(const double t, const double value);
+        void Remove(const Moments &part);
+    };
+    struct Bucket
+    {
+        int64_t time_us;      // Start of the bucket
+        unsigned long failed; // Failed readings
+        Moments moments;      // Moments of the readings
+    };
+    struct Extreme
+    {
+        int64_t time_us; // Start of the bucket
+        double value;    // Lowest or highest reading of the bucket
+    };
+
+    void Clear();
+
+    unsigned int window_s_;
+    int64_t bucket_us_;           // Length of a bucket
+    std::deque<Bucket> buckets_;  // Buckets of the window, oldest first
+    std::deque<Extreme> min_;     // Bucket minimums of increasing value, oldest first
+    std::deque<Extreme> max_;     // Bucket maximums of decreasing value, oldest first
+    int64_t origin_us_;           // Time of the first reading since cleared
+    unsigned long failed_;        // Failed readings of the window
+    Moments moments_;             // Moments of the readings of the window
+};
@@ -0,0 +1,64 @@
+/**
+ * Copyright (C) 2025, Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * This header file declares the worker threads that split the preprocessing
+ * of a frame.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "MatPool.hpp"
+
+/**
+ * brief A fixed set of threads that run the tasks of a split computation.
+ *
+ * Run() hands task i to thread i and runs task 0 on the calling thread, then
+ * waits for all tasks to finish. The assignment of tasks to threads is fixed,
+ * so each thread can keep scratch memory of its own for its task. The tasks
+ * allocate images under the MatPool tag of the caller.
+ */
+class WorkerPool
+{
+  public:
+    WorkerPool(const unsigned int threads);
+    ~WorkerPool();
+    unsigned int GetThreads() const
+    {
+        return workers_.size() + 1;
+    };
+    void Run(const unsigned int tasks, const std::function<void(const unsigned int)> &task);
+
+  private:
+    static void RunWorker(WorkerPool *parent, const unsigned int index);
+
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable start_cond_;
+    std::condition_variable done_cond_;
+    const std::function<void(const unsigned int)> *task_;
+    unsigned int tasks_;
+    MatPool::Tag tag_;
+    unsigned int pending_;
+    unsigned long generation_;
+    bool stopping_;
+};
@@ -16,11 +16,13 @@
 
 #pragma once
 
-#include <stdio.h>
 #include <syslog.h>
 
+#include "Logger.hpp"
+
 // clang-format off
-#define LOG(type, fmt, args...) { syslog(type, fmt, ##args); printf(fmt, ##args); printf("\n"); }
+#define LOG(type, fmt, args...) { static LogSite log_site_; \
+    if (Logger::Filter(type, log_site_)) { Logger::Write(type, log_site_, fmt, ##args); } }
 #define LOG_I(fmt, args...) { LOG(LOG_INFO, fmt, ##args) }
 #define LOG_E(fmt, args...) { LOG(LOG_ERR, fmt, ##args) }
 // clang-format on
@@ -0,0 +1,212 @@
+/**
+ * Copyright (C) 2025, Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <assert.h>
+
+#include "AnalysisPipeline.hpp"
+#include "common.hpp"
+
+using namespace std;
+
+void AnalysisPipeline::FrameQueue::Push(PipelineFrame *frame)
+{
+    assert(nullptr != frame);
+    {
+        lock_guard<mutex> lock(mutex_);
+        frames_.push_back(frame);
+    }
+    cond_.notify_one();
+}
+
+/**
+ * brief Wait for a frame.
+ *
+ * param waited Set if the queue was empty at first.
+ * return The oldest frame in the queue, or nullptr if the queue was closed.
+ */
+PipelineFrame *AnalysisPipeline::FrameQueue::Pop(bool &waited)
+{
+    unique_lock<mutex> lock(mutex_);
+    waited = frames_.empty();
+    cond_.wait(lock, [this] { return closed_ || !frames_.empty(); });
+    if (closed_)
+    {
+        return nullptr;
+    }
+    const auto frame = frames_.front();
+    frames_.pop_front();
+    return frame;
+}
+
+PipelineFrame *AnalysisPipeline::FrameQueue::TryPop()
+{
+    lock_guard<mutex> lock(mutex_);
+    if (frames_.empty())
+    {
+        return nullptr;
+    }
+    const auto frame = frames_.front();
+    frames_.pop_front();
+    return frame;
+}
+
+void AnalysisPipeline::FrameQueue::Close()
+{
+    {
+        lock_guard<mutex> lock(mutex_);
+        closed_ = true;
+    }
+    cond_.notify_all();
+}
+
+/**
+ * brief Start the capture and analysis threads.
+ *
+ * param provider Provider of the frames.
+ * param Capture Capture stage; must not keep any reference to the VDO buffer.
+ * param Analyze Analysis stage.
+ * param Publish Publish stage, called from the default main context.
+ */
+AnalysisPipeline::AnalysisPipeline(
+    ImageProvider &provider,
+    void (*Capture)(VdoBuffer &, PipelineFrame &),
+    void (*Analyze)(PipelineFrame &),
+    void (*Publish)(PipelineFrame &))
+    : provider_(provider), Capture_(Capture), Analyze_(Analyze), Publish_(Publish), frames_(), running_(true),
+      capture_thread_(nullptr), analyze_thread_(nullptr), started_at_(g_get_monotonic_time()), published_(0),
+      captured_(0), analyzed_(0), capture_us_(0), analyze_us_(0), publish_us_(0), stalls_(0)
+{
+    assert(nullptr != Capture_);
+    assert(nullptr != Analyze_);
+    assert(nullptr != Publish_);
+
+    for (auto &frame : frames_)
+    {
+        free_.Push(&frame);
+    }
+    capture_thread_ = new thread(RunCapture, this);
+    analyze_thread_ = new thread(RunAnalyze, this);
+    LOG_I("%s/%s: Pipeline started with %d frames", __FILE__, __FUNCTION__, PIPELINE_FRAMES);
+}
+
+/**
+ * brief Stop the pipeline; frames not yet published are dropped.
+ *
+ * Must be called from the default main context. The capture stage stops at
+ * the next frame from the provider, or when the provider is stopped.
+ */
+AnalysisPipeline::~AnalysisPipeline()
+{
+    running_ = false;
+    free_.Close();
+    analyze_.Close();
+    capture_thread_->join();
+    analyze_thread_->join();
+    delete capture_thread_;
+    delete analyze_thread_;
+    while (g_idle_remove_by_data(this))
+    {
+    }
+    LOG_I("%s/%s: Pipeline stopped", __FILE__, __FUNCTION__);
+}
+
+AnalysisPipeline::Stats AnalysisPipeline::GetStats() const
+{
+    return {published_, captured_, analyzed_, capture_us_, analyze_us_, publish_us_, g_get_monotonic_time() - started_at_, stalls_};
+}
+
+void AnalysisPipeline::RunCapture(AnalysisPipeline *parent)
+{
+    assert(nullptr != parent);
+    while (parent->running_)
+    {
+        bool waited;
+        auto frame = parent->free_.Pop(waited);
+        if (nullptr == frame)
+        {
+            break;
+        }
+        if (waited)
+        {
+            parent->stalls_++;
+        }
+
+        // Take the newest frame only once there is somewhere to put it
+        auto buf = parent->provider_.GetLastFrameBlocking();
+        if (nullptr == buf || !parent->running_)
+        {
+            if (nullptr != buf)
+            {
+                parent->provider_.ReturnFrame(*buf);
+            }
+            break;
+        }
+        const auto start = g_get_monotonic_time();
+        parent->Capture_(*buf, *frame);
+        parent->provider_.ReturnFrame(*buf);
+        parent->capture_us_ += g_get_monotonic_time() - start;
+        parent->captured_++;
+        // Frames skipped by the capture stage have nothing to analyze or publish
+        if (frame->skipped)
+        {
+            parent->free_.Push(frame);
+            continue;
+        }
+        parent->analyze_.Push(frame);
+    }
+}
+
+void AnalysisPipeline::RunAnalyze(AnalysisPipeline *parent)
+{
+    assert(nullptr != parent);
+    while (parent->running_)
+    {
+        bool waited;
+        auto frame = parent->analyze_.Pop(waited);
+        if (nullptr == frame)
+        {
+            break;
+        }
+        const auto start = g_get_monotonic_time();
+        parent->Analyze_(*frame);
+        parent->analyze_us_ += g_get_monotonic_time() - start;
+        parent->analyzed_++;
+        // Nor have frames that gave no reading, so they do not wake the main loop
+        if (!frame->valid)
+        {
+            parent->free_.Push(frame);
+            continue;
+        }
+        parent->publish_.Push(frame);
+        g_idle_add(PublishDispatch, parent);
+    }
+}
+
+gboolean AnalysisPipeline::PublishDispatch(gpointer data)
+{
+    auto parent = static_cast<AnalysisPipeline *>(data);
+    assert(nullptr != parent);
+    for (auto frame = parent->publish_.TryPop(); nullptr != frame; frame = parent->publish_.TryPop())
+    {
+        const auto start = g_get_monotonic_time();
+        parent->Publish_(*frame);
+        parent->publish_us_ += g_get_monotonic_time() - start;
+        parent->published_++;
+        parent->free_.Push(frame);
+    }
+
+    return G_SOURCE_REMOVE;
+}
@@ -0,0 +1,183 @@
+/**
+ * Copyright (C) 2025, Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/resource.h>
+
+#include "CpuGovernor.hpp"
+#include "common.hpp"
+
+// Usage below this part of the budget lets the governor step back ...
+#define GOVERNOR_RELAX (0.6)
+// ... once it has stayed there for this many periods. Each time a step back
+// goes over budget again, the periods are doubled, up to the maximum.
+#define GOVERNOR_RELAX_PERIODS (3)
+#define GOVERNOR_MAX_RELAX_PERIODS (96)
+
+// Operating points, from the most to the least expensive
+static const struct
+{
+    CpuGovernor::Tier tier;
+    guint interval_ms;
+} operating_points[] = {
+    {CpuGovernor::TIER_FULL, 0},
+    {CpuGovernor::TIER_TRACKING, 0},
+    {CpuGovernor::TIER_CHANGE_GATE, 0},
+    {CpuGovernor::TIER_CHANGE_GATE, 200},
+    {CpuGovernor::TIER_CHANGE_GATE, 500},
+    {CpuGovernor::TIER_CHANGE_GATE, 1000},
+    {CpuGovernor::TIER_CHANGE_GATE, 2000},
+    {CpuGovernor::TIER_CHANGE_GATE, 5000},
+};
+#define NUM_OPERATING_POINTS (sizeof(operating_points) / sizeof(operating_points[0]))
+
+CpuGovernor::CpuGovernor()
+    : budget_(0), level_(0), tier_(TIER_FULL), interval_ms_(0), analyzed_(0), skipped_(0), cpu_percent_(0),
+      cpu_per_frame_ms_(0), calm_periods_(0), relax_periods_(GOVERNOR_RELAX_PERIODS), stepped_back_(false),
+      last_budget_(0), last_cpu_us_(CpuTimeUs()), last_wall_us_(g_get_monotonic_time()), last_analyzed_(0),
+      last_analysis_us_(0)
+{
+}
+
+/**
+ * brief Set the CPU budget.
+ *
+ * param percent Budget in percent of one core, or 0 for no budget.
+ */
+void CpuGovernor::SetBudget(const guint32 percent)
+{
+    budget_ = percent;
+    LOG_I("%s/%s: CPU budget %u%%", __FILE__, __FUNCTION__, percent);
+}
+
+/**
+ * brief Measure the CPU usage of the last period and pick the operating point.
+ *
+ * Called every GOVERNOR_PERIOD_S from the main loop.
+ */
+void CpuGovernor::Evaluate()
+{
+    const auto cpu_us = CpuTimeUs();
+    const auto wall_us = g_get_monotonic_time();
+    const unsigned long analyzed = analyzed_;
+    if (wall_us <= last_wall_us_)
+    {
+        return;
+    }
+    const auto cpu_percent = 100.0 * (cpu_us - last_cpu_us_) / (wall_us - last_wall_us_);
+    cpu_percent_ = cpu_percent;
+    if (analyzed > last_analyzed_)
+    {
+        cpu_per_frame_ms_ = 1e-3 * (cpu_us - last_cpu_us_) / (analyzed - last_analyzed_);
+    }
+    last_cpu_us_ = cpu_us;
+    last_wall_us_ = wall_us;
+    last_analyzed_ = analyzed;
+
+    const guint32 budget = budget_;
+    if (budget != last_budget_)
+    {
+        last_budget_ = budget;
+        relax_periods_ = GOVERNOR_RELAX_PERIODS;
+        stepped_back_ = false;
+    }
+    auto level = level_.load();
+    if (0 == budget)
+    {
+        level = 0;
+        calm_periods_ = 0;
+    }
+    else if (budget < cpu_percent)
+    {
+        if (stepped_back_)
+        {
+            relax_periods_ = MIN(2 * relax_periods_, GOVERNOR_MAX_RELAX_PERIODS);
+        }
+        level = MIN(level + 1, NUM_OPERATING_POINTS - 1);
+        calm_periods_ = 0;
+        stepped_back_ = false;
+    }
+    else if (GOVERNOR_RELAX * budget > cpu_percent && 0 < level)
+    {
+        stepped_back_ = false;
+        if (relax_periods_ <= ++calm_periods_)
+        {
+            level--;
+            calm_periods_ = 0;
+            stepped_back_ = true;
+        }
+    }
+    else
+    {
+        calm_periods_ = 0;
+        stepped_back_ = false;
+    }
+
+    if (level != level_)
+    {
+        LOG_I(
+            "%s/%s: CPU usage %.1f%% of budget %u%%, operating point %u -> %u",
+            __FILE__,
+            __FUNCTION__,
+            cpu_percent,
+            budget,
+            level_.load(),
+            level);
+        level_ = level;
+        tier_ = operating_points[level].tier;
+        interval_ms_ = operating_points[level].interval_ms;
+    }
+}
+
+/**
+ * brief Check whether the analysis interval has passed since the last analyzed frame.
+ *
+ * Called by the single stage that takes the frames.
+ *
+ * param min_interval_ms Least interval asked for by the caller (ms), used
+ *       when longer than that of the operating point.
+ */
+bool CpuGovernor::AnalysisDue(const guint min_interval_ms)
+{
+    const auto now = g_get_monotonic_time();
+    const auto interval_ms = MAX(interval_ms_.load(), min_interval_ms);
+    if (now - last_analysis_us_ < 1000 * static_cast<gint64>(interval_ms))
+    {
+        return false;
+    }
+    last_analysis_us_ = now;
+    return true;
+}
+
+CpuGovernor::Stats CpuGovernor::GetStats() const
+{
+    return {cpu_percent_, cpu_per_frame_ms_, level_, tier_, interval_ms_, analyzed_, skipped_};
+}
+
+gint64 CpuGovernor::CpuTimeUs()
+{
+    // All threads of the process, user and system time
+    struct rusage usage;
+    if (0 != getrusage(RUSAGE_SELF, &usage))
+    {
+        LOG_E("%s/%s: getrusage failed (%s)", __FILE__, __FUNCTION__, strerror(errno));
+        return 0;
+    }
+    return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * G_USEC_PER_SEC + usage.ru_utime.tv_usec +
+           usage.ru_stime.tv_usec;
+}
@@ -0,0 +1,256 @@
+/**
+ * Copyright (C) 2025, Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * This file implements the capture ring and its background encoder.
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+#include "DebugCapture.hpp"
+#include "MatPool.hpp"
+#include "common.hpp"
+
+using namespace cv;
+using namespace std;
+
+// Automatic dumps on detection failures are at most this frequent, to spare
+// the storage when the gauge cannot be read for a longer time
+#define DEBUG_CAPTURE_MIN_INTERVAL_S (60)
+
+static const char *stage_names[DebugCapture::NUM_STAGES] = {"gray", "blurred", "needle"};
+
+DebugCapture::DebugCapture(const string &directory)
+    : directory_(directory), enabled_(false), running_(true), frames_(0), current_(0), ring_(), dump_(),
+      pending_reason_(nullptr), last_dump_(), encoder_(nullptr)
+{
+    encoder_ = new thread(RunEncoder, this);
+}
+
+DebugCapture::~DebugCapture()
+{
+    {
+        lock_guard<mutex> lock(trigger_mutex_);
+        running_ = false;
+    }
+    trigger_cond_.notify_one();
+    if (encoder_->joinable())
+    {
+        encoder_->join();
+    }
+    delete encoder_;
+}
+
+void DebugCapture::SetEnabled(const bool enabled)
+{
+    LOG_I("%s/%s: Debug capture %s", __FILE__, __FUNCTION__, enabled ? "enabled" : "disabled");
+    enabled_ = enabled;
+}
+
+/**
+ * brief Allocate the ring for crops of a new size, dropping all captured frames.
+ *
+ * param size Size of the Gauge crop.
+ */
+void DebugCapture::Configure(const Size &size)
+{
+    MatTag tag(MatPool::TAG_DEBUG);
+    lock_guard<mutex> lock(ring_mutex_);
+    size_ = size;
+    for (auto &frame : ring_)
+    {
+        frame.valid = false;
+        for (auto &stage : frame.stages)
+        {
+            stage.create(size_, CV_8U);
+        }
+    }
+}
+
+/**
+ * brief Copy the stage images of a frame into the ring.
+ *
+ * The frame is skipped if the encoder is taking over the ring at the moment.
+ *
+ * param gray Crop after the dark check.
+ * param blurred Blurred rows of the crop.
+ * param blurred_row Crop row of the first blurred row.
+ * param needle Binary image searched for the needle.
+ */
+void DebugCapture::Capture(const Mat &gray, const Mat &blurred, const int blurred_row, const Mat &needle)
+{
+    unique_lock<mutex> lock(ring_mutex_, try_to_lock);
+    if (!lock.owns_lock())
+    {
+        return;
+    }
+    MatTag tag(MatPool::TAG_DEBUG);
+    current_ = (current_ + 1) % DEBUG_CAPTURE_FRAMES;
+    auto &frame = ring_[current_];
+    frame.number = ++frames_;
+    CopyStage(gray, 0, frame.stages[STAGE_GRAY]);
+    CopyStage(blurred, blurred_row, frame.stages[STAGE_BLURRED]);
+    CopyStage(needle, 0, frame.stages[STAGE_NEEDLE]);
+    frame.valid = true;
+}
+
+/**
+ * brief Ask the encoder to write the ring to storage.
+ *
+ * param reason Static string stored with the images.
+ * param forced Dump even if the previous dump was recent.
+ */
+void DebugCapture::Trigger(const char *reason, const bool forced)
+{
+    assert(nullptr != reason);
+    lock_guard<mutex> lock(trigger_mutex_);
+    const auto now = chrono::steady_clock::now();
+    if (nullptr != pending_reason_ ||
+        (!forced && chrono::seconds(DEBUG_CAPTURE_MIN_INTERVAL_S) > now - last_dump_ &&
+         chrono::steady_clock::time_point() != last_dump_))
+    {
+        return;
+    }
+    pending_reason_ = reason;
+    last_dump_ = now;
+    trigger_cond_.notify_one();
+}
+
+void DebugCapture::CopyStage(const Mat &img, const int row, Mat &dst) const
+{
+    // Buffers handed back by the encoder may still have an older crop size
+    dst.create(size_, CV_8U);
+    if (img.size() != size_)
+    {
+        dst.setTo(0);
+    }
+    img.copyTo(dst.rowRange(row, row + img.rows));
+}
+
+void DebugCapture::RunEncoder(DebugCapture *parent)
+{
+    assert(nullptr != parent);
+    MatTag tag(MatPool::TAG_DEBUG);
+
+    // Encoding must never compete with the analysis for CPU time
+    sched_param param;
+    memset(&param, 0, sizeof(param));
+    if (0 != pthread_setschedparam(pthread_self(), SCHED_IDLE, &param))
+    {
+        LOG_I("%s/%s: WARNING, failed to set idle priority", __FILE__, __FUNCTION__);
+    }
+
+    unique_lock<mutex> trigger_lock(parent->trigger_mutex_);
+    while (true)
+    {
+        parent->trigger_cond_.wait(
+            trigger_lock,
+            [parent] { return !parent->running_ || nullptr != parent->pending_reason_; });
+        if (!parent->running_)
+        {
+            break;
+        }
+        const auto reason = parent->pending_reason_;
+        trigger_lock.unlock();
+
+        // Take over the captured frames by swapping buffers with the ring,
+        // which only takes the ring lock for a moment
+        unsigned int newest;
+        {
+            lock_guard<mutex> ring_lock(parent->ring_mutex_);
+            for (auto i = 0; i < DEBUG_CAPTURE_FRAMES; i++)
+            {
+                swap(parent->ring_[i], parent->dump_[i]);
+                parent->ring_[i].valid = false;
+            }
+            newest = parent->current_;
+        }
+        parent->WriteDump(reason, newest);
+
+        trigger_lock.lock();
+        parent->pending_reason_ = nullptr;
+    }
+}
+
+void DebugCapture::WriteDump(const char *reason, const unsigned int newest)
+{
+    if (0 != mkdir(directory_.c_str(), 0755) && EEXIST != errno)
+    {
+        LOG_E("%s/%s: Failed to create %s (%s)", __FILE__, __FUNCTION__, directory_.c_str(), strerror(errno));
+        return;
+    }
+    const auto info_name = directory_ + "/capture.txt";
+    auto info = fopen(info_name.c_str(), "w");
+    if (nullptr == info)
+    {
+        LOG_E("%s/%s: Failed to open %s (%s)", __FILE__, __FUNCTION__, info_name.c_str(), strerror(errno));
+        return;
+    }
+    fprintf(info, "reason: %s\n", reason);
+
+    // Oldest frame first; files from an earlier, larger dump are removed
+    auto written = 0;
+    for (auto i = 1; i <= DEBUG_CAPTURE_FRAMES; i++)
+    {
+        const auto &frame = dump_[(newest + i) % DEBUG_CAPTURE_FRAMES];
+        if (!frame.valid)
+        {
+            continue;
+        }
+        fprintf(info, "capture_%d: frame %lu\n", written, frame.number);
+        for (auto s = 0; s < NUM_STAGES; s++)
+        {
+            WritePgm(directory_ + "/capture_" + to_string(written) + "_" + stage_names[s] + ".pgm", frame.stages[s]);
+        }
+        written++;
+    }
+    for (auto k = written; k < DEBUG_CAPTURE_FRAMES; k++)
+    {
+        for (auto s = 0; s < NUM_STAGES; s++)
+        {
+            unlink((directory_ + "/capture_" + to_string(k) + "_" + stage_names[s] + ".pgm").c_str());
+        }
+    }
+    fclose(info);
+    LOG_I("%s/%s: Wrote %d captured frames to %s (%s)", __FILE__, __FUNCTION__, written, directory_.c_str(), reason);
+}
+
+bool DebugCapture::WritePgm(const string &filename, const Mat &img) const
+{
+    assert(CV_8U == img.type());
+    auto file = fopen(filename.c_str(), "wb");
+    if (nullptr == file)
+    {
+        LOG_E("%s/%s: Failed to open %s (%s)", __FILE__, __FUNCTION__, filename.c_str(), strerror(errno));
+        return false;
+    }
+    fprintf(file, "P5\n%d %d\n255\n", img.cols, img.rows);
+    auto ok = true;
+    for (auto y = 0; ok && y < img.rows; y++)
+    {
+        ok = static_cast<size_t>(img.cols) == fwrite(img.ptr<uchar>(y), 1, img.cols, file);
+    }
+    fclose(file);
+    return ok;
+}
@@ -0,0 +1,77 @@
+/**
+ * Copyright (C) 2025, Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * This file implements the tracker of the demand for the gauge reading.
+ */
+
+#include "DemandTracker.hpp"
+
+DemandTracker::DemandTracker() : monitored_items_(0), last_read_us_(0), reads_(0), served_us_(0)
+{
+}
+
+/**
+ * brief Forget the monitored items, for a new server.
+ */
+void DemandTracker::Reset()
+{
+    monitored_items_ = 0;
+}
+
+/**
+ * brief Count a read of the reading, called from the OPC UA server.
+ */
+void DemandTracker::CountRead()
+{
+    last_read_us_ = g_get_monotonic_time();
+    reads_++;
+}
+
+/**
+ * brief Count a monitored item added or removed, called from the OPC UA server.
+ *
+ * param removed True if the item was removed.
+ */
+void DemandTracker::CountMonitoredItem(const bool removed)
+{
+    // Removals of items counted before a Reset() are ignored
+    if (removed)
+    {
+        if (0 < monitored_items_)
+        {
+            monitored_items_--;
+        }
+    }
+    else
+    {
+        monitored_items_++;
+    }
+}
+
+/**
+ * brief Check whether a consumer waits for a new reading.
+ *
+ * Called by the single stage that takes the frames, which calls Served()
+ * when it takes one for analysis.
+ *
+ * return True if the next frame should be analyzed.
+ */
+bool DemandTracker::Pending() const
+{
+    return last_read_us_ > served_us_;
+}
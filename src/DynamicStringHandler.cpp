@@ -24,6 +24,15 @@
 using namespace std;
 using namespace std::chrono;
 
+// Where VAPIX and its service accounts are found; the host simulation build
+// points these at its stand-ins
+#ifndef VAPIX_HOST
+#define VAPIX_HOST "127.0.0.12"
+#endif
+#ifndef VAPIX_BUS_TYPE
+#define VAPIX_BUS_TYPE (G_BUS_TYPE_SYSTEM)
+#endif
+
 static size_t append_to_string_callback(char *ptr, size_t size, size_t nmemb, string *response)
 {
     assert(nullptr != response);
@@ -34,35 +43,56 @@ static size_t append_to_string_callback(char *ptr, size_t size, size_t nmemb, st
 }
 
 DynamicStringHandler::DynamicStringHandler(const guint8 nbr)
-    : curl_(nullptr), nbr_(nbr), lastupdate_(steady_clock::now())
+    : curl_(nullptr), ready_(false), nbr_(nbr), lastupdate_(steady_clock::now())
 {
     assert(1 <= nbr);
     assert(16 >= nbr);
 
+    init_thread_ = thread(Init, this);
+}
+
+DynamicStringHandler::~DynamicStringHandler()
+{
+    init_thread_.join();
+    if (nullptr != curl_)
+    {
+        curl_easy_cleanup(curl_);
+    }
+    curl_global_cleanup();
+}
+
+/**
+ * brief Set up cURL with the VAPIX credentials, off the startup path.
+ *
+ * param handler Handler to set up.
+ */
+void DynamicStringHandler::Init(DynamicStringHandler *handler)
+{
+    assert(nullptr != handler);
+    const auto start = steady_clock::now();
     curl_global_init(CURL_GLOBAL_DEFAULT);
-    curl_ = curl_easy_init();
-    assert(nullptr != curl_);
+    handler->curl_ = curl_easy_init();
+    assert(nullptr != handler->curl_);
 
     const gchar *user = "example-vapix-user";
-    const auto credentials = RetrieveVapixCredentials(*user);
+    const auto credentials = handler->RetrieveVapixCredentials(*user);
 
+    const auto curl = handler->curl_;
     const auto curl_init =
-        (CURLE_OK == curl_easy_setopt(curl_, CURLOPT_HTTPAUTH, (long)(CURLAUTH_DIGEST | CURLAUTH_BASIC)) &&
-         CURLE_OK == curl_easy_setopt(curl_, CURLOPT_NOPROGRESS, 2L) &&
-         CURLE_OK == curl_easy_setopt(curl_, CURLOPT_USERPWD, credentials.c_str()) &&
-         CURLE_OK == curl_easy_setopt(curl_, CURLOPT_HTTPGET, 1L) &&
-         CURLE_OK == curl_easy_setopt(curl_, CURLOPT_TIMEOUT, 1) &&
-         CURLE_OK == curl_easy_setopt(curl_, CURLOPT_WRITEFUNCTION, append_to_string_callback));
+        (CURLE_OK == curl_easy_setopt(curl, CURLOPT_HTTPAUTH, (long)(CURLAUTH_DIGEST | CURLAUTH_BASIC)) &&
+         CURLE_OK == curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 2L) &&
+         CURLE_OK == curl_easy_setopt(curl, CURLOPT_USERPWD, credentials.c_str()) &&
+         CURLE_OK == curl_easy_setopt(curl, CURLOPT_HTTPGET, 1L) &&
+         CURLE_OK == curl_easy_setopt(curl, CURLOPT_TIMEOUT, 1) &&
+         CURLE_OK == curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, append_to_string_callback));
 
     assert(curl_init);
-    LOG_I("%s/%s: Dynamic string handler constructor is done!", __FILE__, __FUNCTION__);
-}
-
-DynamicStringHandler::~DynamicStringHandler()
-{
-    assert(nullptr != curl_);
-    curl_easy_cleanup(curl_);
-    curl_global_cleanup();
+    handler->ready_ = true;
+    LOG_I(
+        "%s/%s: Dynamic string handler ready after %lld ms",
+        __FILE__,
+        __FUNCTION__,
+        static_cast<long long>(duration_cast<milliseconds>(steady_clock::now() - start).count()));
 }
 
 void DynamicStringHandler::SetStrNumber(const guint8 newnbr)
@@ -73,6 +103,12 @@ void DynamicStringHandler::SetStrNumber(const guint8 newnbr)
 
 void DynamicStringHandler::UpdateStr(const std::string &value_str)
 {
+    // Not set up yet, the next update will do
+    if (!ready_)
+    {
+        return;
+    }
+
     // We don't need to update too frequently
     const auto nowtime = steady_clock::now();
     if (1 > duration_cast<seconds>(nowtime - lastupdate_).count())
@@ -80,7 +116,7 @@ void DynamicStringHandler::UpdateStr(const std::string &value_str)
         return;
     }
 
-    const auto url = "http://127.0.0.12/axis-cgi/dynamicoverlay.cgi?action=settext&text_index=" + to_string(nbr_) +
+    const auto url = "http://" VAPIX_HOST "/axis-cgi/dynamicoverlay.cgi?action=settext&text_index=" + to_string(nbr_) +
                      "&text=" + value_str;
     if (!VapixGet(url))
     {
@@ -92,12 +128,12 @@ void DynamicStringHandler::UpdateStr(const std::string &value_str)
 string DynamicStringHandler::RetrieveVapixCredentials(const gchar &username) const
 {
     GError *error = nullptr;
-    auto connection = g_bus_get_sync(G_BUS_TYPE_SYSTEM, nullptr, &error);
+    auto connection = g_bus_get_sync(VAPIX_BUS_TYPE, nullptr, &error);
     if (nullptr == connection)
     {
         LOG_E("Error connecting to D-Bus: %s", error->message);
         g_error_free(error);
-        return nullptr;
+        return "";
     }
 
     const char *bus_name = "com.axis.HTTPConf1";
@@ -33,7 +33,9 @@ static void declaration_complete(guint declaration, gpointer user_data)
     LOG_I("Event declaration complete!");
 }
 
-EventPusher::EventPusher() : event_handler_(ax_event_handler_new()), initialized_(FALSE)
+EventPusher::EventPusher()
+    : event_handler_(ax_event_handler_new()), initialized_(FALSE), threshold_ids_{}, threshold_initialized_{},
+      threshold_active_{}
 {
     assert(nullptr != event_handler_);
     GError *error = nullptr;
@@ -96,6 +98,12 @@ EventPusher::EventPusher() : event_handler_(ax_event_handler_new()), initialized
 
     // The key/value set is no longer needed
     ax_event_key_value_set_free(set);
+
+    // The threshold bands are off until set
+    for (guint i = 0; NUM_EVENT_THRESHOLDS > i; i++)
+    {
+        DeclareThreshold(i);
+    }
 }
 
 EventPusher::~EventPusher()
@@ -105,6 +113,13 @@ EventPusher::~EventPusher()
 
     LOG_I("%s/%s: Undeclare event ...", __FILE__, __FUNCTION__);
     ax_event_handler_undeclare(event_handler_, event_id_, nullptr);
+    for (const auto threshold_id : threshold_ids_)
+    {
+        if (0 != threshold_id)
+        {
+            ax_event_handler_undeclare(event_handler_, threshold_id, nullptr);
+        }
+    }
 
     LOG_I("%s/%s: Free eventhandler ...", __FILE__, __FUNCTION__);
     ax_event_handler_free(event_handler_);
@@ -147,3 +162,153 @@ gboolean EventPusher::Send(const gdouble value, const gboolean verbose_logs) con
 
     return TRUE;
 }
+
+/**
+ * brief Declare the stateful event of a threshold band.
+ *
+ * The event has the band as its source and is active while the value is
+ * above the threshold of the band, so action rules can act on the crossings
+ * instead of on every value.
+ *
+ * param index Index of the band.
+ *
+ * return True if the declaration was accepted.
+ */
+gboolean EventPusher::DeclareThreshold(const guint index)
+{
+    assert(NUM_EVENT_THRESHOLDS > index);
+    GError *error = nullptr;
+
+    auto set = ax_event_key_value_set_new();
+    const gint band = index + 1;
+    const gboolean active = FALSE;
+    if (!ax_event_key_value_set_add_key_values(
+            set,
+            &error,
+            "topic0",
+            "tnsaxis",
+            "CameraApplicationPlatform",
+            AX_VALUE_TYPE_STRING,
+            "topic1",
+            "tnsaxis",
+            "GaugeReader",
+            AX_VALUE_TYPE_STRING,
+            "topic2",
+            "tnsaxis",
+            "Threshold",
+            AX_VALUE_TYPE_STRING,
+            "Band",
+            NULL,
+            &band,
+            AX_VALUE_TYPE_INT,
+            "active",
+            NULL,
+            &active,
+            AX_VALUE_TYPE_BOOL,
+            NULL))
+    {
+        LOG_E("%s/%s: Could not add key values: %s", __FILE__, __FUNCTION__, error->message);
+        g_error_free(error);
+        ax_event_key_value_set_free(set);
+        return FALSE;
+    }
+
+    ax_event_key_value_set_add_nice_names(set, "topic0", "tnsaxis", NULL, "Application", NULL);
+    ax_event_key_value_set_add_nice_names(set, "topic1", "tnsaxis", NULL, "OPC UA Gauge Reader", NULL);
+    ax_event_key_value_set_add_nice_names(set, "topic2", "tnsaxis", NULL, "Gauge threshold", NULL);
+    ax_event_key_value_set_add_nice_names(set, "Band", NULL, "Threshold band", NULL, NULL);
+    ax_event_key_value_set_add_nice_names(set, "active", NULL, "Above threshold", NULL, NULL);
+    ax_event_key_value_set_mark_as_source(set, "Band", NULL, NULL);
+    ax_event_key_value_set_mark_as_data(set, "active", NULL, NULL);
+
+    const auto declared = ax_event_handler_declare(
+        event_handler_,
+        set,
+        FALSE, // Stateful: the event system keeps the state, starting inactive
+        &threshold_ids_[index],
+        declaration_complete,
+        &threshold_initialized_[index],
+        &error);
+    ax_event_key_value_set_free(set);
+    if (!declared)
+    {
+        LOG_E("%s/%s: Could not declare threshold band %d: %s", __FILE__, __FUNCTION__, band, error->message);
+        g_error_free(error);
+        threshold_ids_[index] = 0;
+    }
+    return declared;
+}
+
+/**
+ * brief Set the threshold of a band.
+ *
+ * param index Index of the band.
+ * param threshold Threshold (percent), NAN to turn the band off.
+ */
+void EventPusher::SetThreshold(const guint index, const gdouble threshold)
+{
+    assert(NUM_EVENT_THRESHOLDS > index);
+    thresholds_[index].SetLimit(LIMIT_HIGH, threshold);
+}
+
+/**
+ * brief Set how far below its threshold the value must fall to leave a band.
+ *
+ * param hysteresis Hysteresis (percent).
+ */
+void EventPusher::SetHysteresis(const gdouble hysteresis)
+{
+    for (auto &threshold : thresholds_)
+    {
+        threshold.SetDeadband(hysteresis);
+    }
+}
+
+/**
+ * brief Evaluate the threshold bands against a new value and send the
+ * events of the bands that were crossed.
+ *
+ * param value Gauge value (percent).
+ */
+void EventPusher::UpdateThresholds(const gdouble value)
+{
+    const auto now = g_get_monotonic_time();
+    for (guint i = 0; NUM_EVENT_THRESHOLDS > i; i++)
+    {
+        thresholds_[i].Update(now, value);
+        const gboolean active = LIMIT_HIGH == thresholds_[i].GetState();
+        // A crossing before the declaration is complete is sent after it
+        if (active != threshold_active_[i] && threshold_initialized_[i] && SendThreshold(i, active))
+        {
+            threshold_active_[i] = active;
+        }
+    }
+}
+
+gboolean EventPusher::SendThreshold(const guint index, const gboolean active)
+{
+    assert(NUM_EVENT_THRESHOLDS > index);
+    assert(nullptr != event_handler_);
+
+    auto set = ax_event_key_value_set_new();
+    const gint band = index + 1;
+    ax_event_key_value_set_add_key_value(set, "Band", NULL, &band, AX_VALUE_TYPE_INT, NULL);
+    ax_event_key_value_set_add_key_value(set, "active", NULL, &active, AX_VALUE_TYPE_BOOL, NULL);
+    auto event = ax_event_new2(set, NULL);
+    ax_event_key_value_set_free(set);
+
+    GError *error = nullptr;
+    const auto sent = ax_event_handler_send_event(event_handler_, threshold_ids_[index], event, &error);
+    if (!sent)
+    {
+        LOG_E("%s/%s: Failed to send threshold event: %s", __FILE__, __FUNCTION__, error->message);
+        g_error_free(error);
+    }
+    else
+    {
+        LOG_I("%s/%s: Threshold band %d %s", __FILE__, __FUNCTION__, band, active ? "active" : "inactive");
+    }
+    ax_event_free(event);
+
+    return sent;
+}
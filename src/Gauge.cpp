@@ -16,11 +16,13 @@
 
 #include <assert.h>
 #include <cmath>
+#include <string.h>
 #include <iostream>
 #include <map>
 #include <opencv2/imgproc.hpp>
 
 #include "Gauge.hpp"
+#include "PixelKernels.hpp"
 #include "common.hpp"
 
 using namespace cv;
@@ -34,14 +36,84 @@ using namespace std;
 #define DBG_WRITE_IMG(filename, img)
 #endif
 
+// Preprocessing filter sizes
+#define BLUR_KSIZE (5)
+#define THRESH_BLOCKSIZE (11)
+#define THRESH_C (2)
+// Rows read around an output row by the adaptive threshold window and rows
+// read above an output row by the 2x2 close (dilate followed by erode)
+#define THRESH_HALO (THRESH_BLOCKSIZE / 2)
+#define CLOSE_HALO (2)
+// Rows handled per preprocessing step; small enough for the working rows of
+// all stages to stay in cache
+#define PREPROCESS_TILE_ROWS (16)
+// Smallest band of rows worth handing to a worker thread
+#define PREPROCESS_MIN_BAND_ROWS (2 * PREPROCESS_TILE_ROWS)
+// The tracking window is doubled until it reaches this half-width (degrees),
+// then a full scan is done instead
+#define TRACKING_MAX_WINDOW (90)
+// A needle found in the outer part of the tracking window may continue
+// outside it, so it only counts as a hit within this part of the window
+#define TRACKING_WINDOW_MARGIN (0.75)
+// The change gate lets a crop through when more than CHANGE_GATE_PIXELS
+// pixels of the annulus differ by more than CHANGE_GATE_LEVEL gray levels
+// from the last crop it let through
+#define CHANGE_GATE_LEVEL (24)
+#define CHANGE_GATE_PIXELS (16)
+// Frame sums are kept in 16 bits
+#define MAX_AVERAGE_FRAMES (256)
+// The background model holds gray levels with BACKGROUND_SHIFT fraction bits
+// and is updated with a weight of 1 / (1 << BACKGROUND_RATE_SHIFT). A pixel is
+// gated once it has been learned from BACKGROUND_LEARN_FRAMES frames, and then
+// only passes as needle if it differs from the model by BACKGROUND_THRESHOLD
+// gray levels. The model is not updated within BACKGROUND_NEEDLE_WEDGE degrees
+// of the needle, and only from full scans with a confidence of at least
+// BACKGROUND_MIN_CONFIDENCE, each updating every BACKGROUND_ROW_PHASES:th row.
+#define BACKGROUND_SHIFT (4)
+#define BACKGROUND_RATE_SHIFT (5)
+#define BACKGROUND_LEARN_FRAMES (16)
+#define BACKGROUND_THRESHOLD (24)
+#define BACKGROUND_NEEDLE_WEDGE (15)
+#define BACKGROUND_MIN_CONFIDENCE (0.4)
+#define BACKGROUND_ROW_PHASES (4)
+
+static bool ClipHalfPlane(const double alpha, const double beta, double &lo, double &hi)
+{
+    // Limit [lo, hi] to the dx solving alpha * dx + beta >= 0
+    if (0 < alpha)
+    {
+        lo = max(lo, -beta / alpha);
+    }
+    else if (0 > alpha)
+    {
+        hi = min(hi, -beta / alpha);
+    }
+    else if (0 > beta)
+    {
+        return false;
+    }
+    return lo <= hi;
+}
+
 Gauge::Gauge(
-    const Mat &img,
+    const Size &img_size,
     const Point &point_center,
     const Point &point_min,
     const Point &point_max,
-    const bool clockwise)
-    : clockwise_(clockwise), img_size_(img.size())
+    const bool clockwise,
+    const double tracking_window,
+    const unsigned int tracking_rescan,
+    const unsigned int average_frames,
+    const bool background_model)
+    : clockwise_(clockwise), img_size_(img_size), tracking_(false), tracked_angle_(0),
+      tracking_window_(tracking_window), tracking_rescan_(tracking_rescan), frames_since_full_scan_(0),
+      tracking_stats_({0, 0, 0, 0}), average_frames_(average_frames), frames_added_(0), confidence_(0),
+      background_model_(background_model), background_dark_(false), background_phase_(0), capture_(nullptr),
+      pool_(nullptr), preprocess_us_(0), preprocess_frames_(0)
 {
+    assert(TRACKING_MAX_WINDOW > tracking_window_);
+    assert(0 < average_frames_ && MAX_AVERAGE_FRAMES >= average_frames_);
+
     // Calculate angles and radiuses
     angle_min_ = GetDegree(point_center, point_min);
     angle_max_ = GetDegree(point_center, point_max);
@@ -53,18 +125,97 @@ Gauge::Gauge(
     small_radii_ = round(radii / 3);
 
     // Crop to avoid processing pixels outside Gauge area
-    const auto crop_radii = max(d1, d2);
+    const auto crop_rect = CropRect(img_size, point_center, point_min, point_max);
+    croprange_x_ = Range(crop_rect.x, crop_rect.x + crop_rect.width);
+    croprange_y_ = Range(crop_rect.y, crop_rect.y + crop_rect.height);
+    const Point offset(croprange_x_.start, croprange_y_.start);
+    point_min_ = point_min - offset;
+    point_center_ = point_center - offset;
+    point_max_ = point_max - offset;
+    const auto crop_size = crop_rect.size();
+
+    // Create Gauge masks and keep them run-length encoded, so that masked
+    // operations only visit the annulus sector
+    Mat big_mask;
+    Mat small_mask;
+    Mat global_mask;
+    CreateMask(crop_size, big_mask, big_radii_);
+    CreateMask(crop_size, small_mask, small_radii_);
+    bitwise_xor(big_mask, small_mask, global_mask);
+    DBG_WRITE_IMG("mask_0_big.png", big_mask);
+    DBG_WRITE_IMG("mask_1_small.png", small_mask);
+    DBG_WRITE_IMG("mask_2_global.png", global_mask);
+    big_spans_ = MaskSpans(big_mask);
+    global_spans_ = MaskSpans(global_mask);
+
+    // Only rows covered by the global mask can contain needle pixels. The
+    // preprocessing scratch images hold those rows plus the rows read around
+    // them by the threshold window and the close, see PreprocessRows().
+    needle_rows_ = global_spans_.Rows();
+    needle_written_ = needle_rows_;
+    scratch_rows_ = Range(
+        max(0, needle_rows_.start - CLOSE_HALO - THRESH_HALO),
+        min(crop_size.height, needle_rows_.end + THRESH_HALO));
+    needle_ = Mat::zeros(crop_size, CV_8U);
+    if (1 < average_frames_)
+    {
+        frame_sum_ = Mat(crop_size, CV_16U);
+        frame_average_ = Mat(crop_size, CV_8U);
+    }
+    if (background_model_)
+    {
+        background_ = Mat::zeros(crop_size, CV_16U);
+        background_learned_ = Mat::zeros(crop_size, CV_8U);
+    }
+
+    // The binary stages work on 64 pixels per word
+    words_per_row_ = (crop_size.width + 63) / 64;
+    AllocateScratch(scratch_);
+    mask_bits_.resize(needle_rows_.size() * words_per_row_);
+    window_bits_.resize(needle_rows_.size() * words_per_row_);
+    for (auto y = needle_rows_.start; y < needle_rows_.end; y++)
+    {
+        global_spans_.PackRow(&mask_bits_[(y - needle_rows_.start) * words_per_row_], y, words_per_row_);
+    }
+
+    LOG_I(
+        "%s/%s: %sclockwise, img size: (%u, %u), %s pixel kernels",
+        __FILE__,
+        __FUNCTION__,
+        clockwise_ ? "" : "counter",
+        img_size_.width,
+        img_size_.height,
+        PixelKernels::Isa());
+}
+
+Gauge::~Gauge()
+{
+}
+
+/**
+ * brief Get the part of an image that a gauge reads, without setting it up.
+ *
+ * param img_size Size of the full image.
+ * param point_center Center of the gauge.
+ * param point_min Needle tip at the minimum.
+ * param point_max Needle tip at the maximum.
+ * return The square around the center that holds both needle tips, clipped
+ *        to the image.
+ */
+Rect Gauge::CropRect(const Size &img_size, const Point &point_center, const Point &point_min, const Point &point_max)
+{
+    const auto crop_radii = max(norm(point_center - point_min), norm(point_center - point_max));
     int max_x = point_center.x + crop_radii;
     int max_y = point_center.y + crop_radii;
     int min_x = point_center.x - crop_radii;
     int min_y = point_center.y - crop_radii;
-    if (img.size().width < max_x)
+    if (img_size.width < max_x)
     {
-        max_x = img.size().width;
+        max_x = img_size.width;
     }
-    if (img.size().height < max_y)
+    if (img_size.height < max_y)
     {
-        max_y = img.size().height;
+        max_y = img_size.height;
     }
     if (0 > min_x)
     {
@@ -74,74 +225,158 @@ Gauge::Gauge(
     {
         min_y = 0;
     }
-    croprange_x_ = Range(min_x, max_x);
-    croprange_y_ = Range(min_y, max_y);
-    const Point offset(croprange_x_.start, croprange_y_.start);
-    point_min_ = point_min - offset;
-    point_center_ = point_center - offset;
-    point_max_ = point_max - offset;
-    Mat cropped_img = img(croprange_y_, croprange_x_);
-    DBG_WRITE_IMG("cropped_img.jpg", cropped_img);
 
-    // Create Gauge masks
-    CreateMask(cropped_img, big_mask_, big_radii_);
-    CreateMask(cropped_img, small_mask_, small_radii_);
-    bitwise_xor(big_mask_, small_mask_, global_mask_);
-    DBG_WRITE_IMG("mask_0_big.png", big_mask_);
-    DBG_WRITE_IMG("mask_1_small.png", small_mask_);
-    DBG_WRITE_IMG("mask_2_global.png", global_mask_);
+    return Rect(min_x, min_y, max_x - min_x, max_y - min_y);
+}
 
-    LOG_I(
-        "%s/%s: %sclockwise, img size: (%u, %u)",
-        __FILE__,
-        __FUNCTION__,
-        clockwise_ ? "" : "counter",
-        img_size_.width,
-        img_size_.height);
+/**
+ * brief Get the mask of the gauge annulus, where the needle is searched for.
+ *
+ * return The mask as an 8-bit image of the crop size, 255 within the annulus.
+ */
+Mat Gauge::GetGlobalMask() const
+{
+    Mat mask = Mat::zeros(needle_.size(), CV_8U);
+    for (auto y = needle_rows_.start; y < needle_rows_.end; y++)
+    {
+        const auto end = global_spans_.RowEnd(y);
+        for (auto s = global_spans_.RowBegin(y); s != end; s++)
+        {
+            mask.row(y).colRange(s->x_start, s->x_end).setTo(255);
+        }
+    }
+    return mask;
 }
 
-Gauge::~Gauge()
+/**
+ * brief Check whether the annulus of a crop differs from the last changed crop.
+ *
+ * A cheap test that lets the analysis be skipped while the gauge shows the
+ * same image. Changes accumulate until they pass the gate, so slow drifts of
+ * the needle or the light are not missed.
+ *
+ * param crop Gray image cropped to GetCropRect(), before any inversion.
+ * return True if the crop changed; it is then the new reference.
+ */
+bool Gauge::CropChanged(const Mat &crop)
 {
+    assert(crop.size() == needle_.size());
+    if (gate_crop_.empty())
+    {
+        crop.copyTo(gate_crop_);
+        return true;
+    }
+
+    auto changed = 0;
+    for (auto y = needle_rows_.start; y < needle_rows_.end && CHANGE_GATE_PIXELS >= changed; y++)
+    {
+        const auto pix = crop.ptr<uchar>(y);
+        const auto ref = gate_crop_.ptr<uchar>(y);
+        const auto end = global_spans_.RowEnd(y);
+        for (auto s = global_spans_.RowBegin(y); s != end; s++)
+        {
+            for (auto x = s->x_start; x < s->x_end; x++)
+            {
+                changed += CHANGE_GATE_LEVEL < abs(pix[x] - ref[x]);
+            }
+        }
+    }
+    if (CHANGE_GATE_PIXELS >= changed)
+    {
+        return false;
+    }
+    crop.copyTo(gate_crop_);
+    return true;
 }
 
-double Gauge::ComputeGaugeValue(const Mat &img) const
+/**
+ * brief Add the crop of a frame to the average that the gauge value is read from.
+ *
+ * Without averaging every frame is read directly. Otherwise the crops of
+ * average_frames_ frames are summed, and the gauge value is read from their
+ * average once all have been added.
+ *
+ * param crop Gray image cropped to GetCropRect().
+ * return True if the gauge value should be computed now.
+ */
+bool Gauge::AddCrop(const Mat &crop)
 {
-    // Make sure input image has the same size as the gague was set up for
-    assert(img.size() == img_size_);
+    assert(crop.size() == needle_.size());
+    if (1 == average_frames_)
+    {
+        return true;
+    }
 
-    // Use 2 matrices for work back and forth
-    Mat mat_a;
-    Mat mat_b;
+    if (0 == frames_added_)
+    {
+        crop.convertTo(frame_sum_, CV_16U);
+    }
+    else
+    {
+        add(frame_sum_, crop, frame_sum_, noArray(), CV_16U);
+    }
+    if (average_frames_ > ++frames_added_)
+    {
+        return false;
+    }
+    frame_sum_.convertTo(frame_average_, CV_8U, 1.0 / average_frames_);
+    frames_added_ = 0;
+    return true;
+}
 
-    // Crop
-    mat_a = img(croprange_y_, croprange_x_);
+/**
+ * brief Read the gauge value from the crop of a frame.
+ *
+ * param crop_img Gray image cropped to GetCropRect(); it is inverted in place
+ * if it is dark. Ignored when averaging, where the average is read instead.
+ * return Gauge value in percent, or -1 if the needle was not found.
+ */
+double Gauge::ComputeCropValue(const Mat &crop_img)
+{
+    // Make sure the crop has the same size as the gauge was set up for
+    assert(crop_img.size() == needle_.size());
+
+    // Use the average of the last frames, if averaging
+    Mat crop = 1 < average_frames_ ? frame_average_ : crop_img;
 
     // Always do dark check for handling shifting light conditions over time
-    if (IsDark(mat_a, big_mask_))
+    const auto dark = IsDark(crop, big_spans_);
+    if (dark)
     {
         // Invert
-        InvertImg(mat_a);
-    }
-    DBG_WRITE_IMG("compute_gauge_value_0_gray_after_dark.jpg", mat_a);
-
-    // Prepare image for contour detection
-    GaussianBlur(mat_a, mat_b, Size(5, 5), 0);
-    DBG_WRITE_IMG("compute_gauge_value_1_gaussian_blur.jpg", mat_b);
-    adaptiveThreshold(mat_b, mat_a, 255, ADAPTIVE_THRESH_GAUSSIAN_C, THRESH_BINARY, 11, 2);
-    InvertImg(mat_a);
-    DBG_WRITE_IMG("compute_gauge_value_2_invert.jpg", mat_a);
-    Mat kernel(2, 2, CV_8U, 1);
-    morphologyEx(mat_a, mat_b, MORPH_CLOSE, kernel);
-    DBG_WRITE_IMG("compute_gauge_value_3_morphology_ex.jpg", mat_b);
-    bitwise_and(mat_b, global_mask_, mat_a);
-    DBG_WRITE_IMG("compute_gauge_value_4_bitwise_and.jpg", mat_a);
+        InvertImg(crop);
+    }
+    if (background_model_ && dark != background_dark_)
+    {
+        // The background was learned from images that were not inverted
+        // the same way
+        background_learned_.setTo(0);
+        background_dark_ = dark;
+    }
+    DBG_WRITE_IMG("compute_gauge_value_0_gray_after_dark.jpg", crop);
 
     Point pointer_edge;
-    if (!ContourEdgePoint(mat_a, pointer_edge))
+    const auto found = FindNeedle(crop, pointer_edge);
+    preprocess_frames_++;
+    if (nullptr != capture_ && capture_->Enabled())
+    {
+        capture_->Capture(crop, scratch_.blurred, scratch_rows_.start, needle_);
+        if (!found)
+        {
+            capture_->Trigger("needle not found");
+        }
+    }
+    if (!found)
     {
         LOG_E("%s/%s: ContourEdgePoint FAILED", __FILE__, __FUNCTION__);
         return -1;
     }
+    // Learn only from frames where the needle is surely where it was found,
+    // so a misdetection does not teach the model the real needle
+    if (background_model_ && 0 == frames_since_full_scan_ && BACKGROUND_MIN_CONFIDENCE <= confidence_)
+    {
+        UpdateBackground(crop, pointer_edge);
+    }
 
     // Calculate and return value (percent)
     const auto angle_pointer = GetDegree(point_center_, pointer_edge);
@@ -157,6 +392,176 @@ double Gauge::ComputeGaugeValue(const Mat &img) const
     return 100 * min_pointer_angle / angle_min_max_;
 }
 
+/**
+ * brief Copy the analysis images of each frame to a debug capture ring.
+ *
+ * param capture Capture ring, or nullptr to stop capturing.
+ */
+void Gauge::SetDebugCapture(DebugCapture *capture)
+{
+    capture_ = capture;
+    if (nullptr != capture_)
+    {
+        capture_->Configure(needle_.size());
+    }
+}
+
+/**
+ * brief Split the preprocessing of each frame into row bands run by a worker pool.
+ *
+ * param pool Worker pool, or nullptr to preprocess on the calling thread only.
+ */
+void Gauge::SetWorkerPool(WorkerPool *pool)
+{
+    pool_ = pool;
+    band_scratch_.resize(nullptr != pool_ ? pool_->GetThreads() - 1 : 0);
+    for (auto &scratch : band_scratch_)
+    {
+        AllocateScratch(scratch);
+    }
+}
+
+/**
+ * brief Change the tracking window.
+ *
+ * param tracking_window Half-width of the tracking window (degrees), or 0 to
+ * search the whole gauge in every frame.
+ */
+void Gauge::SetTrackingWindow(const double tracking_window)
+{
+    assert(TRACKING_MAX_WINDOW > tracking_window);
+    if (tracking_window != tracking_window_)
+    {
+        tracking_window_ = tracking_window;
+        tracking_ = tracking_ && 0 < tracking_window_;
+    }
+}
+
+/**
+ * brief Find the needle tip, searching around the last needle angle if possible.
+ *
+ * When tracking is enabled and the needle was found in the previous frame,
+ * only a window of +/- tracking_window_ degrees around the last needle angle
+ * is preprocessed and searched. If the needle is not found well inside the
+ * window, the window is doubled, and when it grows too large a full scan of
+ * the gauge is done instead. A full scan is also done every tracking_rescan_
+ * frames to verify the tracked needle.
+ *
+ * param crop Cropped gray image, possibly inverted by the dark check.
+ * param pointer_edge Needle tip, in crop coordinates.
+ * return True if the needle was found.
+ */
+bool Gauge::FindNeedle(const Mat &crop, Point &pointer_edge)
+{
+    const auto full_scan_due = 0 < tracking_rescan_ && tracking_rescan_ <= frames_since_full_scan_;
+    if (0 < tracking_window_ && tracking_ && !full_scan_due)
+    {
+        for (auto window = tracking_window_; TRACKING_MAX_WINDOW > window; window *= 2)
+        {
+            if (!BuildWindowMask(tracked_angle_ - window, tracked_angle_ + window))
+            {
+                break;
+            }
+            PreprocessRows(crop, window_rows_, window_bits_);
+            if (!ContourEdgePoint(needle_, pointer_edge))
+            {
+                continue;
+            }
+            const auto angle = GetDegree(point_center_, pointer_edge);
+            if (TRACKING_WINDOW_MARGIN * window > fabs(remainder(angle - tracked_angle_, 360.0)))
+            {
+                if (tracking_window_ == window)
+                {
+                    tracking_stats_.hits++;
+                }
+                else
+                {
+                    tracking_stats_.widened++;
+                }
+                tracked_angle_ = angle;
+                frames_since_full_scan_++;
+                return true;
+            }
+        }
+        tracking_stats_.misses++;
+    }
+
+    tracking_stats_.full_scans++;
+    frames_since_full_scan_ = 0;
+    PreprocessRows(crop, needle_rows_, mask_bits_);
+    DBG_WRITE_IMG("compute_gauge_value_1_gaussian_blur.jpg", scratch_.blurred);
+    DBG_WRITE_IMG("compute_gauge_value_2_invert.jpg", UnpackBits(scratch_.thresh_bits));
+    DBG_WRITE_IMG("compute_gauge_value_3_morphology_ex.jpg", UnpackBits(scratch_.dilated_bits));
+    DBG_WRITE_IMG("compute_gauge_value_4_bitwise_and.jpg", needle_);
+    tracking_ = ContourEdgePoint(needle_, pointer_edge);
+    if (tracking_)
+    {
+        tracked_angle_ = GetDegree(point_center_, pointer_edge);
+    }
+    return tracking_;
+}
+
+/**
+ * brief Pack the part of the global mask that lies within an angular window.
+ *
+ * The window must be narrower than 180 degrees, which makes it the convex
+ * intersection of two half-planes through the gauge center. Each row of the
+ * window is then a single interval that is cut out of the mask spans.
+ *
+ * param angle_start Start angle of the window, in degrees.
+ * param angle_end End angle of the window, in degrees.
+ * return False if the window does not cover any part of the mask.
+ */
+bool Gauge::BuildWindowMask(const double angle_start, const double angle_end)
+{
+    const auto a0 = angle_start * M_PI / 180;
+    const auto a1 = angle_end * M_PI / 180;
+    const auto d0x = cos(a0);
+    const auto d0y = sin(a0);
+    const auto d1x = cos(a1);
+    const auto d1y = sin(a1);
+
+    auto first_row = -1;
+    auto last_row = -1;
+    for (auto y = needle_rows_.start; y < needle_rows_.end; y++)
+    {
+        auto words = &window_bits_[(y - needle_rows_.start) * words_per_row_];
+        // Pixel offsets (dx, dy) in the window have cross(d0, d) >= 0 and
+        // cross(d, d1) >= 0
+        const double dy = y - point_center_.y;
+        double lo = -point_center_.x - 1;
+        double hi = needle_.cols - point_center_.x;
+        if (!ClipHalfPlane(-d0y, d0x * dy, lo, hi) || !ClipHalfPlane(d1y, -d1x * dy, lo, hi))
+        {
+            memset(words, 0, words_per_row_ * sizeof(uint64_t));
+            continue;
+        }
+        // Allow one pixel of slack for rounding
+        const int x_start = floor(point_center_.x + lo) - 1;
+        const int x_end = ceil(point_center_.x + hi) + 2;
+        global_spans_.PackRow(words, y, words_per_row_, x_start, x_end);
+        uint64_t any = 0;
+        for (auto w = 0; w < words_per_row_; w++)
+        {
+            any |= words[w];
+        }
+        if (0 != any)
+        {
+            if (0 > first_row)
+            {
+                first_row = y;
+            }
+            last_row = y;
+        }
+    }
+    if (0 > first_row)
+    {
+        return false;
+    }
+    window_rows_ = Range(first_row, last_row + 1);
+    return true;
+}
+
 double Gauge::EuclidianDistance(const Point &a, const Point &b) const
 {
     const Point dp = a - b;
@@ -174,27 +579,19 @@ double Gauge::GetDegree(const Point &origo, const Point &point) const
     return angle;
 }
 
-bool Gauge::IsDark(const Mat &img, const Mat &mask) const
+bool Gauge::IsDark(const Mat &img, const MaskSpans &mask) const
 {
     unsigned int number_of_light_pix = 0;
-    unsigned int number_of_dark_pix = 0;
-    for (auto i = 0; i < img.rows; i++)
+    for (auto y = mask.Rows().start; y < mask.Rows().end; y++)
     {
-        for (auto j = 0; j < img.cols; j++)
+        const auto p = img.ptr<uchar>(y);
+        const auto end = mask.RowEnd(y);
+        for (auto s = mask.RowBegin(y); s != end; s++)
         {
-            if (255 == mask.at<uchar>(i, j))
-            {
-                if (100 < img.at<uchar>(i, j))
-                {
-                    number_of_light_pix++;
-                }
-                else
-                {
-                    number_of_dark_pix++;
-                }
-            }
+            number_of_light_pix += PixelKernels::CountLight(p + s->x_start, s->x_end - s->x_start, 100);
         }
     }
+    const unsigned int number_of_dark_pix = mask.Pixels() - number_of_light_pix;
 
     return number_of_light_pix < number_of_dark_pix;
 }
@@ -209,9 +606,9 @@ double Gauge::AngleDifference(const double base_point, const double mesh_point)
     return angle > 0 ? angle : angle + 360;
 }
 
-void Gauge::CreateMask(const Mat &img, Mat &mask, const unsigned int radii) const
+void Gauge::CreateMask(const Size &size, Mat &mask, const unsigned int radii) const
 {
-    mask = Mat::zeros(img.size(), CV_8U);
+    mask = Mat::zeros(size, CV_8U);
     double ellipse_min = angle_min_ - 10;
     double ellipse_max = angle_max_ + 10;
     if (clockwise_ && ellipse_max < ellipse_min)
@@ -228,11 +625,313 @@ void Gauge::CreateMask(const Mat &img, Mat &mask, const unsigned int radii) cons
 
 inline void Gauge::InvertImg(Mat &img) const
 {
-    img.forEach<Point_<uchar>>(
-        [&img](Point_<uchar> &, const int *position) -> void { img.at<uchar>(position) ^= 0xff; });
+    // A cropped image is not continuous, so invert it row by row
+    if (img.isContinuous())
+    {
+        PixelKernels::InvertRow(img.ptr<uchar>(0), img.total());
+        return;
+    }
+    for (auto i = 0; i < img.rows; i++)
+    {
+        PixelKernels::InvertRow(img.ptr<uchar>(i), img.cols);
+    }
+}
+
+/**
+ * brief Turn the cropped gray image into the binary image of needle candidates.
+ *
+ * Gives the same result as running GaussianBlur(), adaptiveThreshold(),
+ * inversion, a 2x2 MORPH_CLOSE and a bitwise AND with the global mask over the
+ * whole crop, but only for the rows covered by the global mask. Those rows are
+ * processed in tiles of PREPROCESS_TILE_ROWS that run through all stages
+ * before the next tile is started. The blur and the threshold mean work on row
+ * ranges of the scratch images, which lets OpenCV read the rows around a tile
+ * from the scratch image instead of treating the tile edges as image borders.
+ * The blur therefore runs THRESH_HALO rows ahead of the threshold, and the
+ * threshold starts CLOSE_HALO rows above the first needle row.
+ *
+ * Once thresholded the image is binary and kept packed, 64 pixels per word,
+ * with bit b of word w holding pixel 64 * w + b. The inversion after the
+ * threshold is folded into the comparison (same as THRESH_BINARY_INV). The
+ * close, done by OpenCV with the anchor in the lower right corner of the 2x2
+ * kernel, becomes a per-word OR (dilate) and AND (erode) of the current and
+ * the previous row and of each pixel and its left neighbour. Outside the
+ * image, dilate sees zeros and erode sees ones, like OpenCV's default
+ * morphology border. Only the final rows are unpacked for findContours().
+ *
+ * param crop Cropped gray image, possibly inverted by the dark check.
+ * param rows Rows to produce, within the global mask rows.
+ * param mask Packed mask, with one row for each global mask row.
+ */
+void Gauge::PreprocessRows(const Mat &crop, const Range &rows, const vector<uint64_t> &mask)
+{
+    assert(needle_rows_.start <= rows.start && needle_rows_.end >= rows.end);
+    const auto start = getTickCount();
+
+    // Clear rows produced for an earlier, different set of rows
+    if (needle_written_ != rows)
+    {
+        needle_.rowRange(needle_written_).setTo(0);
+        needle_written_ = rows;
+    }
+
+    const auto bands = nullptr != pool_ ? min<int>(pool_->GetThreads(), rows.size() / PREPROCESS_MIN_BAND_ROWS) : 1;
+    if (1 >= bands)
+    {
+        PreprocessBand(crop, rows, mask, scratch_);
+    }
+    else
+    {
+        // Band 0 is run by the calling thread in the shared scratch
+        const auto band_rows = [&rows, bands](const int band)
+        {
+            return Range(rows.start + rows.size() * band / bands, rows.start + rows.size() * (band + 1) / bands);
+        };
+        pool_->Run(
+            bands,
+            [&](const unsigned int band)
+            { PreprocessBand(crop, band_rows(band), mask, 0 == band ? scratch_ : band_scratch_[band - 1]); });
+
+        // Gather the rows of the other bands in the shared scratch, where the
+        // debug images are taken from
+        const auto s0 = scratch_rows_.start;
+        const auto wpr = words_per_row_;
+        for (auto band = 1; band < bands; band++)
+        {
+            const auto &scratch = band_scratch_[band - 1];
+            const auto r = band_rows(band);
+            const Range br(r.start - s0, min(r.end + THRESH_HALO, scratch_rows_.end) - s0);
+            scratch.blurred.rowRange(br).copyTo(scratch_.blurred.rowRange(br));
+            copy(
+                scratch.thresh_bits.begin() + (r.start - s0) * wpr,
+                scratch.thresh_bits.begin() + (r.end - s0) * wpr,
+                scratch_.thresh_bits.begin() + (r.start - s0) * wpr);
+            copy(
+                scratch.dilated_bits.begin() + (r.start - s0) * wpr,
+                scratch.dilated_bits.begin() + (r.end - s0) * wpr,
+                scratch_.dilated_bits.begin() + (r.start - s0) * wpr);
+        }
+    }
+
+    preprocess_us_ += 1e6 * (getTickCount() - start) / getTickFrequency();
+}
+
+/**
+ * brief Preprocess a band of rows using the given scratch images.
+ *
+ * Every stage reads only the crop and rows that the band itself produced, so
+ * a band gives the same rows whether it runs alone or next to other bands.
+ * The rows around the band that the threshold window and the close read are
+ * recomputed by the band.
+ *
+ * param crop Cropped gray image, possibly inverted by the dark check.
+ * param rows Rows to produce, within the global mask rows.
+ * param mask Packed mask, with one row for each global mask row.
+ * param scratch Scratch images, written only by this band.
+ */
+void Gauge::PreprocessBand(const Mat &crop, const Range &rows, const vector<uint64_t> &mask, PreprocessScratch &scratch)
+{
+    const auto s0 = scratch_rows_.start;
+    const auto wpr = words_per_row_;
+
+    const auto thresh_start = max(0, rows.start - CLOSE_HALO);
+    auto blur_end = max(0, thresh_start - THRESH_HALO);
+    for (auto t = thresh_start; t < rows.end; t += PREPROCESS_TILE_ROWS)
+    {
+        const auto t_end = min(t + PREPROCESS_TILE_ROWS, rows.end);
+
+        // Blur ahead of the threshold by the radius of its window
+        const auto b_end = min(t_end + THRESH_HALO, scratch_rows_.end);
+        if (blur_end < b_end)
+        {
+            const Range br(blur_end - s0, b_end - s0);
+            GaussianBlur(
+                crop.rowRange(blur_end, b_end),
+                scratch.blurred.rowRange(br),
+                Size(BLUR_KSIZE, BLUR_KSIZE),
+                0);
+            scratch.blurred.rowRange(br).convertTo(scratch.blurred_f.rowRange(br), CV_32F);
+            blur_end = b_end;
+        }
+
+        // Gaussian adaptive threshold, computed the way adaptiveThreshold()
+        // does it internally, emitting packed words
+        const Range tr(t - s0, t_end - s0);
+        GaussianBlur(
+            scratch.blurred_f.rowRange(tr),
+            scratch.mean_f.rowRange(tr),
+            Size(THRESH_BLOCKSIZE, THRESH_BLOCKSIZE),
+            0,
+            0,
+            BORDER_REPLICATE);
+        scratch.mean_f.rowRange(tr).convertTo(scratch.mean.rowRange(tr), CV_8U);
+        for (auto y = tr.start; y < tr.end; y++)
+        {
+            const auto blurred = scratch.blurred.ptr<uchar>(y);
+            const auto mean = scratch.mean.ptr<uchar>(y);
+            auto bits = &scratch.thresh_bits[y * wpr];
+            for (auto w = 0; w < wpr; w++)
+            {
+                const auto x0 = w * 64;
+                const auto n = min(64, scratch.blurred.cols - x0);
+                uint64_t word = 0;
+                for (auto b = 0; b < n; b++)
+                {
+                    word |= static_cast<uint64_t>(blurred[x0 + b] - mean[x0 + b] <= -THRESH_C) << b;
+                }
+                bits[w] = word;
+            }
+        }
+
+        // Dilate
+        for (auto y = max(t, rows.start - 1); y < t_end; y++)
+        {
+            const auto cur = &scratch.thresh_bits[(y - s0) * wpr];
+            const auto above = 0 < y ? &scratch.thresh_bits[(y - 1 - s0) * wpr] : nullptr;
+            auto out = &scratch.dilated_bits[(y - s0) * wpr];
+            uint64_t carry = 0;
+            for (auto w = 0; w < wpr; w++)
+            {
+                const auto v = cur[w] | (nullptr != above ? above[w] : 0);
+                out[w] = v | (v << 1) | carry;
+                carry = v >> 63;
+            }
+        }
+
+        // Erode, mask and unpack
+        for (auto y = max(t, rows.start); y < t_end; y++)
+        {
+            const auto cur = &scratch.dilated_bits[(y - s0) * wpr];
+            const auto above = 0 < y ? &scratch.dilated_bits[(y - 1 - s0) * wpr] : nullptr;
+            const auto mask_row = &mask[(y - needle_rows_.start) * wpr];
+            auto row = needle_.ptr<uchar>(y);
+            uint64_t carry = 1;
+            for (auto w = 0; w < wpr; w++)
+            {
+                const auto v = cur[w] & (nullptr != above ? above[w] : ~0ULL);
+                auto word = v & ((v << 1) | carry) & mask_row[w];
+                carry = v >> 63;
+                const auto x0 = w * 64;
+                if (background_model_)
+                {
+                    // Drop candidate pixels that match the learned dial face
+                    const auto pix = crop.ptr<uchar>(y);
+                    const auto background = background_.ptr<uint16_t>(y);
+                    const auto learned = background_learned_.ptr<uchar>(y);
+                    for (auto bits = word; 0 != bits; bits &= bits - 1)
+                    {
+                        const auto x = x0 + __builtin_ctzll(bits);
+                        if (BACKGROUND_LEARN_FRAMES <= learned[x] &&
+                            (BACKGROUND_THRESHOLD << BACKGROUND_SHIFT) >
+                                abs((pix[x] << BACKGROUND_SHIFT) - static_cast<int>(background[x])))
+                        {
+                            word &= ~(1ULL << (x - x0));
+                        }
+                    }
+                }
+                const auto n = min(64, needle_.cols - x0);
+                for (auto b = 0; b < n; b++)
+                {
+                    row[x0 + b] = ((word >> b) & 1) * 255;
+                }
+            }
+        }
+    }
 }
 
-bool Gauge::ContourEdgePoint(const Mat &img, Point &edge_point) const
+/**
+ * brief Update the background model of the annulus with the current frame.
+ *
+ * The model is a running average of each annulus pixel, in fixed point. It is
+ * not updated in a wedge around the needle, so that it learns the dial face
+ * wherever the needle is not, and adapts slowly to changing light. Each call
+ * only updates every BACKGROUND_ROW_PHASES:th row, in turn.
+ *
+ * param crop Cropped gray image, possibly inverted by the dark check.
+ * param pointer_edge Needle tip found in the image, in crop coordinates.
+ */
+void Gauge::UpdateBackground(const Mat &crop, const Point &pointer_edge)
+{
+    // A pixel at (dx, dy) from the center is within the wedge if the angle to
+    // the needle direction (nx, ny) is less than the wedge half-width; in
+    // integers, with the squared cosine in 10 fraction bits
+    const int64_t nx = pointer_edge.x - point_center_.x;
+    const int64_t ny = pointer_edge.y - point_center_.y;
+    const auto cos_wedge = cos(BACKGROUND_NEEDLE_WEDGE * M_PI / 180);
+    const auto cos2_norm = llround(1024 * cos_wedge * cos_wedge) * (nx * nx + ny * ny);
+    const auto half = 1 << (BACKGROUND_RATE_SHIFT - 1);
+
+    const int phase = background_phase_;
+    background_phase_ = (background_phase_ + 1) % BACKGROUND_ROW_PHASES;
+    for (auto y = needle_rows_.start + phase; y < needle_rows_.end; y += BACKGROUND_ROW_PHASES)
+    {
+        const auto pix = crop.ptr<uchar>(y);
+        auto background = background_.ptr<uint16_t>(y);
+        auto learned = background_learned_.ptr<uchar>(y);
+        const int64_t dy = y - point_center_.y;
+        const auto end = global_spans_.RowEnd(y);
+        for (auto s = global_spans_.RowBegin(y); s != end; s++)
+        {
+            for (auto x = s->x_start; x < s->x_end; x++)
+            {
+                const int64_t dx = x - point_center_.x;
+                const auto dot = dx * nx + dy * ny;
+                if (0 < dot && 1024 * dot * dot > cos2_norm * (dx * dx + dy * dy))
+                {
+                    continue;
+                }
+                const int value = pix[x] << BACKGROUND_SHIFT;
+                if (0 == learned[x])
+                {
+                    background[x] = value;
+                }
+                else
+                {
+                    // Rounded to nearest, the same way up and down
+                    const int delta = value - background[x];
+                    background[x] += 0 <= delta ? (delta + half) >> BACKGROUND_RATE_SHIFT
+                                                : -((half - delta) >> BACKGROUND_RATE_SHIFT);
+                }
+                if (BACKGROUND_LEARN_FRAMES > learned[x])
+                {
+                    learned[x]++;
+                }
+            }
+        }
+    }
+}
+
+/**
+ * brief Allocate scratch images that hold the rows scratch_rows_.
+ */
+void Gauge::AllocateScratch(PreprocessScratch &scratch) const
+{
+    scratch.blurred = Mat(scratch_rows_.size(), needle_.cols, CV_8U);
+    scratch.blurred_f = Mat(scratch_rows_.size(), needle_.cols, CV_32F);
+    scratch.mean_f = Mat(scratch_rows_.size(), needle_.cols, CV_32F);
+    scratch.mean = Mat(scratch_rows_.size(), needle_.cols, CV_8U);
+    scratch.thresh_bits.resize(scratch_rows_.size() * words_per_row_);
+    scratch.dilated_bits.resize(scratch_rows_.size() * words_per_row_);
+}
+
+/**
+ * brief Unpack packed scratch rows to an 8-bit image, for debugging.
+ */
+Mat Gauge::UnpackBits(const vector<uint64_t> &bits) const
+{
+    Mat img(scratch_rows_.size(), needle_.cols, CV_8U);
+    for (auto y = 0; y < img.rows; y++)
+    {
+        auto row = img.ptr<uchar>(y);
+        for (auto x = 0; x < img.cols; x++)
+        {
+            row[x] = ((bits[y * words_per_row_ + x / 64] >> (x % 64)) & 1) * 255;
+        }
+    }
+    return img;
+}
+
+bool Gauge::ContourEdgePoint(const Mat &img, Point &edge_point)
 {
     vector<vector<Point>> cnts;
     vector<Vec4i> hierarchy;
@@ -271,9 +970,18 @@ bool Gauge::ContourEdgePoint(const Mat &img, Point &edge_point) const
             }
             // Maps sort the largest key values at the end
             edge_point = distances.rbegin()->second;
+
+            // Confidence: how much of the annulus the contour spans, and how
+            // much it dominates the largest other contour
+            const auto span = (distances.rbegin()->first - distances.begin()->first) / (big_radii_ - small_radii_);
+            const auto area = contourArea(cnts.at(i), false);
+            const auto other_area = 0 < i ? contourArea(cnts.at(0), false)
+                                          : (1 < cnts.size() ? contourArea(cnts.at(1), false) : 0);
+            confidence_ = min(1.0, span) * (0 < area ? area / (area + other_area) : 0);
             return true;
         }
     }
 
+    confidence_ = 0;
     return false;
 }
@@ -0,0 +1,185 @@
+/**
+ * Copyright (C) 2025, Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * This file implements the local export of the reading history.
+ */
+
+#include <assert.h>
+#include <string.h>
+#include <vector>
+
+#include "HistoryExport.hpp"
+#include "common.hpp"
+
+using namespace std;
+
+#define HISTORY_EXPORT_THREADS (2)
+// Readings taken from the history and written at a time
+#define HISTORY_EXPORT_CHUNK (4096)
+#define HISTORY_EXPORT_PATH "/history"
+
+static const char *status_names[NUM_HISTORY_STATUSES] = {"good", "rejected", "failed"};
+
+HistoryExport::HistoryExport(ReadingHistory &history) : history_(history), service_(nullptr)
+{
+}
+
+HistoryExport::~HistoryExport()
+{
+    if (nullptr != service_)
+    {
+        g_socket_service_stop(service_);
+        g_object_unref(service_);
+    }
+}
+
+/**
+ * brief Start serving on the loopback interface.
+ *
+ * param port Local port to listen on.
+ * return False if any errors occur, otherwise true.
+ */
+bool HistoryExport::Start(const unsigned int port)
+{
+    assert(nullptr == service_);
+    g_autoptr(GError) error = nullptr;
+    service_ = g_threaded_socket_service_new(HISTORY_EXPORT_THREADS);
+    auto address = g_inet_socket_address_new_from_string("127.0.0.1", port);
+    const auto added = g_socket_listener_add_address(
+        G_SOCKET_LISTENER(service_),
+        address,
+        G_SOCKET_TYPE_STREAM,
+        G_SOCKET_PROTOCOL_TCP,
+        nullptr,
+        nullptr,
+        &error);
+    g_object_unref(address);
+    if (!added)
+    {
+        LOG_E("%s/%s: Failed to listen on port %u (%s)", __FILE__, __FUNCTION__, port, error->message);
+        g_object_unref(service_);
+        service_ = nullptr;
+        return false;
+    }
+    g_signal_connect(service_, "run", G_CALLBACK(HandleConnection), this);
+    g_socket_service_start(service_);
+    LOG_I("%s/%s: History export on port %u", __FILE__, __FUNCTION__, port);
+
+    return true;
+}
+
+/**
+ * brief Answer one HTTP request, on a thread of the service.
+ */
+gboolean HistoryExport::HandleConnection(
+    GThreadedSocketService *service,
+    GSocketConnection *connection,
+    GObject *source_object,
+    gpointer user_data)
+{
+    (void)service;
+    (void)source_object;
+    auto parent = static_cast<HistoryExport *>(user_data);
+    assert(nullptr != parent);
+    auto in = g_data_input_stream_new(g_io_stream_get_input_stream(G_IO_STREAM(connection)));
+    auto request = g_data_input_stream_read_line(in, nullptr, nullptr, nullptr);
+    // Skip the headers, up to and including the blank line
+    auto line = g_data_input_stream_read_line(in, nullptr, nullptr, nullptr);
+    while (nullptr != line && '\r' != line[0] && '\0' != line[0])
+    {
+        g_free(line);
+        line = g_data_input_stream_read_line(in, nullptr, nullptr, nullptr);
+    }
+    g_free(line);
+    parent->Serve(request, g_io_stream_get_output_stream(G_IO_STREAM(connection)));
+    g_free(request);
+    g_object_unref(in);
+
+    return TRUE;
+}
+
+void HistoryExport::Serve(const gchar *request, GOutputStream *out)
+{
+    // The reverse proxy passes on the whole path, /local/<app>/history
+    gchar target[1024];
+    if (nullptr == request || 1 != sscanf(request, "GET %1023s HTTP/", target))
+    {
+        const auto response = "HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+        g_output_stream_write_all(out, response, strlen(response), nullptr, nullptr, nullptr);
+        return;
+    }
+    auto query = strchr(target, '?');
+    if (nullptr != query)
+    {
+        *query++ = '\0';
+    }
+    if (!g_str_has_suffix(target, HISTORY_EXPORT_PATH))
+    {
+        const auto response = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+        g_output_stream_write_all(out, response, strlen(response), nullptr, nullptr, nullptr);
+        return;
+    }
+
+    gint64 from_ms = 0;
+    gint64 to_ms = G_MAXINT64;
+    guint64 limit = G_MAXUINT64;
+    auto params = nullptr != query ? g_uri_parse_params(query, -1, "&", G_URI_PARAMS_NONE, nullptr) : nullptr;
+    if (nullptr != params)
+    {
+        const auto from = static_cast<const gchar *>(g_hash_table_lookup(params, "from"));
+        const auto to = static_cast<const gchar *>(g_hash_table_lookup(params, "to"));
+        const auto max = static_cast<const gchar *>(g_hash_table_lookup(params, "limit"));
+        from_ms = nullptr != from ? g_ascii_strtoll(from, nullptr, 10) : from_ms;
+        to_ms = nullptr != to ? g_ascii_strtoll(to, nullptr, 10) : to_ms;
+        limit = nullptr != max ? g_ascii_strtoull(max, nullptr, 10) : limit;
+        g_hash_table_unref(params);
+    }
+
+    // No length ahead; the end of the connection ends the readings
+    const auto header = "HTTP/1.1 200 OK\r\nContent-Type: text/csv\r\nConnection: close\r\n\r\ntime_ms,value,status\n";
+    auto ok = g_output_stream_write_all(out, header, strlen(header), nullptr, nullptr, nullptr);
+    vector<HistoryReading> readings;
+    auto text = g_string_new(nullptr);
+    while (ok && 0 < limit && from_ms <= to_ms)
+    {
+        readings.clear();
+        if (0 == history_.Query(from_ms, to_ms, MIN(limit, HISTORY_EXPORT_CHUNK), readings))
+        {
+            break;
+        }
+        g_string_truncate(text, 0);
+        for (const auto &reading : readings)
+        {
+            g_string_append_printf(
+                text,
+                "%" G_GINT64_FORMAT ",%.2f,%s\n",
+                static_cast<gint64>(reading.time_ms),
+                reading.value,
+                status_names[reading.status]);
+        }
+        ok = g_output_stream_write_all(out, text->str, text->len, nullptr, nullptr, nullptr);
+        limit -= readings.size();
+        // After the clock was set backwards the readings are not in time
+        // order; continuing after the latest one always moves forward
+        for (const auto &reading : readings)
+        {
+            from_ms = MAX(from_ms, reading.time_ms + 1);
+        }
+    }
+    g_string_free(text, TRUE);
+}
@@ -20,6 +20,8 @@
 
 #include <assert.h>
 #include <errno.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
 
 #pragma GCC diagnostic ignored "-Wunused-parameter"
 #include <vdo-channel.h>
@@ -30,6 +32,26 @@
 #include "common.hpp"
 
 #define VDO_CHANNEL (1)
+// Frames between resizes of the buffer pool
+#define VDO_RESIZE_PERIOD_FRAMES (150)
+// Buffers kept in VDO on top of the most held by the application at once
+#define VDO_BUFFER_HEADROOM (2)
+
+/**
+ * brief GSource dispatching a callback in the main loop when frames arrive.
+ *
+ * The source polls the eventfd that the fetcher thread signals for each
+ * delivered frame, so the main loop only wakes up when a frame is ready.
+ */
+struct FrameSource
+{
+    GSource source;
+    ImageProvider *provider;
+    gpointer fd_tag;
+};
+
+static GSourceFuncs frame_source_funcs =
+    {nullptr, nullptr, ImageProvider::FrameSourceDispatch, nullptr, nullptr, nullptr};
 
 /**
  * brief Find VDO resolution that best fits requirement.
@@ -143,6 +165,11 @@ bool ImageProvider::StopFrameFetch(ImageProvider &provider)
         return false;
     }
 
+    // Wake up anyone waiting for a frame that will never come
+    pthread_mutex_lock(&provider.frame_mutex_);
+    pthread_cond_broadcast(&provider.frame_deliver_cond_);
+    pthread_mutex_unlock(&provider.frame_mutex_);
+
     return true;
 }
 
@@ -170,6 +197,8 @@ bool ImageProvider::StopFrameFetch(ImageProvider &provider)
  *    there is at least numAppFrames buffers available to the client to
  *    fetch. If there are more than numAppFrames in delivered_frames we
  *    pick the first buffer (oldest) in the list and enqueue it to VDO.
+ * 5. Every VDO_RESIZE_PERIOD_FRAMES frames the number of buffers is adjusted
+ *    to the most that were held outside VDO at once, see ResizeVdoBuffers().
 
  * param data Pointer to ImageProvider owning thread.
  * return Pointer to unused return data.
@@ -203,11 +232,21 @@ ImageProvider::ImageProvider(
     const unsigned int height,
     const unsigned int num_frames,
     const VdoFormat format)
-    : delivered_frames_(g_queue_new()), processed_frames_(g_queue_new()), shutdown_(false), num_frames_(num_frames)
+    : delivered_frames_(g_queue_new()), processed_frames_(g_queue_new()), shutdown_(false), num_frames_(num_frames),
+      vdo_buffers_(), buffer_states_(), delivered_at_(), buffer_stats_(), window_frames_(0), window_max_held_(0),
+      window_starved_(0), pending_releases_(0), vdo_stream_(nullptr),
+      frame_eventfd_(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)), signalled_at_(0), frames_signalled_(0), wakeups_(0),
+      total_latency_us_(0), max_latency_us_(0)
 {
     assert(nullptr != delivered_frames_);
     assert(nullptr != processed_frames_);
 
+    if (0 > frame_eventfd_)
+    {
+        LOG_E("%s: Unable to create frame eventfd: %s", __func__, strerror(errno));
+        assert(false);
+    }
+
     if (pthread_mutex_init(&frame_mutex_, nullptr))
     {
         LOG_E("%s: Unable to initialize mutex: %s", __func__, strerror(errno));
@@ -274,6 +313,10 @@ ImageProvider::~ImageProvider()
     {
         g_queue_free(processed_frames_);
     }
+    if (0 <= frame_eventfd_)
+    {
+        close(frame_eventfd_);
+    }
 }
 
 /**
@@ -286,7 +329,11 @@ VdoBuffer *ImageProvider::GetLastFrameBlocking()
     VdoBuffer *returnBuf = nullptr;
     pthread_mutex_lock(&frame_mutex_);
 
-    while (1 > g_queue_get_length(delivered_frames_))
+    if (1 > g_queue_get_length(delivered_frames_))
+    {
+        buffer_stats_.consumer_waits++;
+    }
+    while (1 > g_queue_get_length(delivered_frames_) && !shutdown_)
     {
         if (pthread_cond_wait(&frame_deliver_cond_, &frame_mutex_))
         {
@@ -295,7 +342,12 @@ VdoBuffer *ImageProvider::GetLastFrameBlocking()
         }
     }
 
+    // Empty after a shutdown
     returnBuf = (VdoBuffer *)g_queue_pop_tail(delivered_frames_);
+    if (nullptr != returnBuf)
+    {
+        buffer_states_[FindBuffer(*returnBuf)] = BUFFER_CLIENT;
+    }
 
 error_exit:
     pthread_mutex_unlock(&frame_mutex_);
@@ -303,56 +355,219 @@ error_exit:
     return returnBuf;
 }
 
+/**
+ * brief Get the most recent frame the thread has fetched from VDO, if any.
+ *
+ * return Pointer to an image buffer, or nullptr if no frame is available.
+ */
+VdoBuffer *ImageProvider::GetLastFrame()
+{
+    pthread_mutex_lock(&frame_mutex_);
+    const auto returnBuf = static_cast<VdoBuffer *>(g_queue_pop_tail(delivered_frames_));
+    if (nullptr != returnBuf)
+    {
+        buffer_states_[FindBuffer(*returnBuf)] = BUFFER_CLIENT;
+    }
+    else
+    {
+        buffer_stats_.consumer_waits++;
+    }
+    pthread_mutex_unlock(&frame_mutex_);
+
+    return returnBuf;
+}
+
+/**
+ * brief Call a function from the default main context whenever frames arrive.
+ *
+ * The callback is dispatched once per wakeup, even if several frames arrived
+ * since the last dispatch, and should fetch frames with GetLastFrame(). Like
+ * for g_idle_add(), returning FALSE from the callback removes the source.
+ *
+ * param callback Function to call.
+ * param data Data to pass to callback.
+ * return ID of the source, 0 on failure.
+ */
+guint ImageProvider::AttachFrameSource(GSourceFunc callback, gpointer data)
+{
+    assert(nullptr != callback);
+    auto source = g_source_new(&frame_source_funcs, sizeof(FrameSource));
+    auto frame_source = reinterpret_cast<FrameSource *>(source);
+    frame_source->provider = this;
+    frame_source->fd_tag = g_source_add_unix_fd(source, frame_eventfd_, G_IO_IN);
+    g_source_set_callback(source, callback, data, nullptr);
+
+    // Frames signalled while no source was attached do not count
+    uint64_t count;
+    if (0 > read(frame_eventfd_, &count, sizeof(count)) && EAGAIN != errno)
+    {
+        LOG_I("%s: WARNING, failed reading frame eventfd: %s", __func__, strerror(errno));
+    }
+    signalled_at_ = 0;
+
+    g_source_set_name(source, "VDO frames");
+    const auto id = g_source_attach(source, nullptr);
+    g_source_unref(source);
+
+    return id;
+}
+
+gboolean ImageProvider::FrameSourceDispatch(GSource *source, GSourceFunc callback, gpointer data)
+{
+    auto frame_source = reinterpret_cast<FrameSource *>(source);
+    if (0 == (g_source_query_unix_fd(source, frame_source->fd_tag) & G_IO_IN))
+    {
+        return G_SOURCE_CONTINUE;
+    }
+    frame_source->provider->AcknowledgeFrames();
+    if (nullptr == callback)
+    {
+        return G_SOURCE_REMOVE;
+    }
+
+    return callback(data);
+}
+
+/**
+ * brief Wake up the frame source; called by the fetcher thread.
+ */
+void ImageProvider::SignalFrame()
+{
+    // Latency is measured from the oldest frame not yet dispatched
+    gint64 none = 0;
+    signalled_at_.compare_exchange_strong(none, g_get_monotonic_time());
+    frames_signalled_++;
+
+    const uint64_t one = 1;
+    if (sizeof(one) != write(frame_eventfd_, &one, sizeof(one)))
+    {
+        LOG_I("%s: WARNING, failed signalling frame: %s", __func__, strerror(errno));
+    }
+}
+
+/**
+ * brief Reset the eventfd and account for the wakeup; called by the main loop.
+ */
+void ImageProvider::AcknowledgeFrames()
+{
+    uint64_t count;
+    if (sizeof(count) != read(frame_eventfd_, &count, sizeof(count)) && EAGAIN != errno)
+    {
+        LOG_I("%s: WARNING, failed reading frame eventfd: %s", __func__, strerror(errno));
+    }
+
+    wakeups_++;
+    const auto signalled_at = signalled_at_.exchange(0);
+    if (0 < signalled_at)
+    {
+        const auto latency = g_get_monotonic_time() - signalled_at;
+        total_latency_us_ += latency;
+        max_latency_us_ = MAX(max_latency_us_, latency);
+    }
+}
+
 void ImageProvider::ReturnFrame(VdoBuffer &buffer)
 {
     pthread_mutex_lock(&frame_mutex_);
 
     g_queue_push_tail(processed_frames_, &buffer);
+    buffer_states_[FindBuffer(buffer)] = BUFFER_PROCESSED;
 
     pthread_mutex_unlock(&frame_mutex_);
 }
 
 bool ImageProvider::AllocateVdoBuffers()
 {
-    g_autoptr(GError) error = nullptr;
-
     for (size_t i = 0; NUM_VDO_BUFFERS > i; i++)
     {
-        vdo_buffers_[i] = vdo_stream_buffer_alloc(vdo_stream_, nullptr, &error);
-        if (vdo_buffers_[i] == nullptr)
+        if (!AddVdoBuffer())
         {
-            LOG_E(
-                "%s/%s: Failed creating VDO buffer: %s",
-                __FILE__,
-                __FUNCTION__,
-                (error != nullptr) ? error->message : "N/A");
             return false;
         }
+    }
 
-        // Make a 'speculative' vdo_buffer_get_data() call to trigger a
-        // memory mapping of the buffer. The mapping is cached in the VDO
-        // implementation.
-        const auto dummy_ptr = vdo_buffer_get_data(vdo_buffers_[i]);
-        if (nullptr == dummy_ptr)
-        {
-            LOG_E(
-                "%s/%s: Failed initializing buffer memmap: %s",
-                __FILE__,
-                __FUNCTION__,
-                (error != nullptr) ? error->message : "N/A");
-            return false;
-        }
+    return true;
+}
+
+/**
+ * brief Allocate a buffer, map it and enqueue it to VDO.
+ *
+ * return False if any errors occur or all slots are taken, otherwise true.
+ */
+bool ImageProvider::AddVdoBuffer()
+{
+    g_autoptr(GError) error = nullptr;
+
+    auto buffer = vdo_stream_buffer_alloc(vdo_stream_, nullptr, &error);
+    if (buffer == nullptr)
+    {
+        LOG_E(
+            "%s/%s: Failed creating VDO buffer: %s",
+            __FILE__,
+            __FUNCTION__,
+            (error != nullptr) ? error->message : "N/A");
+        return false;
+    }
+
+    // Make a 'speculative' vdo_buffer_get_data() call to trigger a
+    // memory mapping of the buffer. The mapping is cached in the VDO
+    // implementation.
+    const auto dummy_ptr = vdo_buffer_get_data(buffer);
+    if (nullptr == dummy_ptr)
+    {
+        LOG_E(
+            "%s/%s: Failed initializing buffer memmap: %s",
+            __FILE__,
+            __FUNCTION__,
+            (error != nullptr) ? error->message : "N/A");
+        vdo_stream_buffer_unref(vdo_stream_, &buffer, nullptr);
+        return false;
+    }
 
-        if (!vdo_stream_buffer_enqueue(vdo_stream_, vdo_buffers_[i], &error))
+    // The slots are read by the consumers, so they are only changed locked
+    pthread_mutex_lock(&frame_mutex_);
+    auto index = -1;
+    for (auto i = 0; 0 > index && MAX_VDO_BUFFERS > i; i++)
+    {
+        if (nullptr == vdo_buffers_[i])
         {
-            LOG_E("%s: Failed enqueue VDO buffer: %s", __func__, (error != nullptr) ? error->message : "N/A");
-            return false;
+            index = i;
+            vdo_buffers_[i] = buffer;
+            buffer_states_[i] = BUFFER_IN_VDO;
         }
     }
+    pthread_mutex_unlock(&frame_mutex_);
+    if (0 > index)
+    {
+        LOG_E("%s/%s: No free VDO buffer slot", __FILE__, __FUNCTION__);
+        vdo_stream_buffer_unref(vdo_stream_, &buffer, nullptr);
+        return false;
+    }
+
+    if (!vdo_stream_buffer_enqueue(vdo_stream_, buffer, &error))
+    {
+        LOG_E("%s: Failed enqueue VDO buffer: %s", __func__, (error != nullptr) ? error->message : "N/A");
+        pthread_mutex_lock(&frame_mutex_);
+        FreeVdoBuffer(index);
+        pthread_mutex_unlock(&frame_mutex_);
+        return false;
+    }
 
     return true;
 }
 
+/**
+ * brief Release a buffer VDO did not take back and free its slot; called with
+ *       frame_mutex_ held.
+ *
+ * param index Index into vdo_buffers_.
+ */
+void ImageProvider::FreeVdoBuffer(const int index)
+{
+    buffer_states_[index] = BUFFER_FREE;
+    vdo_stream_buffer_unref(vdo_stream_, &vdo_buffers_[index], nullptr);
+}
+
 void ImageProvider::ReleaseVdoBuffers()
 {
     if (nullptr == vdo_stream_)
@@ -360,15 +575,114 @@ void ImageProvider::ReleaseVdoBuffers()
         return;
     }
 
-    for (auto i = 0; i < NUM_VDO_BUFFERS; i++)
+    for (auto i = 0; i < MAX_VDO_BUFFERS; i++)
     {
         if (nullptr != vdo_buffers_[i])
         {
             vdo_stream_buffer_unref(vdo_stream_, &vdo_buffers_[i], nullptr);
+            buffer_states_[i] = BUFFER_FREE;
         }
     }
 }
 
+/**
+ * brief Find the slot of a buffer; called with frame_mutex_ held.
+ *
+ * param buffer Buffer allocated by AddVdoBuffer().
+ * return Index into vdo_buffers_.
+ */
+int ImageProvider::FindBuffer(const VdoBuffer &buffer) const
+{
+    auto index = 0;
+    while (MAX_VDO_BUFFERS - 1 > index && &buffer != vdo_buffers_[index])
+    {
+        index++;
+    }
+    assert(&buffer == vdo_buffers_[index]);
+
+    return index;
+}
+
+/**
+ * brief Count the buffers in a state; called with frame_mutex_ held.
+ *
+ * param state State to count.
+ * return Number of buffers, or of free slots for BUFFER_FREE.
+ */
+unsigned int ImageProvider::CountBuffers(const BufferState state) const
+{
+    auto count = 0U;
+    for (auto i = 0; MAX_VDO_BUFFERS > i; i++)
+    {
+        count += state == buffer_states_[i] ? 1 : 0;
+    }
+
+    return count;
+}
+
+/**
+ * brief Get the buffer states and the counters of the buffer flow.
+ *
+ * return Copy of the statistics.
+ */
+ImageProvider::BufferStats ImageProvider::GetBufferStats()
+{
+    pthread_mutex_lock(&frame_mutex_);
+    auto stats = buffer_stats_;
+    for (auto state = 0; NUM_BUFFER_STATES > state; state++)
+    {
+        stats.buffers[state] = CountBuffers(static_cast<BufferState>(state));
+    }
+    pthread_mutex_unlock(&frame_mutex_);
+
+    return stats;
+}
+
+/**
+ * brief Resize the buffer pool to the use measured since the last resize.
+ *
+ * The pool needs the most buffers the application held at once, delivered,
+ * taken or returned, plus VDO_BUFFER_HEADROOM for VDO to fill. It grows right
+ * away, by one more if VDO ran out of buffers, but shrinks by one buffer per
+ * period so that a short lull does not cost frames when the load comes back.
+ * Buffers are released as they come back from the application.
+ */
+void ImageProvider::ResizeVdoBuffers()
+{
+    pthread_mutex_lock(&frame_mutex_);
+    const auto buffers = MAX_VDO_BUFFERS - CountBuffers(BUFFER_FREE) - pending_releases_;
+    auto target = window_max_held_ + VDO_BUFFER_HEADROOM;
+    if (buffer_stats_.vdo_starved > window_starved_)
+    {
+        target = MAX(target, buffers + 1);
+    }
+    target = CLAMP(target, MIN_VDO_BUFFERS, MAX_VDO_BUFFERS);
+    window_frames_ = 0;
+    window_max_held_ = 0;
+    window_starved_ = buffer_stats_.vdo_starved;
+
+    auto add = 0U;
+    if (target > buffers)
+    {
+        // Keep buffers about to be released before allocating new ones
+        const auto keep = MIN(pending_releases_, target - buffers);
+        pending_releases_ -= keep;
+        add = target - buffers - keep;
+    }
+    else if (target < buffers)
+    {
+        pending_releases_++;
+    }
+    pthread_mutex_unlock(&frame_mutex_);
+
+    for (auto i = 0U; add > i && AddVdoBuffer(); i++)
+    {
+        pthread_mutex_lock(&frame_mutex_);
+        buffer_stats_.grown++;
+        pthread_mutex_unlock(&frame_mutex_);
+    }
+}
+
 void ImageProvider::RunLoopIteration()
 {
     g_autoptr(GError) error = nullptr;
@@ -384,6 +698,10 @@ void ImageProvider::RunLoopIteration()
     pthread_mutex_lock(&frame_mutex_);
 
     g_queue_push_tail(delivered_frames_, new_buffer);
+    const auto now = g_get_monotonic_time();
+    auto index = FindBuffer(*new_buffer);
+    buffer_states_[index] = BUFFER_DELIVERED;
+    delivered_at_[index] = now;
 
     VdoBuffer *old_buffer = nullptr;
 
@@ -401,21 +719,56 @@ void ImageProvider::RunLoopIteration()
         if (g_queue_get_length(delivered_frames_) > num_frames_)
         {
             old_buffer = static_cast<VdoBuffer *>(g_queue_pop_head(delivered_frames_));
+            buffer_stats_.drops++;
         }
     }
 
     if (old_buffer)
     {
+        index = FindBuffer(*old_buffer);
+        const auto latency = now - delivered_at_[index];
+        buffer_stats_.recycles++;
+        buffer_stats_.total_recycle_us += latency;
+        buffer_stats_.max_recycle_us = MAX(buffer_stats_.max_recycle_us, latency);
+    }
+    if (old_buffer && 0 < pending_releases_)
+    {
+        // Shrink the pool by not giving the buffer back to VDO
+        pending_releases_--;
+        buffer_stats_.shrunk++;
+        FreeVdoBuffer(index);
+    }
+    else if (old_buffer)
+    {
+        buffer_states_[index] = BUFFER_IN_VDO;
         if (!vdo_stream_buffer_enqueue(vdo_stream_, old_buffer, &error))
         {
-            // Fail but we continue anyway hoping for the best.
+            // Fail but we continue anyway hoping for the best. The slot is
+            // freed so the pool is grown again if VDO runs short.
             LOG_I(
                 "%s: WARNING, failed enqueueing buffer to vdo: %s",
                 __func__,
                 (error != nullptr) ? error->message : "N/A");
+            FreeVdoBuffer(index);
         }
     }
     g_object_unref(new_buffer); // Release the ref from vdo_stream_get_buffer
+
+    // VDO is starved when the application holds every buffer
+    const auto in_vdo = CountBuffers(BUFFER_IN_VDO);
+    if (0 == in_vdo)
+    {
+        buffer_stats_.vdo_starved++;
+    }
+    window_max_held_ = MAX(window_max_held_, MAX_VDO_BUFFERS - CountBuffers(BUFFER_FREE) - in_vdo);
+    const auto resize = VDO_RESIZE_PERIOD_FRAMES <= ++window_frames_;
+
     pthread_cond_signal(&frame_deliver_cond_);
     pthread_mutex_unlock(&frame_mutex_);
+    SignalFrame();
+
+    if (resize)
+    {
+        ResizeVdoBuffers();
+    }
 }
\ No newline at end of file
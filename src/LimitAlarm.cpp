@@ -0,0 +1,122 @@
+/**
+ * Copyright (C) 2025, Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * This file implements the limit alarm evaluated on the gauge readings.
+ */
+
+#include <assert.h>
+#include <cmath>
+
+#include "LimitAlarm.hpp"
+
+LimitAlarm::LimitAlarm()
+    : high_{NAN, NAN}, low_{NAN, NAN}, deadband_(0), delay_us_(0), state_(LIMIT_NORMAL), pending_(LIMIT_NORMAL),
+      pending_since_us_(0)
+{
+}
+
+/**
+ * brief Set one of the limits.
+ *
+ * param limit LIMIT_HIGHHIGH, LIMIT_HIGH, LIMIT_LOW or LIMIT_LOWLOW.
+ * param value Limit, NAN to turn it off.
+ */
+void LimitAlarm::SetLimit(const LimitState limit, const double value)
+{
+    assert(LIMIT_NORMAL != limit);
+    if (LIMIT_NORMAL < limit)
+    {
+        high_[limit - 1] = value;
+    }
+    else
+    {
+        low_[-limit - 1] = value;
+    }
+}
+
+double LimitAlarm::GetLimit(const LimitState limit) const
+{
+    assert(LIMIT_NORMAL != limit);
+    return LIMIT_NORMAL < limit ? high_[limit - 1] : low_[-limit - 1];
+}
+
+void LimitAlarm::SetDeadband(const double deadband)
+{
+    assert(0 <= deadband);
+    deadband_ = deadband;
+}
+
+void LimitAlarm::SetDelay(const unsigned int delay_s)
+{
+    delay_us_ = static_cast<int64_t>(delay_s) * 1000000;
+}
+
+/**
+ * brief The most severe limit exceeded by a value, from the current state.
+ *
+ * param value Value.
+ *
+ * return State for the value.
+ */
+LimitState LimitAlarm::Classify(const double value) const
+{
+    for (auto level = 2; 0 < level; level--)
+    {
+        // Limits already exceeded are only left by the deadband
+        const auto high = high_[level - 1];
+        if (!std::isnan(high) && value >= high - (state_ >= level ? deadband_ : 0))
+        {
+            return static_cast<LimitState>(level);
+        }
+        const auto low = low_[level - 1];
+        if (!std::isnan(low) && value <= low + (state_ <= -level ? deadband_ : 0))
+        {
+            return static_cast<LimitState>(-level);
+        }
+    }
+    return LIMIT_NORMAL;
+}
+
+/**
+ * brief Evaluate the alarm against a new value.
+ *
+ * param time_us Monotonic time of the value (µs).
+ * param value Value.
+ *
+ * return True if the state changed.
+ */
+bool LimitAlarm::Update(const int64_t time_us, const double value)
+{
+    const auto state = Classify(value);
+    if (state == state_)
+    {
+        pending_ = state_;
+        return false;
+    }
+    if (state != pending_)
+    {
+        pending_ = state;
+        pending_since_us_ = time_us;
+    }
+    if (delay_us_ > time_us - pending_since_us_)
+    {
+        return false;
+    }
+    state_ = state;
+    return true;
+}
@@ -0,0 +1,275 @@
+/**
+ * Copyright (C) 2025, Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * This file implements the per-thread log rings and their writer thread.
+ */
+
+#include <assert.h>
+#include <condition_variable>
+#include <mutex>
+#include <stdarg.h>
+#include <stdio.h>
+#include <syslog.h>
+#include <thread>
+#include <time.h>
+#include <vector>
+
+#include "Logger.hpp"
+
+using namespace std;
+
+#define LOG_RING_SIZE (64)
+#define LOG_MAX_LENGTH (256)
+#define LOG_SITE_MAX_PER_SECOND (5)
+#define LOG_FLUSH_INTERVAL_MS (100)
+
+struct LogEntry
+{
+    int priority;
+    char text[LOG_MAX_LENGTH];
+};
+
+// Single producer (the owning thread), single consumer (the writer thread)
+struct LogRing
+{
+    atomic<size_t> head;
+    atomic<size_t> tail;
+    atomic_bool orphaned;
+    LogEntry entries[LOG_RING_SIZE];
+};
+
+// Hands the ring of an exiting thread over to the writer thread for deletion
+struct LogRingOwner
+{
+    LogRing *ring = nullptr;
+    ~LogRingOwner()
+    {
+        if (nullptr != ring)
+        {
+            ring->orphaned = true;
+        }
+    }
+};
+
+static atomic_int level_(LOG_INFO);
+static atomic_bool running_(false);
+static atomic<unsigned int> dropped_(0);
+static mutex rings_mutex_;
+static vector<LogRing *> rings_;
+static mutex writer_mutex_;
+static condition_variable writer_cond_;
+static thread *writer_ = nullptr;
+static thread_local LogRingOwner ring_owner_;
+
+static void WriteEntry(const int priority, const char *text)
+{
+    syslog(priority, "%s", text);
+    printf("%s\n", text);
+}
+
+static void WriteNow(const int priority, const char *fmt, va_list args)
+{
+    char text[LOG_MAX_LENGTH];
+    vsnprintf(text, sizeof(text), fmt, args);
+    WriteEntry(priority, text);
+}
+
+static LogRing *ThreadRing()
+{
+    if (nullptr == ring_owner_.ring)
+    {
+        auto ring = new LogRing();
+        lock_guard<mutex> lock(rings_mutex_);
+        rings_.push_back(ring);
+        ring_owner_.ring = ring;
+    }
+    return ring_owner_.ring;
+}
+
+static void Enqueue(const int priority, const char *fmt, va_list args)
+{
+    auto ring = ThreadRing();
+    const auto head = ring->head.load(memory_order_relaxed);
+    if (LOG_RING_SIZE <= head - ring->tail.load(memory_order_acquire))
+    {
+        dropped_.fetch_add(1, memory_order_relaxed);
+        return;
+    }
+    auto &entry = ring->entries[head % LOG_RING_SIZE];
+    entry.priority = priority;
+    vsnprintf(entry.text, sizeof(entry.text), fmt, args);
+    ring->head.store(head + 1, memory_order_release);
+}
+
+static void EnqueueFormat(const int priority, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+static void EnqueueFormat(const int priority, const char *fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    Enqueue(priority, fmt, args);
+    va_end(args);
+}
+
+static void Flush()
+{
+    lock_guard<mutex> lock(rings_mutex_);
+    for (auto it = rings_.begin(); it != rings_.end();)
+    {
+        auto ring = *it;
+        // Read before draining; an orphaned ring gets no more entries
+        const bool orphaned = ring->orphaned;
+        const auto head = ring->head.load(memory_order_acquire);
+        auto tail = ring->tail.load(memory_order_relaxed);
+        for (; tail != head; tail++)
+        {
+            const auto &entry = ring->entries[tail % LOG_RING_SIZE];
+            WriteEntry(entry.priority, entry.text);
+        }
+        ring->tail.store(tail, memory_order_release);
+        if (orphaned)
+        {
+            delete ring;
+            it = rings_.erase(it);
+        }
+        else
+        {
+            it++;
+        }
+    }
+
+    const auto dropped = dropped_.exchange(0, memory_order_relaxed);
+    if (0 < dropped)
+    {
+        syslog(LOG_WARNING, "Logger: %u messages dropped, log ring full", dropped);
+    }
+    fflush(stdout);
+}
+
+static void RunWriter()
+{
+    unique_lock<mutex> lock(writer_mutex_);
+    while (running_)
+    {
+        writer_cond_.wait_for(lock, chrono::milliseconds(LOG_FLUSH_INTERVAL_MS));
+        Flush();
+    }
+}
+
+/**
+ * brief Start the writer thread; until then all messages are written synchronously.
+ */
+void Logger::Start()
+{
+    assert(nullptr == writer_);
+    running_ = true;
+    writer_ = new thread(RunWriter);
+}
+
+/**
+ * brief Stop the writer thread after flushing all pending messages.
+ */
+void Logger::Stop()
+{
+    assert(nullptr != writer_);
+    {
+        lock_guard<mutex> lock(writer_mutex_);
+        running_ = false;
+    }
+    writer_cond_.notify_one();
+    writer_->join();
+    delete writer_;
+    writer_ = nullptr;
+    Flush();
+}
+
+/**
+ * brief Set the least important syslog priority that is logged.
+ *
+ * param priority Syslog priority, e.g. LOG_INFO to log everything but debug.
+ */
+void Logger::SetLevel(const int priority)
+{
+    level_.store(priority, memory_order_relaxed);
+}
+
+/**
+ * brief Decide whether a message should be logged, before it is formatted.
+ *
+ * Each call site may log LOG_SITE_MAX_PER_SECOND messages per second; the
+ * rest are counted and reported with the next message from the call site.
+ *
+ * param priority Syslog priority of the message.
+ * param site Rate limiting state of the call site.
+ * return True if the message should be written.
+ */
+bool Logger::Filter(const int priority, LogSite &site)
+{
+    if (priority > level_.load(memory_order_relaxed))
+    {
+        return false;
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &now);
+    auto second = site.second.load(memory_order_relaxed);
+    if (now.tv_sec != second && site.second.compare_exchange_strong(second, now.tv_sec, memory_order_relaxed))
+    {
+        site.count.store(0, memory_order_relaxed);
+    }
+    if (LOG_SITE_MAX_PER_SECOND <= site.count.fetch_add(1, memory_order_relaxed))
+    {
+        site.suppressed.fetch_add(1, memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * brief Format and write, or queue, a message that has passed Filter().
+ *
+ * param priority Syslog priority of the message.
+ * param site Rate limiting state of the call site.
+ * param fmt Format string, followed by its arguments.
+ */
+void Logger::Write(const int priority, LogSite &site, const char *fmt, ...)
+{
+    const auto suppressed = site.suppressed.exchange(0, memory_order_relaxed);
+    const bool now = !running_ || LOG_ERR >= priority;
+    if (0 < suppressed)
+    {
+        if (now)
+        {
+            syslog(priority, "Suppressed %u messages like \"%s\"", suppressed, fmt);
+        }
+        else
+        {
+            EnqueueFormat(priority, "Suppressed %u messages like \"%s\"", suppressed, fmt);
+        }
+    }
+
+    va_list args;
+    va_start(args, fmt);
+    if (now)
+    {
+        WriteNow(priority, fmt, args);
+    }
+    else
+    {
+        Enqueue(priority, fmt, args);
+    }
+    va_end(args);
+}
@@ -0,0 +1,111 @@
+/**
+ * Copyright (C) 2025, Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <assert.h>
+#include <string.h>
+
+#include "MaskSpans.hpp"
+
+using namespace cv;
+using namespace std;
+
+MaskSpans::MaskSpans() : rows_(0, 0), pixels_(0)
+{
+}
+
+/**
+ * brief Encode the nonzero pixels of a CV_8U mask.
+ *
+ * param mask Mask to encode.
+ */
+MaskSpans::MaskSpans(const Mat &mask) : rows_(0, 0), pixels_(0)
+{
+    assert(CV_8U == mask.type());
+
+    // The row index covers the bounding rows only
+    auto first_row = -1;
+    auto last_row = -1;
+    for (auto y = 0; y < mask.rows; y++)
+    {
+        const auto p = mask.ptr<uchar>(y);
+        for (auto x = 0; x < mask.cols; x++)
+        {
+            if (0 == p[x])
+            {
+                continue;
+            }
+            const auto x_start = x;
+            while (x < mask.cols && 0 != p[x])
+            {
+                x++;
+            }
+            spans_.push_back({y, x_start, x});
+            pixels_ += x - x_start;
+            if (0 > first_row)
+            {
+                first_row = y;
+            }
+            last_row = y;
+        }
+    }
+    if (0 > first_row)
+    {
+        row_index_.push_back(0);
+        return;
+    }
+
+    rows_ = Range(first_row, last_row + 1);
+    row_index_.resize(rows_.size() + 1);
+    unsigned int i = 0;
+    for (auto y = rows_.start; y <= rows_.end; y++)
+    {
+        while (i < spans_.size() && spans_[i].row < y)
+        {
+            i++;
+        }
+        row_index_[y - rows_.start] = i;
+    }
+    spans_.shrink_to_fit();
+}
+
+/**
+ * brief Pack a mask row into words of 64 pixels, pixel 64 * w + b in bit b of word w.
+ *
+ * param words Output words, all of them are written.
+ * param y Row number in mask coordinates.
+ * param words_per_row Number of words in the row.
+ * param x_min First column to include.
+ * param x_max Column after the last one to include.
+ */
+void MaskSpans::PackRow(uint64_t *words, const int y, const int words_per_row, const int x_min, const int x_max) const
+{
+    assert(nullptr != words);
+    memset(words, 0, words_per_row * sizeof(uint64_t));
+    const auto end = RowEnd(y);
+    for (auto s = RowBegin(y); s != end; s++)
+    {
+        assert(s->x_end <= 64 * words_per_row);
+        const auto x_end = min(s->x_end, x_max);
+        for (auto x = max(s->x_start, x_min); x < x_end;)
+        {
+            const auto b = x % 64;
+            const auto n = min(64 - b, x_end - x);
+            words[x / 64] |= (64 == n ? ~0ULL : (1ULL << n) - 1) << b;
+            x += n;
+        }
+    }
+}
@@ -0,0 +1,243 @@
+/**
+ * Copyright (C) 2025, Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <assert.h>
+
+#include "MatPool.hpp"
+#include "common.hpp"
+
+using namespace cv;
+using namespace std;
+
+// Smaller images come and go with the heap
+#define MAT_POOL_MIN_BYTES (4096)
+// Bound of the released bytes kept for reuse, and of the buffers of one size
+#define MAT_POOL_MAX_CACHED_BYTES (4 * 1024 * 1024)
+#define MAT_POOL_MAX_BUFFERS_PER_SIZE (8)
+
+static const char *tag_names[MatPool::NUM_TAGS] = {"Other", "Frame", "Gauge", "Debug"};
+
+static thread_local MatPool::Tag current_tag_ = MatPool::TAG_OTHER;
+
+MatPool::MatPool() : stats_()
+{
+}
+
+/**
+ * brief Make the pool the allocator of all images created from now on.
+ *
+ * Images created before keep their allocator, so they are not accounted.
+ */
+void MatPool::Install()
+{
+    Mat::setDefaultAllocator(&GetInstance());
+    LOG_I("%s/%s: Image memory pool installed", __FILE__, __FUNCTION__);
+}
+
+MatPool &MatPool::GetInstance()
+{
+    // Never destroyed, static images may be released after main() returns
+    static auto pool = new MatPool();
+    return *pool;
+}
+
+const char *MatPool::GetTagName(const Tag tag)
+{
+    assert(NUM_TAGS > tag);
+    return tag_names[tag];
+}
+
+MatPool::Tag MatPool::GetTag()
+{
+    return current_tag_;
+}
+
+/**
+ * brief Set the tag of the calling thread.
+ *
+ * param tag Tag of the following allocations of the thread.
+ * return The previous tag.
+ */
+MatPool::Tag MatPool::SetTag(const Tag tag)
+{
+    assert(NUM_TAGS > tag);
+    const auto previous = current_tag_;
+    current_tag_ = tag;
+    return previous;
+}
+
+MatPool::Stats MatPool::GetStats() const
+{
+    lock_guard<mutex> lock(mutex_);
+    return stats_;
+}
+
+UMatData *MatPool::allocate(
+    int dims,
+    const int *sizes,
+    int type,
+    void *data,
+    size_t *step,
+    AccessFlag flags,
+    UMatUsageFlags usage_flags) const
+{
+    (void)flags;
+    (void)usage_flags;
+    // Steps as the standard allocator computes them
+    size_t total = CV_ELEM_SIZE(type);
+    for (auto i = dims - 1; 0 <= i; i--)
+    {
+        if (nullptr != step)
+        {
+            if (nullptr != data && CV_AUTOSTEP != step[i])
+            {
+                CV_Assert(total <= step[i]);
+                total = step[i];
+            }
+            else
+            {
+                step[i] = total;
+            }
+        }
+        total *= sizes[i];
+    }
+
+    auto u = new UMatData(this);
+    u->size = total;
+    if (nullptr != data)
+    {
+        // Memory of the caller is neither pooled nor accounted
+        u->data = u->origdata = static_cast<uchar *>(data);
+        u->flags |= UMatData::USER_ALLOCATED;
+        return u;
+    }
+    const auto tag = GetTag();
+    u->data = u->origdata = static_cast<uchar *>(Take(total, tag));
+    u->allocatorFlags_ = tag;
+    return u;
+}
+
+bool MatPool::allocate(UMatData *data, AccessFlag flags, UMatUsageFlags usage_flags) const
+{
+    (void)flags;
+    (void)usage_flags;
+    return nullptr != data;
+}
+
+void MatPool::deallocate(UMatData *data) const
+{
+    if (nullptr == data)
+    {
+        return;
+    }
+    CV_Assert(0 == data->urefcount);
+    CV_Assert(0 == data->refcount);
+    if (!(data->flags & UMatData::USER_ALLOCATED))
+    {
+        Give(data->origdata, data->size, static_cast<Tag>(data->allocatorFlags_));
+        data->origdata = nullptr;
+    }
+    delete data;
+}
+
+void *MatPool::Take(const size_t size, const Tag tag) const
+{
+    void *data = nullptr;
+    {
+        lock_guard<mutex> lock(mutex_);
+        stats_.allocations++;
+        if (MAT_POOL_MIN_BYTES <= size)
+        {
+            stats_.pooled++;
+            // Only sizes with released buffers are in the pool
+            const auto it = free_.find(size);
+            if (free_.end() != it)
+            {
+                data = it->second.buffers.back();
+                it->second.buffers.pop_back();
+                if (it->second.buffers.empty())
+                {
+                    free_.erase(it);
+                }
+                stats_.cached_bytes -= size;
+                stats_.pool_hits++;
+            }
+        }
+        auto &tag_stats = stats_.tags[tag];
+        tag_stats.allocations++;
+        tag_stats.bytes += size;
+        tag_stats.peak_bytes = MAX(tag_stats.peak_bytes, tag_stats.bytes);
+        stats_.bytes += size;
+        stats_.peak_bytes = MAX(stats_.peak_bytes, stats_.bytes);
+    }
+    return nullptr != data ? data : fastMalloc(size);
+}
+
+void MatPool::Give(void *data, const size_t size, const Tag tag) const
+{
+    vector<void *> dropped;
+    {
+        lock_guard<mutex> lock(mutex_);
+        assert(NUM_TAGS > tag && stats_.tags[tag].bytes >= size);
+        stats_.tags[tag].bytes -= size;
+        stats_.bytes -= size;
+        if (MAT_POOL_MIN_BYTES <= size && MAT_POOL_MAX_CACHED_BYTES >= size)
+        {
+            // Make room by dropping the sizes used least recently
+            while (MAT_POOL_MAX_CACHED_BYTES < stats_.cached_bytes + size)
+            {
+                auto lru = free_.end();
+                for (auto it = free_.begin(); free_.end() != it; ++it)
+                {
+                    if (size != it->first && (free_.end() == lru || lru->second.last_used > it->second.last_used))
+                    {
+                        lru = it;
+                    }
+                }
+                if (free_.end() == lru)
+                {
+                    break;
+                }
+                dropped.insert(dropped.end(), lru->second.buffers.begin(), lru->second.buffers.end());
+                stats_.cached_bytes -= lru->first * lru->second.buffers.size();
+                free_.erase(lru);
+            }
+            auto &size_class = free_[size];
+            size_class.last_used = stats_.allocations;
+            if (MAT_POOL_MAX_CACHED_BYTES >= stats_.cached_bytes + size &&
+                MAT_POOL_MAX_BUFFERS_PER_SIZE > size_class.buffers.size())
+            {
+                size_class.buffers.push_back(data);
+                stats_.cached_bytes += size;
+                data = nullptr;
+            }
+            else if (size_class.buffers.empty())
+            {
+                free_.erase(size);
+            }
+        }
+    }
+    // Free outside the lock
+    for (auto buffer : dropped)
+    {
+        fastFree(buffer);
+    }
+    if (nullptr != data)
+    {
+        fastFree(data);
+    }
+}
@@ -15,6 +15,9 @@
  */
 
 #include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
 
 #include "OpcUaServer.hpp"
 #include "common.hpp"
@@ -22,8 +25,42 @@
 using namespace std;
 
 #define LABEL (char *)"GaugeReading"
+#define FILTERED_LABEL (char *)"GaugeReadingFiltered"
+#define CONFIDENCE_LABEL (char *)"GaugeConfidence"
+#define DIAGNOSTICS_LABEL (char *)"Diagnostics"
+#define AGGREGATES_LABEL (char *)"Aggregates"
+#define READ_HISTORY_LABEL (char *)"ReadHistory"
+#define ALARMS_LABEL (char *)"Alarms"
+#define LIMIT_ALARM_LABEL (char *)"GaugeLimitAlarm"
 
-OpcUaServer::OpcUaServer() : serverthread_(nullptr), running_(false), server_(nullptr)
+// Most readings returned by one call of ReadHistory
+#define READ_HISTORY_MAX_VALUES (10000)
+
+// EventNotifier of an object whose events clients can subscribe to
+#define SUBSCRIBE_TO_EVENTS (0x01)
+
+// Severity (1 to 1000) of the limit alarm within the limits, beyond the High
+// or Low limit and beyond the HighHigh or LowLow limit
+#define ALARM_SEVERITY_NORMAL (100)
+#define ALARM_SEVERITY_LIMIT (500)
+#define ALARM_SEVERITY_LIMIT2 (800)
+
+// The fields of the limit alarm for each limit
+static const struct
+{
+    LimitState limit;
+    const char *limit_field;
+    const char *state_field;
+} alarm_fields[] = {
+    {LIMIT_HIGHHIGH, "HighHighLimit", "HighHighState"},
+    {LIMIT_HIGH, "HighLimit", "HighState"},
+    {LIMIT_LOW, "LowLimit", "LowState"},
+    {LIMIT_LOWLOW, "LowLowLimit", "LowLowState"},
+};
+
+OpcUaServer::OpcUaServer()
+    : serverthread_(nullptr), running_(false), server_(nullptr), iterations_(0),
+      history_(nullptr), limit_alarm_(nullptr), alarm_active_(false)
 {
 }
 
@@ -49,7 +86,27 @@ bool OpcUaServer::LaunchServer(const unsigned int serverport)
     }
     UA_ServerConfig_setMinimal(UA_Server_getConfig(server_), serverport, nullptr);
     AddDouble(LABEL, -1);
+    AddDouble(FILTERED_LABEL, -1);
+    AddDouble(CONFIDENCE_LABEL, 0);
+    demand_.Reset();
+#ifdef UA_ENABLE_SUBSCRIPTIONS
+    UA_Server_getConfig(server_)->monitoredItemRegisterCallback = OnMonitoredItem;
+#endif
+    TrackDemand(LABEL);
+    TrackDemand(FILTERED_LABEL);
+    TrackDemand(CONFIDENCE_LABEL);
+    AddObject(DIAGNOSTICS_LABEL);
+    AddObject(AGGREGATES_LABEL);
+    if (nullptr != history_)
+    {
+        AddHistoryMethod();
+    }
+    if (nullptr != limit_alarm_)
+    {
+        AddLimitAlarm();
+    }
 
+    running_ = true;
     serverthread_ = new thread(this->RunUaServer, this);
 
     return true;
@@ -95,21 +152,432 @@ void OpcUaServer::UpdateGaugeValue(double value)
     // Always update value even if there is no change; that will bump the
     // timestamp on the server so the client can see if the value is fresh or
     // ancient.
+    WriteDouble(LABEL, value);
+}
+
+void OpcUaServer::UpdateFilteredValue(double value, double confidence)
+{
+    WriteDouble(FILTERED_LABEL, value);
+    WriteDouble(CONFIDENCE_LABEL, confidence);
+}
+
+void OpcUaServer::WriteDouble(char *label, double value)
+{
     if (nullptr == server_)
     {
         return;
     }
     UA_Variant newvalue;
     UA_Variant_setScalar(&newvalue, &value, &UA_TYPES[UA_TYPES_DOUBLE]);
-    UA_NodeId currentNodeId = UA_NODEID_STRING(1, LABEL);
+    UA_NodeId currentNodeId = UA_NODEID_STRING(1, label);
     const auto rc = UA_Server_writeValue(server_, currentNodeId, newvalue);
     if (UA_STATUSCODE_GOOD != rc)
     {
-        LOG_E("%s/%s: Failed to set OPC UA gauge value (%s)", __FILE__, __FUNCTION__, UA_StatusCode_name(rc));
+        LOG_E("%s/%s: Failed to set OPC UA value %s (%s)", __FILE__, __FUNCTION__, label, UA_StatusCode_name(rc));
+    }
+}
+
+void OpcUaServer::UpdateDiagnosticValue(const char *label, double value)
+{
+    WriteChildDouble(DIAGNOSTICS_LABEL, label, value);
+}
+
+void OpcUaServer::UpdateAggregateValue(const char *label, double value)
+{
+    WriteChildDouble(AGGREGATES_LABEL, label, value);
+}
+
+void OpcUaServer::RemoveValue(const char *label)
+{
+    if (nullptr == server_)
+    {
+        return;
+    }
+    const auto rc = UA_Server_deleteNode(server_, UA_NODEID_STRING(1, const_cast<char *>(label)), true);
+    if (UA_STATUSCODE_GOOD != rc && UA_STATUSCODE_BADNODEIDUNKNOWN != rc)
+    {
+        LOG_E("%s/%s: Failed to remove OPC UA value %s (%s)", __FILE__, __FUNCTION__, label, UA_StatusCode_name(rc));
+    }
+}
+
+void OpcUaServer::WriteChildDouble(char *parent_label, const char *label, double value)
+{
+    // Variables below an object are created on first update
+    if (nullptr == server_)
+    {
+        return;
+    }
+    UA_Variant newvalue;
+    UA_Variant_setScalar(&newvalue, &value, &UA_TYPES[UA_TYPES_DOUBLE]);
+    UA_NodeId currentNodeId = UA_NODEID_STRING(1, const_cast<char *>(label));
+    auto rc = UA_Server_writeValue(server_, currentNodeId, newvalue);
+    if (UA_STATUSCODE_BADNODEIDUNKNOWN == rc)
+    {
+        AddDouble(const_cast<char *>(label), value, UA_NODEID_STRING(1, parent_label));
+        rc = UA_STATUSCODE_GOOD;
+    }
+    if (UA_STATUSCODE_GOOD != rc)
+    {
+        LOG_E("%s/%s: Failed to set OPC UA value %s (%s)", __FILE__, __FUNCTION__, label, UA_StatusCode_name(rc));
+    }
+}
+
+void OpcUaServer::AddObject(char *label, const UA_Byte event_notifier)
+{
+    assert(nullptr != server_);
+    assert(nullptr != label);
+
+    char *enUS = (char *)"en-US";
+    UA_ObjectAttributes attr = UA_ObjectAttributes_default;
+    attr.description = UA_LOCALIZEDTEXT(enUS, label);
+    attr.displayName = UA_LOCALIZEDTEXT(enUS, label);
+    attr.eventNotifier = event_notifier;
+
+    const auto rc = UA_Server_addObjectNode(
+        server_,
+        UA_NODEID_STRING(1, label),
+        UA_NODEID_NUMERIC(0, UA_NS0ID_OBJECTSFOLDER),
+        UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES),
+        UA_QUALIFIEDNAME(1, label),
+        UA_NODEID_NUMERIC(0, UA_NS0ID_BASEOBJECTTYPE),
+        attr,
+        nullptr,
+        nullptr);
+    assert(UA_STATUSCODE_GOOD == rc);
+}
+
+/**
+ * brief Add the ReadHistory method, which returns the readings of a time range.
+ *
+ * Inputs are the start and the end of the range and the most readings to
+ * return, 0 for READ_HISTORY_MAX_VALUES. Outputs are the timestamps, values
+ * and status codes of the readings, oldest first: Good for an accepted
+ * reading, Uncertain for one rejected as an outlier and Bad when no needle
+ * was found. A client reads on from the last timestamp returned.
+ */
+void OpcUaServer::AddHistoryMethod()
+{
+    assert(nullptr != server_);
+
+    UA_Argument inputs[3];
+    const char *input_names[] = {"Start", "End", "MaxValues"};
+    const UA_DataType *input_types[] =
+        {&UA_TYPES[UA_TYPES_DATETIME], &UA_TYPES[UA_TYPES_DATETIME], &UA_TYPES[UA_TYPES_UINT32]};
+    for (auto i = 0; 3 > i; i++)
+    {
+        UA_Argument_init(&inputs[i]);
+        inputs[i].name = UA_STRING(const_cast<char *>(input_names[i]));
+        inputs[i].dataType = input_types[i]->typeId;
+        inputs[i].valueRank = UA_VALUERANK_SCALAR;
+    }
+    UA_Argument outputs[3];
+    const char *output_names[] = {"Timestamps", "Values", "StatusCodes"};
+    const UA_DataType *output_types[] =
+        {&UA_TYPES[UA_TYPES_DATETIME], &UA_TYPES[UA_TYPES_DOUBLE], &UA_TYPES[UA_TYPES_STATUSCODE]};
+    for (auto i = 0; 3 > i; i++)
+    {
+        UA_Argument_init(&outputs[i]);
+        outputs[i].name = UA_STRING(const_cast<char *>(output_names[i]));
+        outputs[i].dataType = output_types[i]->typeId;
+        outputs[i].valueRank = UA_VALUERANK_ONE_DIMENSION;
+    }
+
+    char *enUS = (char *)"en-US";
+    UA_MethodAttributes attr = UA_MethodAttributes_default;
+    attr.description = UA_LOCALIZEDTEXT(enUS, (char *)"Readings of a time range, kept on the device");
+    attr.displayName = UA_LOCALIZEDTEXT(enUS, READ_HISTORY_LABEL);
+    attr.executable = true;
+    attr.userExecutable = true;
+
+    const auto rc = UA_Server_addMethodNode(
+        server_,
+        UA_NODEID_STRING(1, READ_HISTORY_LABEL),
+        UA_NODEID_NUMERIC(0, UA_NS0ID_OBJECTSFOLDER),
+        UA_NODEID_NUMERIC(0, UA_NS0ID_HASCOMPONENT),
+        UA_QUALIFIEDNAME(1, READ_HISTORY_LABEL),
+        attr,
+        ReadHistory,
+        3,
+        inputs,
+        3,
+        outputs,
+        this,
+        nullptr);
+    assert(UA_STATUSCODE_GOOD == rc);
+}
+
+UA_StatusCode OpcUaServer::ReadHistory(
+    UA_Server *server,
+    const UA_NodeId *session_id,
+    void *session_context,
+    const UA_NodeId *method_id,
+    void *method_context,
+    const UA_NodeId *object_id,
+    void *object_context,
+    size_t input_size,
+    const UA_Variant *input,
+    size_t output_size,
+    UA_Variant *output)
+{
+    (void)server;
+    (void)session_id;
+    (void)session_context;
+    (void)method_id;
+    (void)object_id;
+    (void)object_context;
+    auto parent = static_cast<OpcUaServer *>(method_context);
+    assert(nullptr != parent);
+    if (3 != input_size || 3 != output_size || nullptr == parent->history_ ||
+        !UA_Variant_hasScalarType(&input[0], &UA_TYPES[UA_TYPES_DATETIME]) ||
+        !UA_Variant_hasScalarType(&input[1], &UA_TYPES[UA_TYPES_DATETIME]) ||
+        !UA_Variant_hasScalarType(&input[2], &UA_TYPES[UA_TYPES_UINT32]))
+    {
+        return UA_STATUSCODE_BADINVALIDARGUMENT;
+    }
+    const auto start = *static_cast<UA_DateTime *>(input[0].data);
+    const auto end = *static_cast<UA_DateTime *>(input[1].data);
+    const auto max_values = *static_cast<UA_UInt32 *>(input[2].data);
+
+    vector<HistoryReading> readings;
+    parent->history_->Query(
+        (start - UA_DATETIME_UNIX_EPOCH) / UA_DATETIME_MSEC,
+        (end - UA_DATETIME_UNIX_EPOCH) / UA_DATETIME_MSEC,
+        0 < max_values ? MIN(max_values, READ_HISTORY_MAX_VALUES) : READ_HISTORY_MAX_VALUES,
+        readings);
+    vector<UA_DateTime> timestamps;
+    vector<UA_Double> values;
+    vector<UA_StatusCode> statuses;
+    for (const auto &reading : readings)
+    {
+        timestamps.push_back(UA_DATETIME_UNIX_EPOCH + reading.time_ms * UA_DATETIME_MSEC);
+        values.push_back(reading.value);
+        statuses.push_back(
+            HISTORY_GOOD == reading.status       ? UA_STATUSCODE_GOOD
+            : HISTORY_REJECTED == reading.status ? UA_STATUSCODE_UNCERTAIN
+                                                 : UA_STATUSCODE_BAD);
+    }
+    auto rc = UA_Variant_setArrayCopy(&output[0], timestamps.data(), timestamps.size(), &UA_TYPES[UA_TYPES_DATETIME]);
+    if (UA_STATUSCODE_GOOD == rc)
+    {
+        rc = UA_Variant_setArrayCopy(&output[1], values.data(), values.size(), &UA_TYPES[UA_TYPES_DOUBLE]);
+    }
+    if (UA_STATUSCODE_GOOD == rc)
+    {
+        rc = UA_Variant_setArrayCopy(&output[2], statuses.data(), statuses.size(), &UA_TYPES[UA_TYPES_STATUSCODE]);
+    }
+
+    return rc;
+}
+
+#ifdef UA_ENABLE_SUBSCRIPTIONS_ALARMS_CONDITIONS
+/**
+ * brief Set a field of the limit alarm, or a property of the field.
+ *
+ * param server OPC UA server.
+ * param field Browse name of the field.
+ * param value Value of the field.
+ * param type Type of the value.
+ * param property Browse name of the property, nullptr for the field itself.
+ *
+ * return True on success.
+ */
+static bool set_alarm_field(
+    UA_Server *server,
+    const char *field,
+    const void *value,
+    const UA_DataType *type,
+    const char *property = nullptr)
+{
+    UA_Variant variant;
+    UA_Variant_setScalar(&variant, const_cast<void *>(value), type);
+    const auto condition = UA_NODEID_STRING(1, LIMIT_ALARM_LABEL);
+    const auto field_name = UA_QUALIFIEDNAME(0, const_cast<char *>(field));
+    const auto rc = nullptr == property ? UA_Server_setConditionField(server, condition, &variant, field_name)
+                                        : UA_Server_setConditionVariableFieldProperty(
+                                              server,
+                                              condition,
+                                              &variant,
+                                              field_name,
+                                              UA_QUALIFIEDNAME(0, const_cast<char *>(property)));
+    if (UA_STATUSCODE_GOOD != rc)
+    {
+        LOG_E("%s/%s: Failed to set %s of the limit alarm (%s)", __FILE__, __FUNCTION__, field, UA_StatusCode_name(rc));
+        return false;
+    }
+    return true;
+}
+#endif
+
+/**
+ * brief Add the limit alarm of the filtered reading.
+ *
+ * The alarm is a NonExclusiveLimitAlarmType condition of the Alarms object,
+ * with the four limits and a state for each of them. The Alarms object is a
+ * notifier of the Server object, so clients get the events of the alarm by
+ * subscribing to the events of either.
+ */
+void OpcUaServer::AddLimitAlarm()
+{
+    assert(nullptr != server_);
+    assert(nullptr != limit_alarm_);
+
+    alarm_active_ = false;
+#ifdef UA_ENABLE_SUBSCRIPTIONS_ALARMS_CONDITIONS
+    AddObject(ALARMS_LABEL, SUBSCRIBE_TO_EVENTS);
+    auto rc = UA_Server_addReference(
+        server_,
+        UA_NODEID_NUMERIC(0, UA_NS0ID_SERVER),
+        UA_NODEID_NUMERIC(0, UA_NS0ID_HASNOTIFIER),
+        UA_EXPANDEDNODEID_STRING(1, ALARMS_LABEL),
+        true);
+    if (UA_STATUSCODE_GOOD == rc)
+    {
+        rc = UA_Server_createCondition(
+            server_,
+            UA_NODEID_STRING(1, LIMIT_ALARM_LABEL),
+            UA_NODEID_NUMERIC(0, UA_NS0ID_NONEXCLUSIVELIMITALARMTYPE),
+            UA_QUALIFIEDNAME(1, LIMIT_ALARM_LABEL),
+            UA_NODEID_STRING(1, ALARMS_LABEL),
+            UA_NODEID_NUMERIC(0, UA_NS0ID_HASCOMPONENT),
+            nullptr);
+    }
+    // The limits and their states are optional fields of the type
+    for (const auto &field : alarm_fields)
+    {
+        if (UA_STATUSCODE_GOOD == rc)
+        {
+            rc = UA_Server_addConditionOptionalField(
+                server_,
+                UA_NODEID_STRING(1, LIMIT_ALARM_LABEL),
+                UA_NODEID_NUMERIC(0, UA_NS0ID_LIMITALARMTYPE),
+                UA_QUALIFIEDNAME(0, const_cast<char *>(field.limit_field)),
+                nullptr);
+        }
+        if (UA_STATUSCODE_GOOD == rc)
+        {
+            rc = UA_Server_addConditionOptionalField(
+                server_,
+                UA_NODEID_STRING(1, LIMIT_ALARM_LABEL),
+                UA_NODEID_NUMERIC(0, UA_NS0ID_NONEXCLUSIVELIMITALARMTYPE),
+                UA_QUALIFIEDNAME(0, const_cast<char *>(field.state_field)),
+                nullptr);
+        }
+    }
+    if (UA_STATUSCODE_GOOD != rc)
+    {
+        LOG_E("%s/%s: Failed to add the limit alarm (%s)", __FILE__, __FUNCTION__, UA_StatusCode_name(rc));
+        return;
+    }
+
+    const auto input_node = UA_NODEID_STRING(1, FILTERED_LABEL);
+    const UA_Boolean enabled = true;
+    if (set_alarm_field(server_, "InputNode", &input_node, &UA_TYPES[UA_TYPES_NODEID]) &&
+        set_alarm_field(server_, "EnabledState", &enabled, &UA_TYPES[UA_TYPES_BOOLEAN], "Id"))
+    {
+        UpdateAlarmLimits();
+        UpdateLimitAlarm();
+    }
+#else
+    LOG_E("%s/%s: The OPC UA library is built without alarms and conditions", __FILE__, __FUNCTION__);
+#endif
+}
+
+/**
+ * brief Publish the limits of the limit alarm, NaN for the limits that are off.
+ */
+void OpcUaServer::UpdateAlarmLimits()
+{
+    if (nullptr == server_ || nullptr == limit_alarm_)
+    {
+        return;
+    }
+#ifdef UA_ENABLE_SUBSCRIPTIONS_ALARMS_CONDITIONS
+    for (const auto &field : alarm_fields)
+    {
+        const UA_Double limit = limit_alarm_->GetLimit(field.limit);
+        set_alarm_field(server_, field.limit_field, &limit, &UA_TYPES[UA_TYPES_DOUBLE]);
+    }
+#endif
+}
+
+/**
+ * brief Publish the state of the limit alarm and send its event.
+ *
+ * Call when the state has changed; clients get one event per change.
+ */
+void OpcUaServer::UpdateLimitAlarm()
+{
+    if (nullptr == server_ || nullptr == limit_alarm_)
+    {
+        return;
+    }
+#ifdef UA_ENABLE_SUBSCRIPTIONS_ALARMS_CONDITIONS
+    char *enUS = (char *)"en-US";
+    const auto state = limit_alarm_->GetState();
+    const char *exceeded = nullptr;
+    for (const auto &field : alarm_fields)
+    {
+        // A state is active while its limit is exceeded, so HighState is
+        // active at HighHigh too
+        const UA_Boolean active = LIMIT_NORMAL < field.limit ? state >= field.limit : state <= field.limit;
+        const auto text = UA_LOCALIZEDTEXT(enUS, (char *)(active ? "Active" : "Inactive"));
+        set_alarm_field(server_, field.state_field, &text, &UA_TYPES[UA_TYPES_LOCALIZEDTEXT]);
+        set_alarm_field(server_, field.state_field, &active, &UA_TYPES[UA_TYPES_BOOLEAN], "Id");
+        if (field.limit == state)
+        {
+            exceeded = field.limit_field;
+        }
+    }
+
+    const UA_Boolean active = LIMIT_NORMAL != state;
+    const UA_UInt16 severities[] = {ALARM_SEVERITY_NORMAL, ALARM_SEVERITY_LIMIT, ALARM_SEVERITY_LIMIT2};
+    const auto severity = severities[abs(state)];
+    char message[64];
+    if (active)
+    {
+        snprintf(
+            message,
+            sizeof(message),
+            "%s %s %s",
+            FILTERED_LABEL,
+            LIMIT_NORMAL < state ? "at or above" : "at or below",
+            exceeded);
+    }
+    else
+    {
+        snprintf(message, sizeof(message), "%s within the limits", FILTERED_LABEL);
+    }
+    const auto message_text = UA_LOCALIZEDTEXT(enUS, message);
+    const auto now = UA_DateTime_now();
+    set_alarm_field(server_, "Severity", &severity, &UA_TYPES[UA_TYPES_UINT16]);
+    set_alarm_field(server_, "Message", &message_text, &UA_TYPES[UA_TYPES_LOCALIZEDTEXT]);
+    set_alarm_field(server_, "Retain", &active, &UA_TYPES[UA_TYPES_BOOLEAN]);
+    set_alarm_field(server_, "Time", &now, &UA_TYPES[UA_TYPES_DATETIME]);
+
+    // Setting ActiveState makes the server send the event when the alarm
+    // goes active; every other change is sent here
+    const auto went_active = active && !alarm_active_;
+    if (active != alarm_active_)
+    {
+        set_alarm_field(server_, "ActiveState", &active, &UA_TYPES[UA_TYPES_BOOLEAN], "Id");
+        alarm_active_ = active;
+    }
+    if (!went_active)
+    {
+        const auto rc = UA_Server_triggerConditionEvent(
+            server_,
+            UA_NODEID_STRING(1, LIMIT_ALARM_LABEL),
+            UA_NODEID_STRING(1, ALARMS_LABEL),
+            nullptr);
+        if (UA_STATUSCODE_GOOD != rc)
+        {
+            LOG_E("%s/%s: Failed to send the limit alarm event (%s)", __FILE__, __FUNCTION__, UA_StatusCode_name(rc));
+        }
     }
+#endif
 }
 
-void OpcUaServer::AddDouble(char *label, UA_Double value)
+void OpcUaServer::AddDouble(char *label, UA_Double value, const UA_NodeId parent_node_id)
 {
     assert(nullptr != server_);
     assert(nullptr != label);
@@ -126,7 +594,6 @@ void OpcUaServer::AddDouble(char *label, UA_Double value)
     // Add the variable node to the information model
     UA_NodeId node_id = UA_NODEID_STRING(1, label);
     UA_QualifiedName name = UA_QUALIFIEDNAME(1, label);
-    UA_NodeId parent_node_id = UA_NODEID_NUMERIC(0, UA_NS0ID_OBJECTSFOLDER);
     UA_NodeId parent_ref_node_id = UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES);
     const auto rc = UA_Server_addVariableNode(
         server_,
@@ -141,15 +608,91 @@ void OpcUaServer::AddDouble(char *label, UA_Double value)
     assert(UA_STATUSCODE_GOOD == rc);
 }
 
+/**
+ * brief Count the reads of a variable, and the monitored items on it, as
+ * demand for the reading.
+ *
+ * param label Variable.
+ */
+void OpcUaServer::TrackDemand(char *label)
+{
+    assert(nullptr != server_);
+
+    // The callbacks find the server in the context of the node
+    const auto node_id = UA_NODEID_STRING(1, label);
+    UA_ValueCallback callback = {OnRead, nullptr};
+    auto rc = UA_Server_setNodeContext(server_, node_id, this);
+    if (UA_STATUSCODE_GOOD == rc)
+    {
+        rc = UA_Server_setVariableNode_valueCallback(server_, node_id, callback);
+    }
+    if (UA_STATUSCODE_GOOD != rc)
+    {
+        LOG_E("%s/%s: Failed to track reads of %s (%s)", __FILE__, __FUNCTION__, label, UA_StatusCode_name(rc));
+    }
+}
+
+void OpcUaServer::OnRead(
+    UA_Server *server,
+    const UA_NodeId *session_id,
+    void *session_context,
+    const UA_NodeId *node_id,
+    void *node_context,
+    const UA_NumericRange *range,
+    const UA_DataValue *value)
+{
+    (void)server;
+    (void)session_id;
+    (void)session_context;
+    (void)node_id;
+    (void)range;
+    (void)value;
+    auto parent = static_cast<OpcUaServer *>(node_context);
+    if (nullptr != parent)
+    {
+        parent->demand_.CountRead();
+    }
+}
+
+void OpcUaServer::OnMonitoredItem(
+    UA_Server *server,
+    const UA_NodeId *session_id,
+    void *session_context,
+    const UA_NodeId *node_id,
+    void *node_context,
+    UA_UInt32 attribute_id,
+    UA_Boolean removed)
+{
+    (void)server;
+    (void)session_id;
+    (void)session_context;
+    (void)node_id;
+    // Only the tracked variables have the server as context
+    auto parent = static_cast<OpcUaServer *>(node_context);
+    if (nullptr != parent && UA_ATTRIBUTEID_VALUE == attribute_id)
+    {
+        parent->demand_.CountMonitoredItem(removed);
+    }
+}
+
 void OpcUaServer::RunUaServer(OpcUaServer *parent)
 {
     assert(nullptr != parent);
     assert(nullptr != parent->server_);
-    assert(false == parent->running_);
+    assert(parent->running_);
 
+    // Same as UA_Server_run(), which cannot take an atomic running flag
     LOG_I("%s/%s: Starting UA server ...", __FILE__, __FUNCTION__);
-    parent->running_ = true;
-    UA_StatusCode status = UA_Server_run(parent->server_, &parent->running_);
+    UA_StatusCode status = UA_Server_run_startup(parent->server_);
+    if (UA_STATUSCODE_GOOD == status)
+    {
+        while (parent->running_)
+        {
+            UA_Server_run_iterate(parent->server_, true);
+            parent->iterations_++;
+        }
+        status = UA_Server_run_shutdown(parent->server_);
+    }
     LOG_I("%s/%s: UA Server exit status: %s", __FILE__, __FUNCTION__, UA_StatusCode_name(status));
     UA_Server_delete(parent->server_);
     parent->server_ = nullptr;
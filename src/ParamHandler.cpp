@@ -15,20 +15,39 @@
  */
 
 #include <assert.h>
+#include <unistd.h>
 
 #include "ParamHandler.hpp"
 #include "common.hpp"
 
 using namespace cv;
 
+// Settle time after the callbacks are registered, to mitigate a timing issue
+// in the parameter handling
+#define PARAM_SETTLE_US (50000)
+
 ParamHandler::ParamHandler(
     const gchar *app_name,
     void (*RestartOpcuaserver)(const guint32),
-    void (*ReplaceGauge)(),
-    void (*SetDynstrNbr)(const guint8))
+    void (*ReplaceGauge)(const GaugeParams &),
+    void (*SetDynstrNbr)(const guint8),
+    void (*SetDebugCapture)(const guint32),
+    void (*SetPipelined)(const gboolean),
+    void (*SetPreprocessThreads)(const guint32),
+    void (*SetCpuBudget)(const guint32),
+    void (*SetAggregateWindow)(const guint32, const guint32),
+    void (*SetAlarmLimit)(const LimitState, const guint32),
+    void (*SetAlarmDeadband)(const guint32),
+    void (*SetAlarmDelay)(const guint32),
+    void (*SetEventThreshold)(const guint32, const guint32),
+    void (*SetEventHysteresis)(const guint32),
+    void (*SetDemandIdleInterval)(const guint32))
     : RestartOpcuaserver_(RestartOpcuaserver), ReplaceGauge_(ReplaceGauge), SetDynstrNbr_(SetDynstrNbr),
-      axparameter_(nullptr), clockwise_(true), round_to_decimals_(-1), center_point_(0, 0), min_point_(0, 0),
-      max_point_(0, 0)
+      SetDebugCapture_(SetDebugCapture), SetPipelined_(SetPipelined), SetPreprocessThreads_(SetPreprocessThreads),
+      SetCpuBudget_(SetCpuBudget), SetAggregateWindow_(SetAggregateWindow), SetAlarmLimit_(SetAlarmLimit),
+      SetAlarmDeadband_(SetAlarmDeadband), SetAlarmDelay_(SetAlarmDelay), SetEventThreshold_(SetEventThreshold),
+      SetEventHysteresis_(SetEventHysteresis), SetDemandIdleInterval_(SetDemandIdleInterval), axparameter_(nullptr),
+      port_(0), round_to_decimals_(-1), gauge_params_({{0, 0}, {0, 0}, {0, 0}, true, 0, 0, 1, false})
 {
     LOG_I("Init parameter handling ...");
     g_mutex_init(&mtx_);
@@ -43,7 +62,25 @@ ParamHandler::ParamHandler(
     assert(nullptr != axparameter_);
     // clang-format off
     LOG_I("Setting up parameters ...");
-    if (!SetupParam("DynamicStringNumber", param_callback) ||
+    const auto setup_start = g_get_monotonic_time();
+    if (!SetupParam("LogLevel", param_callback) ||
+        !SetupParam("AggregateWindow1", param_callback) ||
+        !SetupParam("AggregateWindow2", param_callback) ||
+        !SetupParam("AlarmDeadband", param_callback) ||
+        !SetupParam("AlarmDelay", param_callback) ||
+        !SetupParam("AlarmHighHighLimit", param_callback) ||
+        !SetupParam("AlarmHighLimit", param_callback) ||
+        !SetupParam("AlarmLowLimit", param_callback) ||
+        !SetupParam("AlarmLowLowLimit", param_callback) ||
+        !SetupParam("AverageFrames", param_callback) ||
+        !SetupParam("BackgroundModel", param_callback) ||
+        !SetupParam("CpuBudget", param_callback) ||
+        !SetupParam("DebugCapture", param_callback) ||
+        !SetupParam("DemandIdleInterval", param_callback) ||
+        !SetupParam("DynamicStringNumber", param_callback) ||
+        !SetupParam("EventHysteresis", param_callback) ||
+        !SetupParam("EventThreshold1", param_callback) ||
+        !SetupParam("EventThreshold2", param_callback) ||
         !SetupParam("centerX", param_callback) ||
         !SetupParam("centerY", param_callback) ||
         !SetupParam("clockwise", param_callback) ||
@@ -51,18 +88,28 @@ ParamHandler::ParamHandler(
         !SetupParam("maxY", param_callback) ||
         !SetupParam("minX", param_callback) ||
         !SetupParam("minY", param_callback) ||
+        !SetupParam("Pipelined", param_callback) ||
+        !SetupParam("PreprocessThreads", param_callback) ||
         !SetupParam("port", param_callback) ||
-        !SetupParam("RoundToDecimals", param_callback))
+        !SetupParam("RoundToDecimals", param_callback) ||
+        !SetupParam("TrackingRescan", param_callback) ||
+        !SetupParam("TrackingWindow", param_callback))
     // clang-format on
     {
         LOG_E("%s/%s: Failed to set up parameters", __FILE__, __FUNCTION__);
         assert(FALSE);
     }
+    usleep(PARAM_SETTLE_US);
+    LOG_I(
+        "%s/%s: Parameters set up in %" G_GINT64_FORMAT " ms",
+        __FILE__,
+        __FUNCTION__,
+        (g_get_monotonic_time() - setup_start) / 1000);
 
     // Log retrieved param values
-    LOG_I("%s/%s: center: (%u, %u)", __FILE__, __FUNCTION__, center_point_.x, center_point_.y);
-    LOG_I("%s/%s: min: (%u, %u)", __FILE__, __FUNCTION__, min_point_.x, min_point_.y);
-    LOG_I("%s/%s: max: (%u, %u)", __FILE__, __FUNCTION__, max_point_.x, max_point_.y);
+    LOG_I("%s/%s: center: (%u, %u)", __FILE__, __FUNCTION__, gauge_params_.center.x, gauge_params_.center.y);
+    LOG_I("%s/%s: min: (%u, %u)", __FILE__, __FUNCTION__, gauge_params_.min.x, gauge_params_.min.y);
+    LOG_I("%s/%s: max: (%u, %u)", __FILE__, __FUNCTION__, gauge_params_.max.x, gauge_params_.max.y);
 }
 
 ParamHandler::~ParamHandler()
@@ -108,8 +155,9 @@ void ParamHandler::UpdateLocalParam(const gchar &name, const guint32 val)
     // Parameters that do not change the Gauge reader go here
     if (0 == strncmp("port", &name, 4))
     {
+        port_ = val;
         assert(nullptr != RestartOpcuaserver_);
-        RestartOpcuaserver_(val);
+        RestartOpcuaserver_(port_);
         return;
     }
     else if (0 == strncmp("DynamicStringNumber", &name, 19))
@@ -118,6 +166,97 @@ void ParamHandler::UpdateLocalParam(const gchar &name, const guint32 val)
         SetDynstrNbr_(val);
         return;
     }
+    else if (0 == strncmp("DebugCapture", &name, 12))
+    {
+        assert(nullptr != SetDebugCapture_);
+        SetDebugCapture_(val);
+        return;
+    }
+    else if (0 == strncmp("Pipelined", &name, 9))
+    {
+        assert(nullptr != SetPipelined_);
+        SetPipelined_(1 == val);
+        return;
+    }
+    else if (0 == strncmp("PreprocessThreads", &name, 17))
+    {
+        assert(nullptr != SetPreprocessThreads_);
+        SetPreprocessThreads_(val);
+        return;
+    }
+    else if (0 == strncmp("CpuBudget", &name, 9))
+    {
+        assert(nullptr != SetCpuBudget_);
+        SetCpuBudget_(val);
+        return;
+    }
+    else if (0 == strncmp("AggregateWindow", &name, 15))
+    {
+        // AggregateWindow1 and AggregateWindow2
+        assert(nullptr != SetAggregateWindow_);
+        SetAggregateWindow_((&name)[15] - '1', val);
+        return;
+    }
+    else if (0 == strncmp("AlarmHighHighLimit", &name, 18))
+    {
+        assert(nullptr != SetAlarmLimit_);
+        SetAlarmLimit_(LIMIT_HIGHHIGH, val);
+        return;
+    }
+    else if (0 == strncmp("AlarmHighLimit", &name, 14))
+    {
+        assert(nullptr != SetAlarmLimit_);
+        SetAlarmLimit_(LIMIT_HIGH, val);
+        return;
+    }
+    else if (0 == strncmp("AlarmLowLimit", &name, 13))
+    {
+        assert(nullptr != SetAlarmLimit_);
+        SetAlarmLimit_(LIMIT_LOW, val);
+        return;
+    }
+    else if (0 == strncmp("AlarmLowLowLimit", &name, 16))
+    {
+        assert(nullptr != SetAlarmLimit_);
+        SetAlarmLimit_(LIMIT_LOWLOW, val);
+        return;
+    }
+    else if (0 == strncmp("AlarmDeadband", &name, 13))
+    {
+        assert(nullptr != SetAlarmDeadband_);
+        SetAlarmDeadband_(val);
+        return;
+    }
+    else if (0 == strncmp("AlarmDelay", &name, 10))
+    {
+        assert(nullptr != SetAlarmDelay_);
+        SetAlarmDelay_(val);
+        return;
+    }
+    else if (0 == strncmp("EventThreshold", &name, 14))
+    {
+        // EventThreshold1 and EventThreshold2
+        assert(nullptr != SetEventThreshold_);
+        SetEventThreshold_((&name)[14] - '1', val);
+        return;
+    }
+    else if (0 == strncmp("EventHysteresis", &name, 15))
+    {
+        assert(nullptr != SetEventHysteresis_);
+        SetEventHysteresis_(val);
+        return;
+    }
+    else if (0 == strncmp("DemandIdleInterval", &name, 18))
+    {
+        assert(nullptr != SetDemandIdleInterval_);
+        SetDemandIdleInterval_(val);
+        return;
+    }
+    else if (0 == strncmp("LogLevel", &name, 8))
+    {
+        Logger::SetLevel(val);
+        return;
+    }
     else if (0 == strncmp("RoundToDecimals", &name, 15))
     {
         g_mutex_lock(&mtx_);
@@ -130,42 +269,60 @@ void ParamHandler::UpdateLocalParam(const gchar &name, const guint32 val)
     g_mutex_lock(&mtx_);
     if (0 == strncmp("cloc", &name, 4))
     {
-        clockwise_ = (1 == val);
+        gauge_params_.clockwise = (1 == val);
     }
     else if (0 == strncmp("centerX", &name, 7))
     {
-        center_point_.x = val;
+        gauge_params_.center.x = val;
     }
     else if (0 == strncmp("centerY", &name, 7))
     {
-        center_point_.y = val;
+        gauge_params_.center.y = val;
     }
     else if (0 == strncmp("minX", &name, 4))
     {
-        min_point_.x = val;
+        gauge_params_.min.x = val;
     }
     else if (0 == strncmp("minY", &name, 4))
     {
-        min_point_.y = val;
+        gauge_params_.min.y = val;
     }
     else if (0 == strncmp("maxX", &name, 4))
     {
-        max_point_.x = val;
+        gauge_params_.max.x = val;
     }
     else if (0 == strncmp("maxY", &name, 4))
     {
-        max_point_.y = val;
+        gauge_params_.max.y = val;
+    }
+    else if (0 == strncmp("TrackingRescan", &name, 14))
+    {
+        gauge_params_.tracking_rescan = val;
+    }
+    else if (0 == strncmp("TrackingWindow", &name, 14))
+    {
+        gauge_params_.tracking_window = val;
+    }
+    else if (0 == strncmp("AverageFrames", &name, 13))
+    {
+        gauge_params_.average_frames = val;
+    }
+    else if (0 == strncmp("BackgroundModel", &name, 15))
+    {
+        gauge_params_.background_model = (1 == val);
     }
     else
     {
         LOG_E("%s/%s: FAILED to act on param %s", __FILE__, __FUNCTION__, &name);
         assert(false);
     }
+    const auto gauge_params = gauge_params_;
     g_mutex_unlock(&mtx_);
 
-    // Recalibrate gauge at next frame
+    // Recalibrate gauge at next frame, with a copy of the parameters that
+    // other threads may read while they change here
     assert(nullptr != ReplaceGauge_);
-    ReplaceGauge_();
+    ReplaceGauge_(gauge_params);
 }
 
 void ParamHandler::param_callback(const gchar *name, const gchar *value, void *data)
@@ -213,7 +370,6 @@ gboolean ParamHandler::SetupParam(const gchar *name, AXParameterCallback callbac
     }
     UpdateLocalParam(*name, val);
     LOG_I("%s/%s: Set up parameter %s", __FILE__, __FUNCTION__, name);
-    usleep(50000); // mitigate timing issue in parameter handling
 
     return TRUE;
 }
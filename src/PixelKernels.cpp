@@ -0,0 +1,265 @@
+/**
+ * Copyright (C) 2025, Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * This file implements the pixel kernels for each supported instruction set
+ * together with the runtime selection of the best one.
+ */
+
+#include <assert.h>
+#include <string.h>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#if !defined(__aarch64__)
+#include <asm/hwcap.h>
+#include <sys/auxv.h>
+#endif
+#elif defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#include "PixelKernels.hpp"
+
+typedef unsigned int (*CountLightFn)(const uint8_t *, size_t, uint8_t);
+typedef void (*InvertRowFn)(uint8_t *, size_t);
+
+struct KernelTable
+{
+    const char *isa;
+    CountLightFn count_light;
+    InvertRowFn invert_row;
+};
+
+static unsigned int CountLightScalar(const uint8_t *img, size_t len, uint8_t threshold)
+{
+    unsigned int light = 0;
+    for (size_t i = 0; i < len; i++)
+    {
+        if (threshold < img[i])
+        {
+            light++;
+        }
+    }
+    return light;
+}
+
+static void InvertRowScalar(uint8_t *row, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        row[i] ^= 0xff;
+    }
+}
+
+// The vector kernels count in 8-bit lanes by subtracting the all-ones compare
+// results, so the lane counters must be flushed before they can wrap.
+#define MAX_LANE_ITERATIONS (255)
+
+#if defined(__ARM_NEON)
+static inline unsigned int HorizontalSum(const uint8x16_t v)
+{
+    const auto wide = vpaddlq_u16(vpaddlq_u8(v));
+#if defined(__aarch64__)
+    return vaddvq_u32(wide);
+#else
+    const auto half = vadd_u32(vget_low_u32(wide), vget_high_u32(wide));
+    return vget_lane_u32(vpadd_u32(half, half), 0);
+#endif
+}
+
+static unsigned int CountLightNeon(const uint8_t *img, size_t len, uint8_t threshold)
+{
+    const auto thr = vdupq_n_u8(threshold);
+    unsigned int light = 0;
+    size_t i = 0;
+    while (i + 16 <= len)
+    {
+        auto acc = vdupq_n_u8(0);
+        for (unsigned int n = 0; MAX_LANE_ITERATIONS > n && i + 16 <= len; n++, i += 16)
+        {
+            acc = vsubq_u8(acc, vcgtq_u8(vld1q_u8(img + i), thr));
+        }
+        light += HorizontalSum(acc);
+    }
+    return light + CountLightScalar(img + i, len - i, threshold);
+}
+
+static void InvertRowNeon(uint8_t *row, size_t len)
+{
+    const auto ones = vdupq_n_u8(0xff);
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16)
+    {
+        vst1q_u8(row + i, veorq_u8(vld1q_u8(row + i), ones));
+    }
+    InvertRowScalar(row + i, len - i);
+}
+#endif
+
+#if defined(__x86_64__)
+__attribute__((target("sse2"))) static unsigned int CountLightSse2(const uint8_t *img, size_t len, uint8_t threshold)
+{
+    const auto zero = _mm_setzero_si128();
+    const auto thr = _mm_set1_epi8(static_cast<char>(threshold));
+    unsigned int light = 0;
+    size_t i = 0;
+    while (i + 16 <= len)
+    {
+        auto acc = _mm_setzero_si128();
+        for (unsigned int n = 0; MAX_LANE_ITERATIONS > n && i + 16 <= len; n++, i += 16)
+        {
+            const auto v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(img + i));
+            // img <= threshold exactly when the saturated difference is zero
+            const auto not_light = _mm_cmpeq_epi8(_mm_subs_epu8(v, thr), zero);
+            acc = _mm_sub_epi8(acc, _mm_andnot_si128(not_light, _mm_set1_epi8(-1)));
+        }
+        const auto sum = _mm_sad_epu8(acc, zero);
+        light += _mm_cvtsi128_si32(sum) + _mm_extract_epi16(sum, 4);
+    }
+    return light + CountLightScalar(img + i, len - i, threshold);
+}
+
+__attribute__((target("sse2"))) static void InvertRowSse2(uint8_t *row, size_t len)
+{
+    const auto ones = _mm_set1_epi8(static_cast<char>(0xff));
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16)
+    {
+        const auto p = reinterpret_cast<__m128i *>(row + i);
+        _mm_storeu_si128(p, _mm_xor_si128(_mm_loadu_si128(p), ones));
+    }
+    InvertRowScalar(row + i, len - i);
+}
+
+__attribute__((target("avx2"))) static unsigned int CountLightAvx2(const uint8_t *img, size_t len, uint8_t threshold)
+{
+    const auto zero = _mm256_setzero_si256();
+    const auto thr = _mm256_set1_epi8(static_cast<char>(threshold));
+    unsigned int light = 0;
+    size_t i = 0;
+    while (i + 32 <= len)
+    {
+        auto acc = _mm256_setzero_si256();
+        for (unsigned int n = 0; MAX_LANE_ITERATIONS > n && i + 32 <= len; n++, i += 32)
+        {
+            const auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(img + i));
+            const auto not_light = _mm256_cmpeq_epi8(_mm256_subs_epu8(v, thr), zero);
+            acc = _mm256_sub_epi8(acc, _mm256_andnot_si256(not_light, _mm256_set1_epi8(-1)));
+        }
+        const auto sum = _mm256_sad_epu8(acc, zero);
+        light += _mm256_extract_epi64(sum, 0) + _mm256_extract_epi64(sum, 1) + _mm256_extract_epi64(sum, 2) +
+                 _mm256_extract_epi64(sum, 3);
+    }
+    // The compiler does not clear the upper halves for the legacy SSE code that follows
+    _mm256_zeroupper();
+    return light + CountLightSse2(img + i, len - i, threshold);
+}
+
+__attribute__((target("avx2"))) static void InvertRowAvx2(uint8_t *row, size_t len)
+{
+    const auto ones = _mm256_set1_epi8(static_cast<char>(0xff));
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32)
+    {
+        const auto p = reinterpret_cast<__m256i *>(row + i);
+        _mm256_storeu_si256(p, _mm256_xor_si256(_mm256_loadu_si256(p), ones));
+    }
+    _mm256_zeroupper();
+    InvertRowSse2(row + i, len - i);
+}
+#endif
+
+// All implementations built for this architecture, the best first
+static const KernelTable kernel_tables[] = {
+#if defined(__ARM_NEON)
+    {"NEON", CountLightNeon, InvertRowNeon},
+#elif defined(__x86_64__)
+    {"AVX2", CountLightAvx2, InvertRowAvx2},
+    {"SSE2", CountLightSse2, InvertRowSse2},
+#endif
+    {"scalar", CountLightScalar, InvertRowScalar}};
+
+static bool Supported(const KernelTable &table)
+{
+#if defined(__ARM_NEON) && !defined(__aarch64__)
+    if (0 == strcmp("NEON", table.isa))
+    {
+        return 0 != (getauxval(AT_HWCAP) & HWCAP_NEON);
+    }
+#elif defined(__x86_64__)
+    __builtin_cpu_init();
+    if (0 == strcmp("AVX2", table.isa))
+    {
+        return __builtin_cpu_supports("avx2");
+    }
+    if (0 == strcmp("SSE2", table.isa))
+    {
+        return __builtin_cpu_supports("sse2");
+    }
+#endif
+    (void)table;
+    return true;
+}
+
+static KernelTable SelectKernels()
+{
+    for (const auto &table : kernel_tables)
+    {
+        if (Supported(table))
+        {
+            return table;
+        }
+    }
+    return kernel_tables[sizeof(kernel_tables) / sizeof(kernel_tables[0]) - 1];
+}
+
+static KernelTable &Kernels()
+{
+    static KernelTable table = SelectKernels();
+    return table;
+}
+
+unsigned int PixelKernels::CountLight(const uint8_t *img, const size_t len, const uint8_t threshold)
+{
+    assert(nullptr != img);
+    return Kernels().count_light(img, len, threshold);
+}
+
+void PixelKernels::InvertRow(uint8_t *row, const size_t len)
+{
+    assert(nullptr != row);
+    Kernels().invert_row(row, len);
+}
+
+const char *PixelKernels::Isa()
+{
+    return Kernels().isa;
+}
+
+bool PixelKernels::SelectIsa(const char *isa)
+{
+    assert(nullptr != isa);
+    for (const auto &table : kernel_tables)
+    {
+        if (0 == strcmp(isa, table.isa) && Supported(table))
+        {
+            Kernels() = table;
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,123 @@
+/**
+ * Copyright (C) 2025, Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <assert.h>
+#include <cmath>
+
+#include "ReadingFilter.hpp"
+
+using namespace std;
+
+// Variance (percent squared) of the needle movement between two readings
+#define PROCESS_VARIANCE (0.5)
+// Variance (percent squared) of a reading with full detector confidence
+#define READING_VARIANCE (1.0)
+// Lowest detector confidence used to scale the reading variance
+#define MIN_CONFIDENCE (0.05)
+// Readings more standard deviations than this from the prediction are outliers
+#define OUTLIER_GATE (4.0)
+// Consecutive outliers that agree with each other accepted as a real jump of
+// the needle
+#define MAX_OUTLIERS (3)
+
+ReadingFilter::ReadingFilter()
+{
+    Reset();
+}
+
+void ReadingFilter::Reset()
+{
+    initialized_ = false;
+    value_ = -1;
+    variance_ = 0;
+    confidence_ = 0;
+    outliers_ = 0;
+    outlier_value_ = 0;
+    outlier_variance_ = 0;
+}
+
+/**
+ * brief Add a reading to the filter.
+ *
+ * The confidence of the filtered value is the detector confidence times the
+ * agreement of the reading with the prediction.
+ *
+ * param reading Gauge reading (percent).
+ * param detector_confidence Confidence of the reading, between 0 and 1.
+ * return False if the reading was rejected as an outlier.
+ */
+bool ReadingFilter::Update(const double reading, const double detector_confidence)
+{
+    assert(0 <= detector_confidence && 1 >= detector_confidence);
+    const auto reading_variance = READING_VARIANCE / max(MIN_CONFIDENCE, detector_confidence);
+    if (!initialized_)
+    {
+        initialized_ = true;
+        value_ = reading;
+        variance_ = reading_variance;
+        confidence_ = detector_confidence;
+        return true;
+    }
+
+    // Predict, then gate the reading on its normalized innovation
+    const auto predicted_variance = variance_ + PROCESS_VARIANCE;
+    const auto innovation = reading - value_;
+    const auto innovation_variance = predicted_variance + reading_variance;
+    const auto z2 = innovation * innovation / innovation_variance;
+    if (OUTLIER_GATE * OUTLIER_GATE < z2)
+    {
+        // Gate the outlier the same way on the outliers before it, e.g. a
+        // person passing by gives outliers that do not agree
+        const auto outlier_predicted_variance = outlier_variance_ + PROCESS_VARIANCE;
+        const auto outlier_innovation = reading - outlier_value_;
+        const auto outlier_innovation_variance = outlier_predicted_variance + reading_variance;
+        const auto outlier_z2 = outlier_innovation * outlier_innovation / outlier_innovation_variance;
+        if (0 == outliers_ || OUTLIER_GATE * OUTLIER_GATE < outlier_z2)
+        {
+            outliers_ = 1;
+            outlier_value_ = reading;
+            outlier_variance_ = reading_variance;
+        }
+        else
+        {
+            outliers_++;
+            const auto outlier_gain = outlier_predicted_variance / outlier_innovation_variance;
+            outlier_value_ += outlier_gain * outlier_innovation;
+            outlier_variance_ = (1 - outlier_gain) * outlier_predicted_variance;
+        }
+        if (MAX_OUTLIERS > outliers_)
+        {
+            variance_ = predicted_variance;
+            confidence_ = 0;
+            return false;
+        }
+
+        // The needle has really moved; start over from the outliers
+        outliers_ = 0;
+        value_ = outlier_value_;
+        variance_ = outlier_variance_;
+        confidence_ = detector_confidence;
+        return true;
+    }
+
+    outliers_ = 0;
+    const auto gain = predicted_variance / innovation_variance;
+    value_ += gain * innovation;
+    variance_ = (1 - gain) * predicted_variance;
+    confidence_ = detector_confidence * exp(-0.5 * z2);
+    return true;
+}
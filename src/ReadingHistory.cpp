@@ -0,0 +1,485 @@
+/**
+ * Copyright (C) 2025, Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * This file implements the ring file of the reading history.
+ */
+
+#include <algorithm>
+#include <assert.h>
+#include <cmath>
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "ReadingHistory.hpp"
+#include "common.hpp"
+
+using namespace std;
+
+#define HISTORY_FILE_MAGIC (0x46485247)  // "GRHF"
+#define HISTORY_BLOCK_MAGIC (0x42485247) // "GRHB"
+#define HISTORY_FILE_VERSION (2)
+// Stored values are in units of 0.01 percent
+#define HISTORY_VALUE_SCALE (100)
+// Two varints of at most 10 bytes and the status
+#define HISTORY_MAX_READING_BYTES (21U)
+
+// The first block of the file describes it, the ring follows
+struct FileHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t block_bytes;
+    uint32_t blocks;
+};
+
+static inline uint64_t ZigZag(const int64_t value)
+{
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+static inline int64_t UnZigZag(const uint64_t value)
+{
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+static inline size_t PutVarint(uint8_t *dst, uint64_t value)
+{
+    size_t bytes = 0;
+    while (0x80 <= value)
+    {
+        dst[bytes++] = static_cast<uint8_t>(value | 0x80);
+        value >>= 7;
+    }
+    dst[bytes++] = static_cast<uint8_t>(value);
+    return bytes;
+}
+
+static inline bool GetVarint(const uint8_t *&src, const uint8_t *end, uint64_t &value)
+{
+    value = 0;
+    for (auto shift = 0; end > src && 64 > shift; shift += 7)
+    {
+        const auto byte = *src++;
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (0 == (byte & 0x80))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+ReadingHistory::ReadingHistory(
+    const unsigned int blocks,
+    const unsigned int interval_ms,
+    const unsigned int flush_period_s)
+    : blocks_(blocks), interval_ms_(interval_ms), flush_period_ms_(1000 * static_cast<int64_t>(flush_period_s)),
+      fd_(-1), map_(nullptr), map_bytes_(0), head_(0), open_block_(), cursor_(), recorded_ms_(0),
+      last_status_(HISTORY_GOOD), unflushed_ms_(0), stats_()
+{
+    assert(1 < blocks_);
+}
+
+ReadingHistory::~ReadingHistory()
+{
+    Flush();
+    if (nullptr != map_)
+    {
+        munmap(map_, map_bytes_);
+    }
+    if (0 <= fd_)
+    {
+        close(fd_);
+    }
+}
+
+/**
+ * brief Open the history file, or create it if it is missing or of another layout.
+ *
+ * param filename Path of the file.
+ * return False if any errors occur, otherwise true.
+ */
+bool ReadingHistory::Open(const string &filename)
+{
+    lock_guard<mutex> lock(mutex_);
+    assert(nullptr == map_);
+
+    fd_ = open(filename.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (0 > fd_)
+    {
+        LOG_E("%s/%s: Failed to open %s (%s)", __FILE__, __FUNCTION__, filename.c_str(), strerror(errno));
+        return false;
+    }
+
+    map_bytes_ = static_cast<size_t>(blocks_ + 1) * HISTORY_BLOCK_BYTES;
+    const FileHeader expected = {HISTORY_FILE_MAGIC, HISTORY_FILE_VERSION, HISTORY_BLOCK_BYTES, blocks_};
+    FileHeader header = {};
+    struct stat st;
+    if (0 != fstat(fd_, &st) || map_bytes_ != static_cast<size_t>(st.st_size) ||
+        sizeof(header) != pread(fd_, &header, sizeof(header), 0) || 0 != memcmp(&header, &expected, sizeof(header)))
+    {
+        // Start over; the blocks of a new file read as never written
+        LOG_I("%s/%s: Creating history %s of %u blocks", __FILE__, __FUNCTION__, filename.c_str(), blocks_);
+        if (0 != ftruncate(fd_, 0) || 0 != ftruncate(fd_, map_bytes_) ||
+            sizeof(expected) != pwrite(fd_, &expected, sizeof(expected), 0))
+        {
+            LOG_E("%s/%s: Failed to create %s (%s)", __FILE__, __FUNCTION__, filename.c_str(), strerror(errno));
+            close(fd_);
+            fd_ = -1;
+            return false;
+        }
+    }
+
+    const auto map = mmap(nullptr, map_bytes_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (MAP_FAILED == map)
+    {
+        LOG_E("%s/%s: Failed to map %s (%s)", __FILE__, __FUNCTION__, filename.c_str(), strerror(errno));
+        close(fd_);
+        fd_ = -1;
+        return false;
+    }
+    map_ = static_cast<uint8_t *>(map);
+
+    // Continue after the newest valid block
+    auto newest = -1;
+    for (auto i = 0U; blocks_ > i; i++)
+    {
+        const auto &block = *GetBlock(i);
+        if (ValidBlock(block) && (0 > newest || block.header.sequence > GetBlock(newest)->header.sequence))
+        {
+            newest = i;
+        }
+    }
+    if (0 > newest)
+    {
+        head_ = 0;
+        open_block_.header.sequence = 0;
+        StartBlock();
+    }
+    else
+    {
+        head_ = newest;
+        open_block_ = *GetBlock(head_);
+        cursor_ = Decode(open_block_, 0, 0, 0, nullptr);
+        recorded_ms_ = cursor_.time_ms;
+        last_status_ = cursor_.status;
+        if (sizeof(open_block_.data) < open_block_.header.bytes + HISTORY_MAX_READING_BYTES)
+        {
+            head_ = (head_ + 1) % blocks_;
+            StartBlock();
+        }
+    }
+    LOG_I(
+        "%s/%s: History in %s continues in block %u (sequence %u)",
+        __FILE__,
+        __FUNCTION__,
+        filename.c_str(),
+        head_,
+        open_block_.header.sequence);
+
+    return true;
+}
+
+/**
+ * brief Record a reading.
+ *
+ * Readings less than the interval after the last one recorded are skipped,
+ * unless their status differs.
+ *
+ * param time_ms Unix time (ms) of the reading.
+ * param value Reading (percent), -1 if none.
+ * param status Status of the reading.
+ */
+void ReadingHistory::Append(const int64_t time_ms, const double value, const HistoryStatus status)
+{
+    lock_guard<mutex> lock(mutex_);
+    if (nullptr == map_)
+    {
+        return;
+    }
+    // A clock set backwards is no reason to skip
+    if (0 < recorded_ms_ && status == last_status_ && recorded_ms_ <= time_ms && interval_ms_ > time_ms - recorded_ms_)
+    {
+        stats_.skipped++;
+        return;
+    }
+
+    auto &header = open_block_.header;
+    if (0 == header.count)
+    {
+        header.base_ms = time_ms;
+        header.first_ms = time_ms;
+        header.last_ms = time_ms;
+        cursor_ = {time_ms, 0, 0, HISTORY_GOOD};
+    }
+
+    // The change of the time step, with a flag for a change of status, then
+    // the change of the value
+    const auto step_ms = time_ms - cursor_.time_ms;
+    const auto scaled = static_cast<int64_t>(llround(value * HISTORY_VALUE_SCALE));
+    const auto changed = status != cursor_.status;
+    auto dst = open_block_.data + header.bytes;
+    auto bytes = PutVarint(dst, (ZigZag(step_ms - cursor_.step_ms) << 1) | (changed ? 1 : 0));
+    bytes += PutVarint(dst + bytes, ZigZag(scaled - cursor_.value));
+    if (changed)
+    {
+        dst[bytes++] = static_cast<uint8_t>(status);
+    }
+    cursor_ = {time_ms, step_ms, scaled, status};
+    header.bytes += bytes;
+    header.count++;
+    header.first_ms = min(header.first_ms, time_ms);
+    header.last_ms = max(header.last_ms, time_ms);
+    recorded_ms_ = time_ms;
+    last_status_ = status;
+    stats_.readings++;
+    stats_.encoded_bytes += bytes;
+    if (0 == unflushed_ms_)
+    {
+        unflushed_ms_ = time_ms;
+    }
+
+    if (sizeof(open_block_.data) < header.bytes + HISTORY_MAX_READING_BYTES)
+    {
+        // Full, move on to the next block of the ring
+        WriteBlock();
+        head_ = (head_ + 1) % blocks_;
+        StartBlock();
+    }
+    else if (flush_period_ms_ <= time_ms - unflushed_ms_ || time_ms < unflushed_ms_)
+    {
+        WriteBlock();
+    }
+}
+
+/**
+ * brief Write the readings kept in memory to the file.
+ *
+ * return False if the write failed, otherwise true.
+ */
+bool ReadingHistory::Flush()
+{
+    lock_guard<mutex> lock(mutex_);
+    if (nullptr == map_ || 0 == unflushed_ms_)
+    {
+        return true;
+    }
+
+    return WriteBlock();
+}
+
+/**
+ * brief Get the readings of a time range, oldest first.
+ *
+ * param from_ms Unix time (ms) of the first reading to get.
+ * param to_ms Unix time (ms) of the last reading to get.
+ * param max_readings Most readings to get.
+ * param readings Readings, appended to.
+ * return Number of readings appended.
+ */
+size_t ReadingHistory::Query(
+    const int64_t from_ms,
+    const int64_t to_ms,
+    const size_t max_readings,
+    vector<HistoryReading> &readings)
+{
+    lock_guard<mutex> lock(mutex_);
+    const auto size = readings.size();
+    if (nullptr == map_)
+    {
+        return 0;
+    }
+
+    // The ring from the oldest block to the one being filled; the block
+    // headers tell which blocks to decode
+    for (auto i = 1U; blocks_ >= i && max_readings > readings.size() - size; i++)
+    {
+        const auto block = GetReadBlock((head_ + i) % blocks_);
+        if (nullptr != block && from_ms <= block->header.last_ms && to_ms >= block->header.first_ms)
+        {
+            Decode(*block, from_ms, to_ms, size + max_readings, &readings);
+        }
+    }
+
+    return readings.size() - size;
+}
+
+ReadingHistory::Stats ReadingHistory::GetStats()
+{
+    lock_guard<mutex> lock(mutex_);
+    auto stats = stats_;
+    for (auto i = 1U; nullptr != map_ && blocks_ >= i; i++)
+    {
+        const auto block = GetReadBlock((head_ + i) % blocks_);
+        if (nullptr != block)
+        {
+            stats.blocks++;
+            stats.stored += block->header.count;
+            stats.oldest_ms = 0 == stats.oldest_ms ? block->header.first_ms : stats.oldest_ms;
+        }
+    }
+
+    return stats;
+}
+
+ReadingHistory::Block *ReadingHistory::GetBlock(const unsigned int index) const
+{
+    assert(blocks_ > index);
+    return reinterpret_cast<Block *>(map_ + static_cast<size_t>(index + 1) * HISTORY_BLOCK_BYTES);
+}
+
+/**
+ * brief Get a block to read, the one being filled from memory.
+ *
+ * param index Index of the block in the ring.
+ * return The block, or nullptr if it holds no valid readings.
+ */
+const ReadingHistory::Block *ReadingHistory::GetReadBlock(const unsigned int index) const
+{
+    if (head_ == index)
+    {
+        return 0 < open_block_.header.count ? &open_block_ : nullptr;
+    }
+    const auto block = GetBlock(index);
+
+    return ValidBlock(*block) ? block : nullptr;
+}
+
+/**
+ * brief Start filling an empty block, numbered after the previous one.
+ */
+void ReadingHistory::StartBlock()
+{
+    const auto sequence = open_block_.header.sequence + 1;
+    memset(&open_block_, 0, sizeof(open_block_));
+    open_block_.header.magic = HISTORY_BLOCK_MAGIC;
+    open_block_.header.sequence = sequence;
+    cursor_ = {0, 0, 0, HISTORY_GOOD};
+}
+
+/**
+ * brief Copy the block being filled to the file and wait for it to be written.
+ */
+bool ReadingHistory::WriteBlock()
+{
+    open_block_.header.checksum = Checksum(open_block_);
+    auto block = GetBlock(head_);
+    memcpy(block, &open_block_, sizeof(open_block_));
+    unflushed_ms_ = 0;
+    stats_.flushes++;
+    stats_.flushed_bytes += sizeof(open_block_);
+
+    // The page size may be larger than the block
+    const auto page = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+    const auto start = reinterpret_cast<uintptr_t>(block) & ~(page - 1);
+    const auto end = reinterpret_cast<uintptr_t>(block) + sizeof(open_block_);
+    if (0 != msync(reinterpret_cast<void *>(start), end - start, MS_SYNC))
+    {
+        LOG_E("%s/%s: Failed to write block %u (%s)", __FILE__, __FUNCTION__, head_, strerror(errno));
+        return false;
+    }
+
+    return true;
+}
+
+uint32_t ReadingHistory::Checksum(const Block &block)
+{
+    auto hash = 2166136261U;
+    const auto header = reinterpret_cast<const uint8_t *>(&block.header);
+    for (size_t i = 0; offsetof(BlockHeader, checksum) > i; i++)
+    {
+        hash = (hash ^ header[i]) * 16777619U;
+    }
+    for (size_t i = 0; min<size_t>(block.header.bytes, sizeof(block.data)) > i; i++)
+    {
+        hash = (hash ^ block.data[i]) * 16777619U;
+    }
+
+    return hash;
+}
+
+/**
+ * brief Check whether a block holds readings, and was written completely.
+ */
+bool ReadingHistory::ValidBlock(const Block &block)
+{
+    return HISTORY_BLOCK_MAGIC == block.header.magic && 0 < block.header.count &&
+           sizeof(block.data) >= block.header.bytes && Checksum(block) == block.header.checksum;
+}
+
+/**
+ * brief Decode the readings of a block.
+ *
+ * param block Block to decode.
+ * param from_ms Unix time (ms) of the first reading to get.
+ * param to_ms Unix time (ms) of the last reading to get.
+ * param max_readings Size of readings to stop at.
+ * param readings Readings, appended to, or nullptr to only decode.
+ * return The last reading of the block.
+ */
+ReadingHistory::Cursor ReadingHistory::Decode(
+    const Block &block,
+    const int64_t from_ms,
+    const int64_t to_ms,
+    const size_t max_readings,
+    vector<HistoryReading> *readings)
+{
+    Cursor cursor = {block.header.base_ms, 0, 0, HISTORY_GOOD};
+    auto src = static_cast<const uint8_t *>(block.data);
+    const auto end = src + block.header.bytes;
+    for (auto i = 0; block.header.count > i; i++)
+    {
+        uint64_t time_code;
+        uint64_t value_code;
+        if (!GetVarint(src, end, time_code) || !GetVarint(src, end, value_code))
+        {
+            break;
+        }
+        cursor.step_ms += UnZigZag(time_code >> 1);
+        cursor.time_ms += cursor.step_ms;
+        cursor.value += UnZigZag(value_code);
+        if (1 & time_code)
+        {
+            if (end <= src)
+            {
+                break;
+            }
+            cursor.status = static_cast<HistoryStatus>(min<int>(*src++, HISTORY_FAILED));
+        }
+        if (nullptr == readings)
+        {
+            continue;
+        }
+        if (max_readings <= readings->size())
+        {
+            break;
+        }
+        if (from_ms <= cursor.time_ms && to_ms >= cursor.time_ms)
+        {
+            readings->push_back(
+                {cursor.time_ms, static_cast<double>(cursor.value) / HISTORY_VALUE_SCALE, cursor.status});
+        }
+    }
+
+    return cursor;
+}
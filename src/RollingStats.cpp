@@ -0,0 +1,210 @@
+/**
+ * Copyright (C) 2025, Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * This file implements the rolling statistics of the gauge readings.
+ */
+
+#include <algorithm>
+#include <assert.h>
+#include <cmath>
+
+#include "RollingStats.hpp"
+
+using namespace std;
+
+RollingStats::RollingStats() : window_s_(0), bucket_us_(1), origin_us_(0), failed_(0), moments_()
+{
+}
+
+/**
+ * brief Set the length of the window, dropping the readings held.
+ *
+ * param window_s Window (s), 0 to hold no readings.
+ */
+void RollingStats::SetWindow(const unsigned int window_s)
+{
+    window_s_ = window_s;
+    bucket_us_ = max(1000000LL * window_s_ / ROLLING_STATS_MAX_BUCKETS, 1LL);
+    Clear();
+}
+
+/**
+ * brief Add a reading and expire the readings that left the window.
+ *
+ * param time_us Monotonic time (µs) of the reading.
+ * param value Reading, negative if it failed.
+ */
+void RollingStats::Add(const int64_t time_us, const double value)
+{
+    if (0 == window_s_)
+    {
+        return;
+    }
+    Expire(time_us);
+    const auto bucket_start_us = time_us - time_us % bucket_us_;
+    if (buckets_.empty() || bucket_start_us != buckets_.back().time_us)
+    {
+        buckets_.push_back({bucket_start_us, 0, {}});
+    }
+    auto &bucket = buckets_.back();
+    if (0 > value)
+    {
+        bucket.failed++;
+        failed_++;
+        return;
+    }
+    if (0 == moments_.count)
+    {
+        origin_us_ = time_us;
+    }
+
+    const auto t = 1e-6 * (time_us - origin_us_);
+    bucket.moments.Add(t, value);
+    moments_.Add(t, value);
+
+    // Keep one entry per bucket; it expires with the bucket
+    if (min_.empty() || bucket_start_us != min_.back().time_us || min_.back().value > value)
+    {
+        while (!min_.empty() && min_.back().value >= value)
+        {
+            min_.pop_back();
+        }
+        min_.push_back({bucket_start_us, value});
+    }
+    if (max_.empty() || bucket_start_us != max_.back().time_us || max_.back().value < value)
+    {
+        while (!max_.empty() && max_.back().value <= value)
+        {
+            max_.pop_back();
+        }
+        max_.push_back({bucket_start_us, value});
+    }
+}
+
+/**
+ * brief Drop the buckets that started before the window.
+ *
+ * param time_us Monotonic time (µs) now.
+ */
+void RollingStats::Expire(const int64_t time_us)
+{
+    const auto oldest_us = time_us - 1000000LL * window_s_;
+    while (!buckets_.empty() && oldest_us > buckets_.front().time_us)
+    {
+        const auto &oldest = buckets_.front();
+        // The oldest entries of the deques are at most as old as the oldest bucket
+        if (!min_.empty() && oldest.time_us == min_.front().time_us)
+        {
+            min_.pop_front();
+        }
+        if (!max_.empty() && oldest.time_us == max_.front().time_us)
+        {
+            max_.pop_front();
+        }
+        failed_ -= oldest.failed;
+        moments_.Remove(oldest.moments);
+        buckets_.pop_front();
+    }
+}
+
+RollingStats::Values RollingStats::GetValues() const
+{
+    Values values = {moments_.count, failed_, NAN, NAN, NAN, NAN, NAN};
+    if (0 == moments_.count)
+    {
+        return values;
+    }
+    values.min = min_.front().value;
+    values.max = max_.front().value;
+    values.mean = moments_.mean;
+    if (1 < moments_.count)
+    {
+        values.stddev = sqrt(max(moments_.m2, 0.0) / (moments_.count - 1));
+    }
+    if (0 < moments_.m2_t)
+    {
+        values.rate_per_min = 60 * moments_.c_tv / moments_.m2_t;
+    }
+
+    return values;
+}
+
+void RollingStats::Clear()
+{
+    buckets_.clear();
+    min_.clear();
+    max_.clear();
+    origin_us_ = 0;
+    failed_ = 0;
+    moments_ = {};
+}
+
+/**
+ * brief Add a reading with Welford's method.
+ *
+ * param t Time (s) of the reading after origin_us_.
+ * param value Reading.
+ */
+void RollingStats::Moments::Add(const double t, const double value)
+{
+    count++;
+    const double n = count;
+    const auto delta_t = t - mean_t;
+    const auto delta = value - mean;
+    mean_t += delta_t / n;
+    mean += delta / n;
+    m2 += delta * (value - mean);
+    m2_t += delta_t * (t - mean_t);
+    c_tv += delta_t * (value - mean);
+}
+
+/**
+ * brief Take out the moments of a part of the readings, by reversing the
+ *        pairwise combination of Chan et al.
+ *
+ * param part Moments of readings that were added to these.
+ */
+void RollingStats::Moments::Remove(const Moments &part)
+{
+    assert(part.count <= count);
+    if (0 == part.count)
+    {
+        return;
+    }
+    if (part.count == count)
+    {
+        // Reset rather than leave the rounding errors behind
+        *this = {};
+        return;
+    }
+
+    const double n = count;
+    const double n_part = part.count;
+    const double n_rest = count - part.count;
+    const auto mean_rest = (n * mean - n_part * part.mean) / n_rest;
+    const auto mean_t_rest = (n * mean_t - n_part * part.mean_t) / n_rest;
+    const auto delta = part.mean - mean_rest;
+    const auto delta_t = part.mean_t - mean_t_rest;
+    const auto weight = n_rest * n_part / n;
+    m2 -= part.m2 + delta * delta * weight;
+    m2_t -= part.m2_t + delta_t * delta_t * weight;
+    c_tv -= part.c_tv + delta_t * delta * weight;
+    mean = mean_rest;
+    mean_t = mean_t_rest;
+    count -= part.count;
+}
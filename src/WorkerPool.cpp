@@ -0,0 +1,114 @@
+/**
+ * Copyright (C) 2025, Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <assert.h>
+
+#include "WorkerPool.hpp"
+#include "common.hpp"
+
+using namespace std;
+
+/**
+ * brief Start the worker threads.
+ *
+ * param threads Number of threads that run tasks, including the caller of Run().
+ */
+WorkerPool::WorkerPool(const unsigned int threads)
+    : task_(nullptr), tasks_(0), tag_(MatPool::TAG_OTHER), pending_(0), generation_(0), stopping_(false)
+{
+    assert(0 < threads);
+    for (auto i = 1U; i < threads; i++)
+    {
+        workers_.emplace_back(RunWorker, this, i);
+    }
+    LOG_I("%s/%s: Started %u worker threads", __FILE__, __FUNCTION__, threads - 1);
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        lock_guard<mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    start_cond_.notify_all();
+    for (auto &worker : workers_)
+    {
+        worker.join();
+    }
+}
+
+/**
+ * brief Run tasks 0 to tasks - 1 and wait for them to finish.
+ *
+ * param tasks Number of tasks, at most GetThreads().
+ * param task Task to run, called with the task index.
+ */
+void WorkerPool::Run(const unsigned int tasks, const function<void(const unsigned int)> &task)
+{
+    assert(0 < tasks && GetThreads() >= tasks);
+    {
+        lock_guard<mutex> lock(mutex_);
+        task_ = &task;
+        tasks_ = tasks;
+        tag_ = MatPool::GetTag();
+        pending_ = tasks - 1;
+        generation_++;
+    }
+    if (1 < tasks)
+    {
+        start_cond_.notify_all();
+    }
+
+    task(0);
+
+    unique_lock<mutex> lock(mutex_);
+    done_cond_.wait(lock, [this] { return 0 == pending_; });
+    task_ = nullptr;
+}
+
+void WorkerPool::RunWorker(WorkerPool *parent, const unsigned int index)
+{
+    assert(nullptr != parent);
+    unsigned long generation = 0;
+    unique_lock<mutex> lock(parent->mutex_);
+    while (true)
+    {
+        parent->start_cond_.wait(
+            lock, [parent, generation] { return parent->stopping_ || generation != parent->generation_; });
+        if (parent->stopping_)
+        {
+            break;
+        }
+        generation = parent->generation_;
+        if (index >= parent->tasks_)
+        {
+            continue;
+        }
+
+        const auto task = parent->task_;
+        const auto tag = parent->tag_;
+        lock.unlock();
+        {
+            MatTag task_tag(tag);
+            (*task)(index);
+        }
+        lock.lock();
+        if (0 == --parent->pending_)
+        {
+            parent->done_cond_.notify_one();
+        }
+    }
+}
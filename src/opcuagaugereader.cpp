@@ -14,41 +14,138 @@
  * limitations under the License.
  */
 
+#include <atomic>
 #include <format>
 #include <mutex>
 #include <opencv2/imgproc.hpp>
 #include <opencv2/video.hpp>
 #include <string>
 #include <syslog.h>
+#include <thread>
 #include <utility>
 
+#include "AnalysisPipeline.hpp"
+#include "CpuGovernor.hpp"
+#include "DebugCapture.hpp"
 #include "DynamicStringHandler.hpp"
 #include "EventPusher.hpp"
 #include "Gauge.hpp"
+#include "HistoryExport.hpp"
 #include "ImageProvider.hpp"
+#include "LimitAlarm.hpp"
+#include "MatPool.hpp"
 #include "OpcUaServer.hpp"
 #include "ParamHandler.hpp"
+#include "ReadingFilter.hpp"
+#include "ReadingHistory.hpp"
+#include "RollingStats.hpp"
+#include "WorkerPool.hpp"
 #include "common.hpp"
 
 using namespace cv;
 using namespace std;
 
+// Where the applications' data lives; the host simulation build moves it
+#ifndef PACKAGES_DIR
+#define PACKAGES_DIR "/usr/local/packages/"
+#endif
+
+// Period of the image memory diagnostics
+#define MEMORY_STATS_PERIOD_S (5)
+// Period of the reading history diagnostics
+#define HISTORY_STATS_PERIOD_S (60)
+// Windows of the rolling aggregates of the reading, and their update period
+#define NUM_AGGREGATE_WINDOWS (2)
+#define AGGREGATES_PERIOD_S (1)
+// Longest time after start that the events wait for the first reading
+// before they are declared
+#define EVENTS_DECLARE_DELAY_MS (5000)
+
+// Startup phases, each stamped once, in µs after main() started
+enum StartupPhase
+{
+    STARTUP_PARAMS,        // Parameters set up and OPC UA server launched
+    STARTUP_STREAM,        // Stream set up and fetching frames
+    STARTUP_FIRST_FRAME,   // First frame taken for analysis
+    STARTUP_GAUGE,         // Gauge set up on the first frame
+    STARTUP_FIRST_READING, // First reading published
+    STARTUP_EVENTS,        // Events declared
+    NUM_STARTUP_PHASES
+};
+static const char *startup_phase_names[NUM_STARTUP_PHASES] =
+    {"Params", "Stream", "FirstFrame", "Gauge", "FirstReading", "Events"};
+static gint64 startup_us_ = 0;
+static atomic<gint64> startup_phase_us_[NUM_STARTUP_PHASES];
+
 static GMainLoop *loop_ = nullptr;
 
+// Interval (ms) of the analysis while no client reads the reading, 0 to
+// analyze regardless of the clients
+static atomic<guint> demand_idle_ms_(0);
+
 static mutex mtx_;
 
+// The capture reads the generation of the gauge, its parameters and its crop
+// under mtx_; the gauge, the filter and the worker pool belong to the analysis
+static atomic<unsigned long> gauge_generation_(0);
+static GaugeParams gauge_params_;
+static Rect crop_rect_;
 static Gauge *gauge_ = nullptr;
+static unsigned long analysis_generation_ = 0;
+static ReadingFilter filter_;
+static WorkerPool *worker_pool_ = nullptr;
+static atomic<guint> preprocess_threads_(1);
+
 static OpcUaServer opcuaserver_;
-static EventPusher evpusher_;
+static EventPusher *evpusher_ = nullptr;
+static CpuGovernor governor_;
 static gdouble lastvalue_ = -1.0;
+static RollingStats aggregates_[NUM_AGGREGATE_WINDOWS];
+static const char *aggregate_names[] = {"Count", "Failed", "Min", "Max", "Mean", "StdDev", "RatePerMin"};
+static LimitAlarm limit_alarm_;
+// Names of the limit alarm states, from LIMIT_LOWLOW
+static const char *limit_state_names[] = {"LowLow", "Low", "Normal", "High", "HighHigh"};
+// Threshold bands of the events, kept here until the events are declared
+static gdouble event_thresholds_[NUM_EVENT_THRESHOLDS] = {NAN, NAN};
+static gdouble event_hysteresis_ = 0;
 
 static ImageProvider *provider_ = nullptr;
-static Mat nv12_mat_;
-static Mat gray_mat_;
-
+static Size luma_size_;
+static PipelineFrame serial_frame_;
+static AnalysisPipeline *pipeline_ = nullptr;
+static guint frame_source_ = 0;
+static gboolean pipelined_ = FALSE;
+
+static DebugCapture *debug_capture_ = nullptr;
+static ReadingHistory *history_ = nullptr;
+static HistoryExport *history_export_ = nullptr;
 static DynamicStringHandler *dynstr_handler_ = nullptr;
 static ParamHandler *param_handler_ = nullptr;
 
+static void mark_startup_phase(const StartupPhase phase)
+{
+    gint64 unset = 0;
+    const auto elapsed = MAX(g_get_monotonic_time() - startup_us_, 1);
+    if (startup_phase_us_[phase].compare_exchange_strong(unset, elapsed))
+    {
+        LOG_I("%s/%s: %s done after %.1f ms", __FILE__, __FUNCTION__, startup_phase_names[phase], 1e-3 * elapsed);
+    }
+}
+
+static void publish_startup_phases()
+{
+    for (auto phase = 0; NUM_STARTUP_PHASES > phase; phase++)
+    {
+        const gint64 elapsed = startup_phase_us_[phase];
+        if (0 < elapsed)
+        {
+            opcuaserver_.UpdateDiagnosticValue(
+                std::format("Startup{}Ms", startup_phase_names[phase]).c_str(),
+                1e-3 * elapsed);
+        }
+    }
+}
+
 static void restart_opcuaserver(const guint32 port)
 {
     mtx_.lock();
@@ -64,14 +161,13 @@ static void restart_opcuaserver(const guint32 port)
     mtx_.unlock();
 }
 
-static void replace_gauge()
+static void replace_gauge(const GaugeParams &params)
 {
+    // The analysis sets up a new gauge with the first frame of the generation
     mtx_.lock();
-    if (nullptr != gauge_)
-    {
-        delete gauge_;
-        gauge_ = nullptr;
-    }
+    gauge_params_ = params;
+    gauge_generation_++;
+    crop_rect_ = Rect();
     mtx_.unlock();
 }
 
@@ -83,85 +179,569 @@ static void set_dynstr_nbr(const guint8 port)
     mtx_.unlock();
 }
 
-static gboolean imageanalysis(gpointer data)
+static void set_debug_capture(const guint32 mode)
 {
-    (void)data;
-    // Get the latest NV12 image frame from VDO using the imageprovider
-    assert(nullptr != provider_);
-    auto buf = provider_->GetLastFrameBlocking();
-    if (nullptr == buf)
+    // 0: off, 1: capture and dump on detection failures, 2: also dump now
+    assert(nullptr != debug_capture_);
+    debug_capture_->SetEnabled(0 < mode);
+    if (2 == mode)
     {
-        LOG_I("%s/%s: No more frames available, exiting", __FILE__, __FUNCTION__);
-        return TRUE;
+        debug_capture_->Trigger("requested", true);
     }
+}
 
-    // Assign the VDO image buffer to the nv12_mat OpenCV Mat.
-    // This specific Mat is used as it is the one we created for NV12,
-    // which has a different layout than e.g., BGR.
-    mtx_.lock();
-    nv12_mat_.data = static_cast<uint8_t *>(vdo_buffer_get_data(buf));
+static void set_cpu_budget(const guint32 percent)
+{
+    governor_.SetBudget(percent);
+}
+
+static void set_preprocess_threads(const guint32 threads)
+{
+    // Applied by the analysis before its next frame
+    preprocess_threads_ = MAX(threads, 1U);
+}
+
+static string aggregate_label(const char *name, const unsigned int window_s)
+{
+    return std::format("GaugeReading{}{}s", name, window_s);
+}
+
+static void set_aggregate_window(const guint32 index, const guint32 window_s)
+{
+    assert(NUM_AGGREGATE_WINDOWS > index);
+    auto &aggregate = aggregates_[index];
+    // The variables are named after the window
+    if (0 < aggregate.GetWindow() && window_s != aggregate.GetWindow())
+    {
+        for (const auto name : aggregate_names)
+        {
+            opcuaserver_.RemoveValue(aggregate_label(name, aggregate.GetWindow()).c_str());
+        }
+    }
+    aggregate.SetWindow(window_s);
+}
+
+static void set_alarm_limit(const LimitState limit, const guint32 value)
+{
+    // 0 turns the limit off
+    limit_alarm_.SetLimit(limit, 0 < value ? static_cast<double>(value) : NAN);
+    opcuaserver_.UpdateAlarmLimits();
+}
+
+static void set_alarm_deadband(const guint32 deadband)
+{
+    limit_alarm_.SetDeadband(deadband);
+}
+
+static void set_alarm_delay(const guint32 delay_s)
+{
+    limit_alarm_.SetDelay(delay_s);
+}
+
+static void set_event_threshold(const guint32 index, const guint32 threshold)
+{
+    assert(NUM_EVENT_THRESHOLDS > index);
+    // 0 turns the band off
+    event_thresholds_[index] = 0 < threshold ? static_cast<gdouble>(threshold) : NAN;
+    if (nullptr != evpusher_)
+    {
+        evpusher_->SetThreshold(index, event_thresholds_[index]);
+    }
+}
+
+static void set_event_hysteresis(const guint32 hysteresis)
+{
+    event_hysteresis_ = hysteresis;
+    if (nullptr != evpusher_)
+    {
+        evpusher_->SetHysteresis(event_hysteresis_);
+    }
+}
 
-    // Convert the NV12 data to GRAY
-    cvtColor(nv12_mat_, gray_mat_, COLOR_YUV2GRAY_NV12, 1);
+static void set_demand_idle_interval(const guint32 interval_s)
+{
+    demand_idle_ms_ = 1000 * interval_s;
+    LOG_I("%s/%s: Demand driven analysis %s", __FILE__, __FUNCTION__, 0 < interval_s ? "on" : "off");
+}
 
-    // Create gauge if nonexistent
-    if (nullptr == gauge_)
+static string round_value(double &value, const gint8 decimals)
+{
+    if (-1 < decimals)
     {
-        LOG_I("%s/%s: Set up new Gauge", __FILE__, __FUNCTION__);
-        assert(nullptr != param_handler_);
-        gauge_ = new Gauge(
-            gray_mat_,
-            param_handler_->GetCenterPoint(),
-            param_handler_->GetMinPoint(),
-            param_handler_->GetMaxPoint(),
-            param_handler_->GetClockwise());
+        // Round value if limited amount of decimals is requested
+        const double factor = pow(10.0, decimals);
+        value = round(value * factor) / factor;
+        return std::format("{:.{}f}", value, decimals);
     }
-    assert(nullptr != gauge_);
-    auto value = gauge_->ComputeGaugeValue(gray_mat_);
+    return std::to_string(value);
+}
+
+static void capture_frame(VdoBuffer &buf, PipelineFrame &frame)
+{
+    // Skip frames within the analysis interval of the CPU governor and, when
+    // demand driven, frames that no client waits for until the idle interval
+    const auto now = g_get_monotonic_time();
+    const guint idle_ms = demand_idle_ms_;
+    auto &demand = opcuaserver_.GetDemand();
+    const auto wanted = 0 == idle_ms || demand.Pending();
+    frame.skipped = !governor_.AnalysisDue(wanted ? 0 : idle_ms);
+    if (frame.skipped)
+    {
+        governor_.CountSkip();
+        return;
+    }
+    demand.Served(now);
+    mark_startup_phase(STARTUP_FIRST_FRAME);
+
+    MatTag tag(MatPool::TAG_FRAME);
+    // The first plane of NV12 is the gray image
+    const Mat gray(luma_size_, CV_8UC1, vdo_buffer_get_data(&buf));
+
+    mtx_.lock();
+    if (crop_rect_.empty())
+    {
+        crop_rect_ = Gauge::CropRect(luma_size_, gauge_params_.center, gauge_params_.min, gauge_params_.max);
+    }
+    frame.generation = gauge_generation_;
+    frame.params = gauge_params_;
+    frame.crop = crop_rect_;
     mtx_.unlock();
+    gray(frame.crop).copyTo(frame.image);
+}
+
+/**
+ * brief Set up the gauge of the generation of a frame, and the worker pool.
+ *
+ * Only called by the analysis stage, which owns the gauge and the filter. The
+ * gauge is set up from the parameters captured with the frame.
+ */
+static void prepare_gauge(const PipelineFrame &frame)
+{
+    const guint threads = preprocess_threads_;
+    if ((nullptr != worker_pool_ ? worker_pool_->GetThreads() : 1) != threads)
+    {
+        if (nullptr != gauge_)
+        {
+            gauge_->SetWorkerPool(nullptr);
+        }
+        delete worker_pool_;
+        worker_pool_ = 1 < threads ? new WorkerPool(threads) : nullptr;
+        if (nullptr != gauge_)
+        {
+            gauge_->SetWorkerPool(worker_pool_);
+        }
+    }
+
+    if (nullptr != gauge_ && analysis_generation_ == frame.generation)
+    {
+        return;
+    }
+    MatTag gauge_tag(MatPool::TAG_GAUGE);
+    LOG_I("%s/%s: Set up new Gauge", __FILE__, __FUNCTION__);
+    const auto &params = frame.params;
+    delete gauge_;
+    gauge_ = new Gauge(
+        luma_size_,
+        params.center,
+        params.min,
+        params.max,
+        params.clockwise,
+        params.tracking_window,
+        params.tracking_rescan,
+        params.average_frames,
+        params.background_model);
+    gauge_->SetDebugCapture(debug_capture_);
+    gauge_->SetWorkerPool(worker_pool_);
+    analysis_generation_ = frame.generation;
+    filter_.Reset();
+    mark_startup_phase(STARTUP_GAUGE);
+}
+
+static void analyze_frame(PipelineFrame &frame)
+{
+    MatTag tag(MatPool::TAG_GAUGE);
+    // Frames captured for a replaced gauge are dropped
+    frame.valid = !frame.skipped && gauge_generation_ == frame.generation;
+    if (frame.valid)
+    {
+        prepare_gauge(frame);
+        assert(gauge_->GetCropRect() == frame.crop);
+    }
+    if (frame.valid)
+    {
+        // Apply the detection tier picked by the CPU governor
+        const auto tier = governor_.GetTier();
+        const auto tracking_window = frame.params.tracking_window;
+        gauge_->SetTrackingWindow(
+            CpuGovernor::TIER_FULL == tier ? tracking_window : MAX(tracking_window, GOVERNOR_TRACKING_WINDOW));
+        if (CpuGovernor::TIER_CHANGE_GATE == tier && !gauge_->CropChanged(frame.image))
+        {
+            governor_.CountSkip();
+            frame.valid = false;
+        }
+    }
+    // Frames that only add to the average are not read
+    frame.valid = frame.valid && gauge_->AddCrop(frame.image);
+    if (frame.valid)
+    {
+        governor_.CountAnalysis();
+        frame.value = gauge_->ComputeCropValue(frame.image);
+        frame.tracking_stats = gauge_->GetTrackingStats();
+        frame.preprocess_avg_us = gauge_->GetPreprocessAvgUs();
+        frame.accepted = 0 > frame.value || filter_.Update(frame.value, gauge_->GetConfidence());
+        frame.filtered = filter_.GetValue();
+        frame.confidence = 0 > frame.value ? 0 : filter_.GetConfidence();
+    }
+}
+
+/**
+ * brief Declare the events, once; after the first reading or at the latest
+ * EVENTS_DECLARE_DELAY_MS after start.
+ */
+static gboolean declare_events(gpointer data)
+{
+    (void)data;
+    if (nullptr != evpusher_)
+    {
+        return G_SOURCE_REMOVE;
+    }
+    evpusher_ = new EventPusher();
+    for (guint i = 0; NUM_EVENT_THRESHOLDS > i; i++)
+    {
+        evpusher_->SetThreshold(i, event_thresholds_[i]);
+    }
+    evpusher_->SetHysteresis(event_hysteresis_);
+    mark_startup_phase(STARTUP_EVENTS);
+    publish_startup_phases();
+    return G_SOURCE_REMOVE;
+}
+
+static void publish_frame(PipelineFrame &frame)
+{
+    if (!frame.valid)
+    {
+        return;
+    }
+    auto value = frame.value;
+    auto filtered = frame.filtered;
+    const auto confidence = frame.confidence;
+    const auto &tracking_stats = frame.tracking_stats;
+    opcuaserver_.UpdateDiagnosticValue("TrackingHits", tracking_stats.hits);
+    opcuaserver_.UpdateDiagnosticValue("TrackingWidened", tracking_stats.widened);
+    opcuaserver_.UpdateDiagnosticValue("TrackingMisses", tracking_stats.misses);
+    opcuaserver_.UpdateDiagnosticValue("FullScans", tracking_stats.full_scans);
+    opcuaserver_.UpdateDiagnosticValue("PreprocessAvgUs", frame.preprocess_avg_us);
+    const auto signal_stats = provider_->GetFrameSignalStats();
+    opcuaserver_.UpdateDiagnosticValue("FrameWakeups", signal_stats.wakeups);
+    if (0 < signal_stats.wakeups)
+    {
+        opcuaserver_.UpdateDiagnosticValue(
+            "FrameDispatchLatencyAvgUs",
+            static_cast<double>(signal_stats.total_latency_us) / signal_stats.wakeups);
+    }
+    opcuaserver_.UpdateDiagnosticValue("FrameDispatchLatencyMaxUs", signal_stats.max_latency_us);
+    opcuaserver_.UpdateDiagnosticValue("OpcUaIterations", opcuaserver_.GetIterations());
+    if (nullptr != pipeline_)
+    {
+        const auto pipeline_stats = pipeline_->GetStats();
+        if (0 < pipeline_stats.frames)
+        {
+            opcuaserver_.UpdateDiagnosticValue(
+                "PipelineFps",
+                1e6 * pipeline_stats.frames / pipeline_stats.running_us);
+            opcuaserver_.UpdateDiagnosticValue(
+                "PipelineCaptureAvgUs",
+                static_cast<double>(pipeline_stats.capture_us) / pipeline_stats.captured);
+            opcuaserver_.UpdateDiagnosticValue(
+                "PipelineAnalyzeAvgUs",
+                static_cast<double>(pipeline_stats.analyze_us) / pipeline_stats.analyzed);
+            opcuaserver_.UpdateDiagnosticValue(
+                "PipelinePublishAvgUs",
+                static_cast<double>(pipeline_stats.publish_us) / pipeline_stats.frames);
+            opcuaserver_.UpdateDiagnosticValue("PipelineStalls", pipeline_stats.stalls);
+        }
+    }
     // Successfully read values range between 0 and 100 percent; if no value
     // could be read the computation will return -1
     assert(value <= 100.0);
+    const auto now = g_get_monotonic_time();
+    for (auto &aggregate : aggregates_)
+    {
+        aggregate.Add(now, value);
+    }
+    if (nullptr != history_)
+    {
+        history_->Append(
+            g_get_real_time() / 1000,
+            value,
+            0 > value ? HISTORY_FAILED : (frame.accepted ? HISTORY_GOOD : HISTORY_REJECTED));
+    }
     if (0 > value)
     {
         LOG_E("%s/%s: Failed to read out Gauge value from current scene/setup", __FILE__, __FUNCTION__);
+        opcuaserver_.UpdateFilteredValue(filtered, confidence);
     }
     else
     {
+        // The raw value is published as it is; the overlay and the events
+        // follow the filtered value
         const auto rounddecimals = param_handler_->GetRoundToDecimals();
-        string value_str;
-        if (-1 < rounddecimals)
+        const auto raw_str = round_value(value, rounddecimals);
+        const auto value_str = round_value(filtered, rounddecimals);
+        LOG_I(
+            "%s/%s: Value was %s, filtered %s (confidence %.2f%s)",
+            __FILE__,
+            __FUNCTION__,
+            raw_str.c_str(),
+            value_str.c_str(),
+            confidence,
+            frame.accepted ? "" : ", rejected as outlier");
+        opcuaserver_.UpdateGaugeValue(value);
+        opcuaserver_.UpdateFilteredValue(filtered, confidence);
+        // The alarm follows the filtered value and only sends events when
+        // its state changes
+        if (limit_alarm_.Update(now, filtered))
         {
-            // Round value if limited amount of decimals is requested
-            const double factor = pow(10.0, rounddecimals);
-            value = round(value * factor) / factor;
-            value_str = std::format("{:.{}f}", value, rounddecimals);
-            LOG_I("%s/%s: Value (with %i decimals) was %s", __FILE__, __FUNCTION__, rounddecimals, value_str.c_str());
+            LOG_I(
+                "%s/%s: Limit alarm %s at %s",
+                __FILE__,
+                __FUNCTION__,
+                limit_state_names[limit_alarm_.GetState() - LIMIT_LOWLOW],
+                value_str.c_str());
+            opcuaserver_.UpdateLimitAlarm();
         }
-        else
+        if (0 == startup_phase_us_[STARTUP_FIRST_READING])
         {
-            value_str = std::to_string(value);
-            LOG_I("%s/%s: Value (with unlimited decimals) was %s", __FILE__, __FUNCTION__, value_str.c_str());
+            mark_startup_phase(STARTUP_FIRST_READING);
+            publish_startup_phases();
+            declare_events(nullptr);
         }
-        opcuaserver_.UpdateGaugeValue(value);
-        if (value != lastvalue_)
+        if (filtered != lastvalue_)
         {
             assert(nullptr != dynstr_handler_);
             dynstr_handler_->UpdateStr(value_str);
-            if (evpusher_.Send(value, TRUE))
+            // The events are declared once the main loop is idle
+            if (nullptr != evpusher_ && evpusher_->Send(filtered, TRUE))
             {
-                lastvalue_ = value;
+                lastvalue_ = filtered;
             }
         }
+        // The threshold bands only send events when they are crossed
+        if (nullptr != evpusher_)
+        {
+            evpusher_->UpdateThresholds(filtered);
+        }
+    }
+}
+
+static gboolean evaluate_governor(gpointer data)
+{
+    (void)data;
+    governor_.Evaluate();
+    const auto stats = governor_.GetStats();
+    opcuaserver_.UpdateDiagnosticValue("GovernorCpuPercent", stats.cpu_percent);
+    opcuaserver_.UpdateDiagnosticValue("GovernorCpuPerFrameMs", stats.cpu_per_frame_ms);
+    opcuaserver_.UpdateDiagnosticValue("GovernorLevel", stats.level);
+    opcuaserver_.UpdateDiagnosticValue("GovernorTier", stats.tier);
+    opcuaserver_.UpdateDiagnosticValue("GovernorIntervalMs", stats.interval_ms);
+    opcuaserver_.UpdateDiagnosticValue("GovernorAnalyzed", stats.analyzed);
+    opcuaserver_.UpdateDiagnosticValue("GovernorSkipped", stats.skipped);
+    auto &demand = opcuaserver_.GetDemand();
+    opcuaserver_.UpdateDiagnosticValue("DemandMonitoredItems", demand.GetMonitoredItems());
+    opcuaserver_.UpdateDiagnosticValue("DemandReads", demand.GetReads());
+
+    return TRUE;
+}
+
+static gboolean publish_memory_stats(gpointer data)
+{
+    (void)data;
+    static unsigned long last_allocations = 0;
+    static gint64 last_us = g_get_monotonic_time();
+    const auto stats = MatPool::GetInstance().GetStats();
+    const auto now = g_get_monotonic_time();
+    opcuaserver_.UpdateDiagnosticValue("MemoryBytes", stats.bytes);
+    opcuaserver_.UpdateDiagnosticValue("MemoryPeakBytes", stats.peak_bytes);
+    opcuaserver_.UpdateDiagnosticValue("MemoryCachedBytes", stats.cached_bytes);
+    opcuaserver_.UpdateDiagnosticValue(
+        "MemoryAllocationsPerSecond",
+        1e6 * (stats.allocations - last_allocations) / MAX(now - last_us, 1));
+    if (0 < stats.pooled)
+    {
+        opcuaserver_.UpdateDiagnosticValue("MemoryPoolHitPercent", 100.0 * stats.pool_hits / stats.pooled);
+    }
+    for (auto tag = 0; MatPool::NUM_TAGS > tag; tag++)
+    {
+        const auto name = MatPool::GetTagName(static_cast<MatPool::Tag>(tag));
+        opcuaserver_.UpdateDiagnosticValue(std::format("Memory{}Bytes", name).c_str(), stats.tags[tag].bytes);
+        opcuaserver_.UpdateDiagnosticValue(std::format("Memory{}PeakBytes", name).c_str(), stats.tags[tag].peak_bytes);
+    }
+    last_allocations = stats.allocations;
+    last_us = now;
+
+    // The VDO buffers are not images but the largest memory of the application
+    if (nullptr != provider_)
+    {
+        const auto buffer_stats = provider_->GetBufferStats();
+        const auto &buffers = buffer_stats.buffers;
+        opcuaserver_.UpdateDiagnosticValue("VdoBuffers", MAX_VDO_BUFFERS - buffers[ImageProvider::BUFFER_FREE]);
+        opcuaserver_.UpdateDiagnosticValue("VdoBuffersInVdo", buffers[ImageProvider::BUFFER_IN_VDO]);
+        opcuaserver_.UpdateDiagnosticValue("VdoBuffersDelivered", buffers[ImageProvider::BUFFER_DELIVERED]);
+        opcuaserver_.UpdateDiagnosticValue("VdoBuffersHeld", buffers[ImageProvider::BUFFER_CLIENT]);
+        opcuaserver_.UpdateDiagnosticValue("VdoBuffersProcessed", buffers[ImageProvider::BUFFER_PROCESSED]);
+        opcuaserver_.UpdateDiagnosticValue("VdoDrops", buffer_stats.drops);
+        opcuaserver_.UpdateDiagnosticValue("VdoConsumerWaits", buffer_stats.consumer_waits);
+        opcuaserver_.UpdateDiagnosticValue("VdoStarved", buffer_stats.vdo_starved);
+        if (0 < buffer_stats.recycles)
+        {
+            opcuaserver_.UpdateDiagnosticValue(
+                "VdoRecycleAvgMs",
+                buffer_stats.total_recycle_us / 1e3 / buffer_stats.recycles);
+        }
+        opcuaserver_.UpdateDiagnosticValue("VdoRecycleMaxMs", buffer_stats.max_recycle_us / 1e3);
+        opcuaserver_.UpdateDiagnosticValue("VdoBuffersGrown", buffer_stats.grown);
+        opcuaserver_.UpdateDiagnosticValue("VdoBuffersShrunk", buffer_stats.shrunk);
+    }
+
+    return TRUE;
+}
+
+static gboolean publish_aggregates(gpointer data)
+{
+    (void)data;
+    const auto now = g_get_monotonic_time();
+    for (auto &aggregate : aggregates_)
+    {
+        const auto window_s = aggregate.GetWindow();
+        if (0 == window_s)
+        {
+            continue;
+        }
+        aggregate.Expire(now);
+        const auto values = aggregate.GetValues();
+        // In the order of aggregate_names
+        const double published[] = {
+            static_cast<double>(values.count),
+            static_cast<double>(values.failed),
+            values.min,
+            values.max,
+            values.mean,
+            values.stddev,
+            values.rate_per_min};
+        static_assert(std::size(published) == std::size(aggregate_names));
+        // Kept as they were while the window holds too few readings
+        for (size_t i = 0; std::size(published) > i; i++)
+        {
+            if (!isnan(published[i]))
+            {
+                opcuaserver_.UpdateAggregateValue(aggregate_label(aggregate_names[i], window_s).c_str(), published[i]);
+            }
+        }
+    }
+
+    return TRUE;
+}
+
+static gboolean publish_history_stats(gpointer data)
+{
+    (void)data;
+    const auto stats = history_->GetStats();
+    opcuaserver_.UpdateDiagnosticValue("HistoryReadings", stats.stored);
+    if (0 < stats.oldest_ms)
+    {
+        opcuaserver_.UpdateDiagnosticValue("HistorySpanHours", (g_get_real_time() / 1000 - stats.oldest_ms) / 3600e3);
+    }
+    if (0 < stats.readings)
+    {
+        opcuaserver_.UpdateDiagnosticValue(
+            "HistoryBytesPerReading",
+            static_cast<double>(stats.encoded_bytes) / stats.readings);
+    }
+    if (0 < stats.encoded_bytes)
+    {
+        opcuaserver_.UpdateDiagnosticValue(
+            "HistoryWriteAmplification",
+            static_cast<double>(stats.flushed_bytes) / stats.encoded_bytes);
+    }
+    opcuaserver_.UpdateDiagnosticValue("HistoryFlushes", stats.flushes);
+
+    return TRUE;
+}
+
+static gboolean imageanalysis(gpointer data)
+{
+    (void)data;
+    // Get the latest NV12 image frame from VDO using the imageprovider; this
+    // is only called when a frame has been signalled
+    assert(nullptr != provider_);
+    auto buf = provider_->GetLastFrame();
+    if (nullptr == buf)
+    {
+        return TRUE;
     }
 
-    // Release the VDO frame buffer
+    // Run the pipeline stages one after the other
+    capture_frame(*buf, serial_frame_);
     provider_->ReturnFrame(*buf);
+    analyze_frame(serial_frame_);
+    publish_frame(serial_frame_);
 
     return TRUE;
 }
 
-static gboolean initimageanalysis(void)
+static bool start_analysis()
+{
+    assert(nullptr != provider_);
+    if (pipelined_)
+    {
+        // Run capture and analysis in threads of their own
+        pipeline_ = new AnalysisPipeline(*provider_, capture_frame, analyze_frame, publish_frame);
+        return true;
+    }
+
+    // Run image analysis whenever a frame arrives
+    frame_source_ = provider_->AttachFrameSource(imageanalysis, nullptr);
+    return 0 < frame_source_;
+}
+
+static void stop_analysis()
+{
+    if (nullptr != pipeline_)
+    {
+        delete pipeline_;
+        pipeline_ = nullptr;
+    }
+    if (0 < frame_source_)
+    {
+        g_source_remove(frame_source_);
+        frame_source_ = 0;
+    }
+}
+
+static void set_pipelined(const gboolean pipelined)
+{
+    pipelined_ = pipelined;
+    // At startup, the analysis is started after the parameters are set up
+    if (nullptr == provider_ || pipelined_ == (nullptr != pipeline_))
+    {
+        return;
+    }
+    stop_analysis();
+    if (!start_analysis())
+    {
+        LOG_E("%s/%s: Failed to restart image analysis", __FILE__, __FUNCTION__);
+    }
+}
+
+/**
+ * brief Set up the stream and start fetching frames.
+ *
+ * Runs next to the parameter setup, so it must not touch what the parameter
+ * callbacks use; the provider is handed over by the caller.
+ *
+ * return The image provider, nullptr on failure.
+ */
+static ImageProvider *initimageanalysis(void)
 {
     // The desired width and height of the BGR frame
     const unsigned int width = 640;
@@ -174,30 +754,31 @@ static gboolean initimageanalysis(void)
     if (!ImageProvider::ChooseStreamResolution(width, height, streamWidth, streamHeight))
     {
         LOG_E("%s/%s: Failed choosing stream resolution", __FILE__, __FUNCTION__);
-        return FALSE;
+        return nullptr;
     }
 
     LOG_I("Creating VDO image provider and creating stream %d x %d", streamWidth, streamHeight);
     // TODO: Could we use the subformat Y800 to get gray 1-channel image directly?
-    provider_ = new ImageProvider(streamWidth, streamHeight, 2, VDO_FORMAT_YUV);
-    if (!provider_)
+    auto provider = new ImageProvider(streamWidth, streamHeight, 2, VDO_FORMAT_YUV);
+    if (!provider)
     {
         LOG_E("%s/%s: Failed to create ImageProvider", __FILE__, __FUNCTION__);
-        return FALSE;
+        return nullptr;
     }
 
     LOG_I("Start fetching video frames from VDO");
-    if (!ImageProvider::StartFrameFetch(*provider_))
+    if (!ImageProvider::StartFrameFetch(*provider))
     {
         LOG_E("%s/%s: Failed to fetch frames from VDO", __FILE__, __FUNCTION__);
-        return FALSE;
+        delete provider;
+        return nullptr;
     }
 
-    // OpenCV represents NV12 with 1.5 bytes per pixel
-    nv12_mat_ = Mat(height * 3 / 2, width, CV_8UC1);
-    gray_mat_ = Mat(height, width, CV_8UC1);
+    // NV12 starts with the full resolution luma plane
+    luma_size_ = Size(streamWidth, streamHeight);
+    mark_startup_phase(STARTUP_STREAM);
 
-    return TRUE;
+    return provider;
 }
 
 static void signalHandler(int signal_num)
@@ -243,9 +824,14 @@ static bool initializeSignalHandler(void)
 int main(int argc, char *argv[])
 {
     (void)argc;
+    startup_us_ = g_get_monotonic_time();
 
     const auto app_name = basename(argv[0]);
     openlog(app_name, LOG_PID | LOG_CONS, LOG_USER);
+    Logger::Start();
+
+    // Pool and account the image memory from the first image on
+    MatPool::Install();
 
     int result = EXIT_SUCCESS;
     if (!initializeSignalHandler())
@@ -254,12 +840,54 @@ int main(int argc, char *argv[])
         goto exit;
     }
 
-    // Init dynamic string handling
+    // Init dynamic string handling, which gets its credentials in the background
     dynstr_handler_ = new DynamicStringHandler();
 
-    // Init parameter handling (will also launch OPC UA server)
-    LOG_I("Init parameter handling and launch OPC UA server ...");
-    param_handler_ = new ParamHandler(app_name, restart_opcuaserver, replace_gauge, set_dynstr_nbr);
+    // Init debug capture, which stores images in the application's localdata
+    debug_capture_ = new DebugCapture(string(PACKAGES_DIR) + app_name + "/localdata/capture");
+
+    // Keep the readings in the application's localdata too, for when the
+    // network is down; the OPC UA server launched below serves them
+    history_ = new ReadingHistory();
+    if (history_->Open(string(PACKAGES_DIR) + app_name + "/localdata/history.bin"))
+    {
+        opcuaserver_.SetHistory(history_);
+        history_export_ = new HistoryExport(*history_);
+        history_export_->Start();
+    }
+    else
+    {
+        delete history_;
+        history_ = nullptr;
+    }
+
+    // Init parameter handling (will also launch OPC UA server) while the
+    // stream is set up; the parameter callbacks see the stream after both
+    {
+        LOG_I("Init parameter handling, launch OPC UA server and set up stream ...");
+        ImageProvider *provider = nullptr;
+        opcuaserver_.SetLimitAlarm(&limit_alarm_);
+        thread stream_setup([&provider] { provider = initimageanalysis(); });
+        param_handler_ = new ParamHandler(
+            app_name,
+            restart_opcuaserver,
+            replace_gauge,
+            set_dynstr_nbr,
+            set_debug_capture,
+            set_pipelined,
+            set_preprocess_threads,
+            set_cpu_budget,
+            set_aggregate_window,
+            set_alarm_limit,
+            set_alarm_deadband,
+            set_alarm_delay,
+            set_event_threshold,
+            set_event_hysteresis,
+            set_demand_idle_interval);
+        mark_startup_phase(STARTUP_PARAMS);
+        stream_setup.join();
+        provider_ = provider;
+    }
     if (nullptr == param_handler_)
     {
         LOG_E("%s/%s: Failed to set up parameter handler and launch OPC UA server", __FILE__, __FUNCTION__);
@@ -267,22 +895,38 @@ int main(int argc, char *argv[])
         goto exit;
     }
 
-    // Initialize image analysis
-    if (!initimageanalysis())
+    if (nullptr == provider_)
     {
         LOG_E("%s/%s: Failed to init image analysis", __FILE__, __FUNCTION__);
         result = EXIT_FAILURE;
         goto exit_param;
     }
 
-    // Add image analysis as idle function
-    if (1 > g_idle_add(imageanalysis, nullptr))
+    // Start image analysis, serial or pipelined
+    if (!start_analysis())
     {
-        LOG_E("%s/%s: Failed to add idle function", __FILE__, __FUNCTION__);
+        LOG_E("%s/%s: Failed to start image analysis", __FILE__, __FUNCTION__);
         result = EXIT_FAILURE;
         goto exit_param;
     }
 
+    // Keep the analysis within the CPU budget
+    g_timeout_add_seconds(GOVERNOR_PERIOD_S, evaluate_governor, nullptr);
+
+    // Publish the rolling aggregates of the reading
+    g_timeout_add_seconds(AGGREGATES_PERIOD_S, publish_aggregates, nullptr);
+
+    // Publish the use of image memory
+    g_timeout_add_seconds(MEMORY_STATS_PERIOD_S, publish_memory_stats, nullptr);
+    if (nullptr != history_)
+    {
+        g_timeout_add_seconds(HISTORY_STATS_PERIOD_S, publish_history_stats, nullptr);
+    }
+
+    // Declare the events off the path to the first reading, but also when
+    // no reading comes
+    g_timeout_add(EVENTS_DECLARE_DELAY_MS, declare_events, nullptr);
+
     LOG_I("Start main loop ...");
     assert(nullptr == loop_);
     loop_ = g_main_loop_new(nullptr, FALSE);
@@ -291,6 +935,8 @@ int main(int argc, char *argv[])
     // Cleanup
     LOG_I("Shutdown ...");
     g_main_loop_unref(loop_);
+    stop_analysis();
+    delete evpusher_;
     if (nullptr != provider_)
     {
         delete provider_;
@@ -299,10 +945,16 @@ int main(int argc, char *argv[])
 
 exit_param:
     delete param_handler_;
+    delete gauge_;
+    delete worker_pool_;
 
 exit:
+    delete history_export_;
+    delete history_;
+    delete debug_capture_;
     delete dynstr_handler_;
     LOG_I("Exiting!");
+    Logger::Stop();
     closelog();
 
     return result;
@@ -0,0 +1,302 @@
+/**
+ * Copyright (C) 2025, Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * Watch the limit alarm of the application from an OPC UA client.
+ *
+ * Subscribes to the events of the server, asks for the current state of the
+ * conditions and prints one line per event of the limit alarm: its time,
+ * severity, active state, the states of the four limits and its message.
+ * Exits after a number of events, or with an error when the time runs out
+ * first, so it can check the alarm of a running application.
+ */
+
+#include <open62541/client_config_default.h>
+#include <open62541/client_highlevel.h>
+#include <open62541/client_subscriptions.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+// The event fields printed, as browse paths from the event
+#define NUM_FIELDS (9)
+static const char *field_paths[NUM_FIELDS][2] = {
+    {"Time", nullptr},
+    {"ConditionName", nullptr},
+    {"Severity", nullptr},
+    {"ActiveState", "Id"},
+    {"HighHighState", "Id"},
+    {"HighState", "Id"},
+    {"LowState", "Id"},
+    {"LowLowState", "Id"},
+    {"Message", nullptr},
+};
+
+static volatile sig_atomic_t running_ = 1;
+static unsigned int events_ = 0;
+
+static void Usage(const char *name)
+{
+    fprintf(
+        stderr,
+        "Usage: %s [-u url] [-n events] [-t seconds]\n"
+        "  -u  Server (default opc.tcp://localhost:4840)\n"
+        "  -n  Exit after this many events, 0 to run until interrupted (default 0)\n"
+        "  -t  Fail if the events have not come within this time (default 0, no limit)\n",
+        name);
+}
+
+static void Stop(int signal)
+{
+    (void)signal;
+    running_ = 0;
+}
+
+static void PrintField(const UA_Variant &field)
+{
+    if (UA_Variant_hasScalarType(&field, &UA_TYPES[UA_TYPES_DATETIME]))
+    {
+        const auto time = UA_DateTime_toStruct(*static_cast<UA_DateTime *>(field.data));
+        printf(
+            "%04u-%02u-%02u %02u:%02u:%02u.%03u",
+            time.year,
+            time.month,
+            time.day,
+            time.hour,
+            time.min,
+            time.sec,
+            time.milliSec);
+    }
+    else if (UA_Variant_hasScalarType(&field, &UA_TYPES[UA_TYPES_STRING]))
+    {
+        const auto string = static_cast<UA_String *>(field.data);
+        printf("%.*s", static_cast<int>(string->length), string->data);
+    }
+    else if (UA_Variant_hasScalarType(&field, &UA_TYPES[UA_TYPES_LOCALIZEDTEXT]))
+    {
+        const auto text = static_cast<UA_LocalizedText *>(field.data);
+        printf("\"%.*s\"", static_cast<int>(text->text.length), text->text.data);
+    }
+    else if (UA_Variant_hasScalarType(&field, &UA_TYPES[UA_TYPES_UINT16]))
+    {
+        printf("%u", *static_cast<UA_UInt16 *>(field.data));
+    }
+    else if (UA_Variant_hasScalarType(&field, &UA_TYPES[UA_TYPES_BOOLEAN]))
+    {
+        printf("%d", *static_cast<UA_Boolean *>(field.data) ? 1 : 0);
+    }
+    else
+    {
+        printf("-");
+    }
+}
+
+static void HandleEvent(
+    UA_Client *client,
+    UA_UInt32 subscription_id,
+    void *subscription_context,
+    UA_UInt32 item_id,
+    void *item_context,
+    size_t num_fields,
+    UA_Variant *fields)
+{
+    (void)client;
+    (void)subscription_id;
+    (void)subscription_context;
+    (void)item_id;
+    (void)item_context;
+    // Other events of the server have no condition name
+    if (NUM_FIELDS != num_fields || UA_Variant_isEmpty(&fields[1]))
+    {
+        return;
+    }
+    for (size_t i = 0; NUM_FIELDS > i; i++)
+    {
+        // The states are printed with their names
+        if (3 <= i && 7 >= i)
+        {
+            printf(" %s=", field_paths[i][0]);
+        }
+        else if (0 < i)
+        {
+            printf(" ");
+        }
+        PrintField(fields[i]);
+    }
+    printf("\n");
+    fflush(stdout);
+    events_++;
+}
+
+/**
+ * brief Subscribe to the events of the Server object, which the events of
+ * all its notifiers reach.
+ *
+ * param client Connected client.
+ * param subscription_id Id of the subscription created.
+ *
+ * return True on success.
+ */
+static bool Subscribe(UA_Client *client, UA_UInt32 &subscription_id)
+{
+    const auto response =
+        UA_Client_Subscriptions_create(client, UA_CreateSubscriptionRequest_default(), nullptr, nullptr, nullptr);
+    if (UA_STATUSCODE_GOOD != response.responseHeader.serviceResult)
+    {
+        fprintf(
+            stderr,
+            "Failed to create subscription (%s)\n",
+            UA_StatusCode_name(response.responseHeader.serviceResult));
+        return false;
+    }
+    subscription_id = response.subscriptionId;
+
+    auto select = static_cast<UA_SimpleAttributeOperand *>(
+        UA_Array_new(NUM_FIELDS, &UA_TYPES[UA_TYPES_SIMPLEATTRIBUTEOPERAND]));
+    for (size_t i = 0; NUM_FIELDS > i; i++)
+    {
+        const size_t path_size = nullptr == field_paths[i][1] ? 1 : 2;
+        select[i].typeDefinitionId = UA_NODEID_NUMERIC(0, UA_NS0ID_BASEEVENTTYPE);
+        select[i].attributeId = UA_ATTRIBUTEID_VALUE;
+        select[i].browsePathSize = path_size;
+        select[i].browsePath =
+            static_cast<UA_QualifiedName *>(UA_Array_new(path_size, &UA_TYPES[UA_TYPES_QUALIFIEDNAME]));
+        for (size_t j = 0; path_size > j; j++)
+        {
+            select[i].browsePath[j] = UA_QUALIFIEDNAME_ALLOC(0, field_paths[i][j]);
+        }
+    }
+    UA_EventFilter filter;
+    UA_EventFilter_init(&filter);
+    filter.selectClauses = select;
+    filter.selectClausesSize = NUM_FIELDS;
+
+    UA_MonitoredItemCreateRequest item;
+    UA_MonitoredItemCreateRequest_init(&item);
+    item.itemToMonitor.nodeId = UA_NODEID_NUMERIC(0, UA_NS0ID_SERVER);
+    item.itemToMonitor.attributeId = UA_ATTRIBUTEID_EVENTNOTIFIER;
+    item.monitoringMode = UA_MONITORINGMODE_REPORTING;
+    item.requestedParameters.filter.encoding = UA_EXTENSIONOBJECT_DECODED;
+    item.requestedParameters.filter.content.decoded.data = &filter;
+    item.requestedParameters.filter.content.decoded.type = &UA_TYPES[UA_TYPES_EVENTFILTER];
+    item.requestedParameters.queueSize = 100;
+    item.requestedParameters.discardOldest = true;
+
+    const auto result = UA_Client_MonitoredItems_createEvent(
+        client,
+        subscription_id,
+        UA_TIMESTAMPSTORETURN_BOTH,
+        item,
+        nullptr,
+        HandleEvent,
+        nullptr);
+    UA_Array_delete(select, NUM_FIELDS, &UA_TYPES[UA_TYPES_SIMPLEATTRIBUTEOPERAND]);
+    if (UA_STATUSCODE_GOOD != result.statusCode)
+    {
+        fprintf(stderr, "Failed to monitor events (%s)\n", UA_StatusCode_name(result.statusCode));
+        return false;
+    }
+
+    // Have the server send the current state of its conditions
+    UA_Variant input;
+    UA_Variant_setScalar(&input, &subscription_id, &UA_TYPES[UA_TYPES_UINT32]);
+    size_t output_size = 0;
+    UA_Variant *output = nullptr;
+    const auto rc = UA_Client_call(
+        client,
+        UA_NODEID_NUMERIC(0, UA_NS0ID_CONDITIONTYPE),
+        UA_NODEID_NUMERIC(0, UA_NS0ID_CONDITIONTYPE_CONDITIONREFRESH),
+        1,
+        &input,
+        &output_size,
+        &output);
+    UA_Array_delete(output, output_size, &UA_TYPES[UA_TYPES_VARIANT]);
+    if (UA_STATUSCODE_GOOD != rc)
+    {
+        fprintf(stderr, "Failed to refresh the conditions (%s)\n", UA_StatusCode_name(rc));
+    }
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *url = "opc.tcp://localhost:4840";
+    unsigned int max_events = 0;
+    unsigned int timeout_s = 0;
+    int opt;
+    while (-1 != (opt = getopt(argc, argv, "u:n:t:h")))
+    {
+        switch (opt)
+        {
+        case 'u':
+            url = optarg;
+            break;
+        case 'n':
+            max_events = atoi(optarg);
+            break;
+        case 't':
+            timeout_s = atoi(optarg);
+            break;
+        default:
+            Usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    signal(SIGINT, Stop);
+    signal(SIGTERM, Stop);
+
+    auto client = UA_Client_new();
+    UA_ClientConfig_setDefault(UA_Client_getConfig(client));
+    auto rc = UA_Client_connect(client, url);
+    if (UA_STATUSCODE_GOOD != rc)
+    {
+        fprintf(stderr, "Failed to connect to %s (%s)\n", url, UA_StatusCode_name(rc));
+        UA_Client_delete(client);
+        return EXIT_FAILURE;
+    }
+
+    UA_UInt32 subscription_id = 0;
+    auto result = EXIT_FAILURE;
+    if (Subscribe(client, subscription_id))
+    {
+        const auto deadline = UA_DateTime_nowMonotonic() + static_cast<UA_DateTime>(timeout_s) * UA_DATETIME_SEC;
+        while (running_ && UA_STATUSCODE_GOOD == rc && (0 == max_events || events_ < max_events) &&
+               (0 == timeout_s || deadline > UA_DateTime_nowMonotonic()))
+        {
+            rc = UA_Client_run_iterate(client, 100);
+        }
+        if (UA_STATUSCODE_GOOD != rc)
+        {
+            fprintf(stderr, "Lost the connection to %s (%s)\n", url, UA_StatusCode_name(rc));
+        }
+        else if (0 < max_events && events_ < max_events)
+        {
+            fprintf(stderr, "Got %u of %u events\n", events_, max_events);
+        }
+        else
+        {
+            result = EXIT_SUCCESS;
+        }
+    }
+
+    UA_Client_disconnect(client);
+    UA_Client_delete(client);
+
+    return result;
+}
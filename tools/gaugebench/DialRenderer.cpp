@@ -0,0 +1,161 @@
+/**
+ * Copyright (C) 2025, Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <assert.h>
+#include <cmath>
+#include <opencv2/imgproc.hpp>
+
+#include "DialRenderer.hpp"
+
+using namespace cv;
+using namespace std;
+
+// Gray levels of the housing around the dial, the face and the ink of a light
+// dial; a dark dial swaps face and ink
+#define HOUSING_LEVEL (110)
+#define FACE_LEVEL (215)
+#define INK_LEVEL (35)
+// The calibration points sit on the scale, at this part of the radius
+#define SCALE_RADIUS (0.85)
+
+static const int radii[] = {60, 100, 150};
+static const int needle_widths[] = {2, 4, 7};
+static const int tick_counts[] = {0, 20, 50};
+static const double noise_levels[] = {0, 4, 10};
+static const double blur_levels[] = {0, 1, 2};
+static const double glare_levels[] = {0, 0.35, 0.7};
+
+#define PICK(rng, values) (values[(rng).uniform(0, static_cast<int>(sizeof(values) / sizeof(values[0])))])
+
+/**
+ * brief Pick a random dial within the image.
+ *
+ * param rng Random number generator.
+ * param img_size Size of the rendered images.
+ * param spec Picked dial.
+ */
+void RandomDialSpec(RNG &rng, const Size &img_size, DialSpec &spec)
+{
+    spec.clockwise = 0 == rng.uniform(0, 2);
+    spec.radius = min(PICK(rng, radii), min(img_size.width, img_size.height) / 2 - 4);
+    const auto dx = img_size.width / 2 - spec.radius - 4;
+    const auto dy = img_size.height / 2 - spec.radius - 4;
+    spec.center = Point(
+        img_size.width / 2 + (0 < dx ? rng.uniform(-dx, dx + 1) : 0),
+        img_size.height / 2 + (0 < dy ? rng.uniform(-dy, dy + 1) : 0));
+    spec.needle_width = PICK(rng, needle_widths);
+    spec.ticks = PICK(rng, tick_counts);
+    spec.noise = PICK(rng, noise_levels);
+    spec.blur = PICK(rng, blur_levels);
+    spec.glare = PICK(rng, glare_levels);
+    spec.dark = 0 == rng.uniform(0, 2);
+    spec.sweep = 270;
+}
+
+static Point OnDial(const DialSpec &spec, const double angle, const double radius)
+{
+    const auto a = angle * M_PI / 180;
+    return Point(lround(spec.center.x + radius * cos(a)), lround(spec.center.y + radius * sin(a)));
+}
+
+/**
+ * brief Render a dial with the needle at a known value.
+ *
+ * Angles follow the Gauge: degrees from the x axis, growing clockwise in the
+ * image. The gap between the max and the min mark is at the bottom of the
+ * dial, and the scale grows from the min mark in the direction of the dial.
+ *
+ * param spec Appearance of the dial.
+ * param value Needle position, 0 at the min mark and 1 at the max mark.
+ * param rng Random number generator for the noise.
+ * param img Rendered gray image, of the size already allocated.
+ * param point_min Calibration point of the min mark.
+ * param point_max Calibration point of the max mark.
+ */
+void RenderDial(const DialSpec &spec, const double value, RNG &rng, Mat &img, Point &point_min, Point &point_max)
+{
+    assert(!img.empty() && CV_8U == img.type());
+    const auto direction = spec.clockwise ? 1 : -1;
+    const auto angle_min = 90 + direction * (180 - spec.sweep / 2);
+    const auto angle_max = angle_min + direction * spec.sweep;
+    const auto face = spec.dark ? INK_LEVEL : FACE_LEVEL;
+    const auto ink = spec.dark ? FACE_LEVEL : INK_LEVEL;
+    const double r = spec.radius;
+
+    img.setTo(HOUSING_LEVEL);
+    circle(img, spec.center, spec.radius, Scalar(face), FILLED, LINE_AA);
+    circle(img, spec.center, spec.radius, Scalar(ink), 2, LINE_AA);
+
+    // Scale ticks, every fifth one longer
+    for (auto i = 0; 0 < spec.ticks && i <= spec.ticks; i++)
+    {
+        const auto angle = angle_min + direction * spec.sweep * i / spec.ticks;
+        const auto major = 0 == i % 5;
+        line(
+            img,
+            OnDial(spec, angle, 0.95 * r),
+            OnDial(spec, angle, (major ? 0.78 : 0.88) * r),
+            Scalar(ink),
+            major ? 2 : 1,
+            LINE_AA);
+    }
+
+    // Needle from a short tail through the hub to just inside the scale
+    const auto angle = angle_min + direction * spec.sweep * value;
+    line(
+        img,
+        OnDial(spec, angle + 180, 0.15 * r),
+        OnDial(spec, angle, SCALE_RADIUS * r),
+        Scalar(ink),
+        spec.needle_width,
+        LINE_AA);
+    circle(img, spec.center, max(spec.needle_width, spec.radius / 12), Scalar(ink), FILLED, LINE_AA);
+
+    // Glare from a light source above left of the dial
+    if (0 < spec.glare)
+    {
+        Mat glare = Mat::zeros(img.size(), CV_8U);
+        ellipse(
+            glare,
+            spec.center + Point(-0.3 * r, -0.35 * r),
+            Size(0.45 * r, 0.2 * r),
+            -30,
+            0,
+            360,
+            Scalar(255 * spec.glare),
+            FILLED);
+        GaussianBlur(glare, glare, Size(0, 0), r / 6);
+        add(img, glare, img);
+    }
+
+    if (0 < spec.blur)
+    {
+        GaussianBlur(img, img, Size(0, 0), spec.blur);
+    }
+
+    if (0 < spec.noise)
+    {
+        Mat noisy;
+        img.convertTo(noisy, CV_16S);
+        Mat noise(img.size(), CV_16S);
+        rng.fill(noise, RNG::NORMAL, 0, spec.noise);
+        noisy += noise;
+        noisy.convertTo(img, CV_8U);
+    }
+
+    point_min = OnDial(spec, angle_min, SCALE_RADIUS * r);
+    point_max = OnDial(spec, angle_max, SCALE_RADIUS * r);
+}
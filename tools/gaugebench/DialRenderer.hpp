@@ -0,0 +1,50 @@
+/**
+ * Copyright (C) 2025, Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * This header file declares the renderer of synthetic gauge images with a
+ * known needle angle.
+ */
+
+#pragma once
+
+#include <opencv2/core.hpp>
+
+/**
+ * brief Appearance of a rendered dial.
+ */
+struct DialSpec
+{
+    bool clockwise;    // Direction from the min to the max mark
+    cv::Point center;  // Center of the dial in the image
+    int radius;        // Radius of the dial face
+    int needle_width;  // Width of the needle
+    int ticks;         // Number of scale intervals, 0 for no ticks
+    double noise;      // Standard deviation of the sensor noise
+    double blur;       // Standard deviation of the optical blur
+    double glare;      // Strength of a glare spot, 0 to 1
+    bool dark;         // Light needle on a dark face
+    double sweep;      // Angle (degrees) from the min to the max mark
+};
+
+void RandomDialSpec(cv::RNG &rng, const cv::Size &img_size, DialSpec &spec);
+void RenderDial(
+    const DialSpec &spec,
+    const double value,
+    cv::RNG &rng,
+    cv::Mat &img,
+    cv::Point &point_min,
+    cv::Point &point_max);
@@ -0,0 +1,443 @@
+/**
+ * Copyright (C) 2025, Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * Accuracy and cost of the Gauge on synthetic dials.
+ *
+ * Renders random dials with known needle positions, reads them with the Gauge
+ * and reports percentiles of the angular error together with the time per
+ * reading, in total and per dial property.
+ *
+ * With -e it also checks that the packed, banded preprocessing of the Gauge
+ * and the vectorized pixel kernels give the same pixels as the plain OpenCV
+ * calls they replace, and compares their times.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <opencv2/imgproc.hpp>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <syslog.h>
+#include <unistd.h>
+#include <vector>
+
+#include "DialRenderer.hpp"
+#include "Gauge.hpp"
+#include "Logger.hpp"
+#include "PixelKernels.hpp"
+#include "WorkerPool.hpp"
+
+using namespace cv;
+using namespace std;
+
+// Size of the rendered images, the size of the stream the application reads
+#define IMG_WIDTH (640)
+#define IMG_HEIGHT (360)
+// Light threshold of the dark check of the Gauge
+#define LIGHT_THRESHOLD (100)
+
+struct Results
+{
+    vector<double> errors; // Absolute angular errors (degrees) of the readings
+    unsigned long failed;  // Readings where no needle was found
+    double total_us;       // Time spent in the Gauge, all frames of the readings
+};
+
+// Differences to the plain OpenCV calls, and the time spent in each, with -e
+struct Checks
+{
+    unsigned long readings;          // Readings checked
+    unsigned long differing;         // Readings where the preprocessing differs
+    unsigned long differing_pixels;  // Pixels that differ, over all readings
+    double preprocess_us;            // Preprocessing of the Gauge
+    double opencv_us;                // GaussianBlur(), adaptiveThreshold(), morphologyEx(), bitwise_and()
+    unsigned long kernel_mismatches; // Rows where a pixel kernel differs
+    double count_light_us;           // PixelKernels::CountLight()
+    double count_non_zero_us;        // countNonZero() of the thresholded rows
+    double invert_row_us;            // PixelKernels::InvertRow()
+    double bitwise_not_us;           // bitwise_not()
+};
+
+static void Usage(const char *name)
+{
+    fprintf(
+        stderr,
+        "Usage: %s [-n dials] [-p positions] [-s seed] [-a frames] [-b] [-t window] [-r rescan] [-j threads]\n"
+        "          [-c csv file] [-w image directory] [-e]\n"
+        "  -n  Number of random dials (default 200)\n"
+        "  -p  Needle positions per dial, swept from min to max (default 25)\n"
+        "  -s  Random seed (default 1)\n"
+        "  -a  Frames averaged per reading, as AverageFrames (default 1)\n"
+        "  -b  Use the background model, as BackgroundModel\n"
+        "  -t  Tracking window (degrees), as TrackingWindow (default 0)\n"
+        "  -r  Frames between full scans, as TrackingRescan (default 0)\n"
+        "  -j  Preprocessing threads, as PreprocessThreads (default 1)\n"
+        "  -c  Write one line per reading to a CSV file\n"
+        "  -w  Write the first image of each dial as PGM to a directory\n"
+        "  -e  Check the preprocessing and the pixel kernels against plain OpenCV, without\n"
+        "      averaging, background model or tracking\n",
+        name);
+}
+
+static double Percentile(vector<double> &values, const double p)
+{
+    if (values.empty())
+    {
+        return NAN;
+    }
+    // Nearest rank
+    const auto rank = static_cast<size_t>(ceil(p / 100 * values.size()));
+    nth_element(values.begin(), values.begin() + max<size_t>(rank, 1) - 1, values.end());
+    return values[max<size_t>(rank, 1) - 1];
+}
+
+static void Report(const string &label, Results &results)
+{
+    const auto readings = results.errors.size() + results.failed;
+    if (0 == readings)
+    {
+        return;
+    }
+    printf(
+        "%-18s %7zu %8.2f %8.2f %8.2f %8.2f %7.2f %9.1f\n",
+        label.c_str(),
+        readings,
+        Percentile(results.errors, 50),
+        Percentile(results.errors, 90),
+        Percentile(results.errors, 99),
+        results.errors.empty() ? NAN : *max_element(results.errors.begin(), results.errors.end()),
+        100.0 * results.failed / readings,
+        results.total_us / readings);
+}
+
+static double ElapsedUs(const int64 start)
+{
+    return 1e6 * (getTickCount() - start) / getTickFrequency();
+}
+
+/**
+ * brief Check the last reading of a Gauge against the plain OpenCV calls.
+ *
+ * param gauge Gauge that read the crop last.
+ * param original Crop as rendered.
+ * param crop Crop as read, inverted if the Gauge found it dark.
+ * param checks Differences and times, added to.
+ */
+static void Check(const Gauge &gauge, const Mat &original, const Mat &crop, Checks &checks)
+{
+    // The preprocessing as the Gauge did it before it was packed and banded
+    const auto start = getTickCount();
+    Mat blurred;
+    Mat thresh;
+    Mat closed;
+    Mat reference;
+    GaussianBlur(crop, blurred, Size(5, 5), 0);
+    adaptiveThreshold(blurred, thresh, 255, ADAPTIVE_THRESH_GAUSSIAN_C, THRESH_BINARY, 11, 2);
+    bitwise_not(thresh, thresh);
+    morphologyEx(thresh, closed, MORPH_CLOSE, Mat(2, 2, CV_8U, 1));
+    bitwise_and(closed, gauge.GetGlobalMask(), reference);
+    checks.opencv_us += ElapsedUs(start);
+
+    Mat differs;
+    compare(reference, gauge.GetNeedleImage(), differs, CMP_NE);
+    const auto differing_pixels = countNonZero(differs);
+    checks.readings++;
+    checks.differing += 0 < differing_pixels;
+    checks.differing_pixels += differing_pixels;
+
+    // The pixel kernels, row by row as the Gauge calls them
+    for (auto y = 0; y < original.rows; y++)
+    {
+        const auto row = original.row(y);
+        auto kernel_start = getTickCount();
+        const auto light = PixelKernels::CountLight(row.ptr<uchar>(0), row.cols, LIGHT_THRESHOLD);
+        checks.count_light_us += ElapsedUs(kernel_start);
+        kernel_start = getTickCount();
+        const auto light_reference = countNonZero(row > LIGHT_THRESHOLD);
+        checks.count_non_zero_us += ElapsedUs(kernel_start);
+
+        Mat inverted = row.clone();
+        Mat inverted_reference;
+        kernel_start = getTickCount();
+        PixelKernels::InvertRow(inverted.ptr<uchar>(0), inverted.cols);
+        checks.invert_row_us += ElapsedUs(kernel_start);
+        kernel_start = getTickCount();
+        bitwise_not(row, inverted_reference);
+        checks.bitwise_not_us += ElapsedUs(kernel_start);
+
+        if (static_cast<int>(light) != light_reference || 0 < countNonZero(inverted != inverted_reference))
+        {
+            checks.kernel_mismatches++;
+        }
+    }
+}
+
+static void ReportChecks(const Checks &checks, const unsigned int threads)
+{
+    if (0 == checks.readings)
+    {
+        return;
+    }
+    printf(
+        "\nPreprocessing against GaussianBlur, adaptiveThreshold, morphologyEx and bitwise_and, %u thread(s):\n"
+        "  %lu of %lu readings differ, %lu pixels in all\n"
+        "  Gauge %.1f us, OpenCV %.1f us per reading\n",
+        threads,
+        checks.differing,
+        checks.readings,
+        checks.differing_pixels,
+        checks.preprocess_us / checks.readings,
+        checks.opencv_us / checks.readings);
+    printf(
+        "Pixel kernels (%s) against countNonZero and bitwise_not:\n"
+        "  %lu rows differ\n"
+        "  CountLight %.2f us, countNonZero %.2f us, InvertRow %.2f us, bitwise_not %.2f us per reading\n",
+        PixelKernels::Isa(),
+        checks.kernel_mismatches,
+        checks.count_light_us / checks.readings,
+        checks.count_non_zero_us / checks.readings,
+        checks.invert_row_us / checks.readings,
+        checks.bitwise_not_us / checks.readings);
+}
+
+static bool WritePgm(const string &filename, const Mat &img)
+{
+    auto file = fopen(filename.c_str(), "wb");
+    if (nullptr == file)
+    {
+        return false;
+    }
+    fprintf(file, "P5\n%d %d\n255\n", img.cols, img.rows);
+    for (auto y = 0; y < img.rows; y++)
+    {
+        fwrite(img.ptr<uchar>(y), 1, img.cols, file);
+    }
+    return 0 == fclose(file);
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned int dials = 200;
+    unsigned int positions = 25;
+    uint64 seed = 1;
+    unsigned int average_frames = 1;
+    bool background_model = false;
+    double tracking_window = 0;
+    unsigned int tracking_rescan = 0;
+    unsigned int threads = 1;
+    const char *csv_filename = nullptr;
+    const char *image_dir = nullptr;
+    bool check = false;
+    int opt;
+    while (-1 != (opt = getopt(argc, argv, "n:p:s:a:bt:r:j:c:w:eh")))
+    {
+        switch (opt)
+        {
+        case 'n':
+            dials = atoi(optarg);
+            break;
+        case 'p':
+            positions = atoi(optarg);
+            break;
+        case 's':
+            seed = strtoull(optarg, nullptr, 0);
+            break;
+        case 'a':
+            average_frames = atoi(optarg);
+            break;
+        case 'b':
+            background_model = true;
+            break;
+        case 't':
+            tracking_window = atof(optarg);
+            break;
+        case 'r':
+            tracking_rescan = atoi(optarg);
+            break;
+        case 'j':
+            threads = atoi(optarg);
+            break;
+        case 'c':
+            csv_filename = optarg;
+            break;
+        case 'w':
+            image_dir = optarg;
+            break;
+        case 'e':
+            check = true;
+            break;
+        default:
+            Usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (0 == dials || 0 == positions || 0 == average_frames || 0 == threads ||
+        (check && (1 < average_frames || background_model || 0 < tracking_window)))
+    {
+        Usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    // Keep the failed readings of the Gauge out of the report
+    Logger::SetLevel(LOG_CRIT);
+
+    auto csv = nullptr != csv_filename ? fopen(csv_filename, "w") : nullptr;
+    if (nullptr != csv)
+    {
+        fprintf(csv, "dial,clockwise,radius,needle_width,ticks,noise,blur,glare,dark,truth,value,error_deg,us\n");
+    }
+    else if (nullptr != csv_filename)
+    {
+        fprintf(stderr, "Failed to open %s\n", csv_filename);
+        return EXIT_FAILURE;
+    }
+
+    auto pool = 1 < threads ? new WorkerPool(threads) : nullptr;
+    RNG rng(seed);
+    Mat img(IMG_HEIGHT, IMG_WIDTH, CV_8U);
+    Results total = {{}, 0, 0};
+    Checks checks = {};
+    map<string, Results> by_property;
+    for (auto dial = 0U; dial < dials; dial++)
+    {
+        DialSpec spec;
+        RandomDialSpec(rng, img.size(), spec);
+        const string properties[] = {
+            spec.clockwise ? "clockwise" : "counterclockwise",
+            cv::format("radius=%d", spec.radius),
+            cv::format("needle_width=%d", spec.needle_width),
+            cv::format("ticks=%d", spec.ticks),
+            cv::format("noise=%g", spec.noise),
+            cv::format("blur=%g", spec.blur),
+            cv::format("glare=%g", spec.glare),
+            spec.dark ? "dark" : "light",
+        };
+
+        Gauge *gauge = nullptr;
+        for (auto position = 0U; position < positions; position++)
+        {
+            // Sweep the needle from min to max, the way a real needle moves
+            const auto value = (position + 0.5) / positions;
+            Point point_min;
+            Point point_max;
+            auto read = -1.0;
+            auto us = 0.0;
+            for (auto frame = 0U; frame < average_frames; frame++)
+            {
+                RenderDial(spec, value, rng, img, point_min, point_max);
+                if (nullptr == gauge)
+                {
+                    gauge = new Gauge(
+                        img.size(),
+                        spec.center,
+                        point_min,
+                        point_max,
+                        spec.clockwise,
+                        tracking_window,
+                        tracking_rescan,
+                        average_frames,
+                        background_model);
+                    gauge->SetWorkerPool(pool);
+                    if (nullptr != image_dir)
+                    {
+                        WritePgm(cv::format("%s/dial%04u.pgm", image_dir, dial), img);
+                    }
+                }
+                Mat crop = img(gauge->GetCropRect()).clone();
+                const Mat original = check ? crop.clone() : Mat();
+                const auto start = getTickCount();
+                if (gauge->AddCrop(crop))
+                {
+                    read = gauge->ComputeCropValue(crop);
+                }
+                us += ElapsedUs(start);
+                if (check)
+                {
+                    Check(*gauge, original, crop, checks);
+                }
+            }
+
+            // The angle between the read and the true needle position
+            const auto error = 0 > read ? NAN : fabs(read / 100 - value) * spec.sweep;
+            vector<Results *> all_results = {&total};
+            for (const auto &property : properties)
+            {
+                all_results.push_back(&by_property[property]);
+            }
+            for (auto results : all_results)
+            {
+                if (0 > read)
+                {
+                    results->failed++;
+                }
+                else
+                {
+                    results->errors.push_back(error);
+                }
+                results->total_us += us;
+            }
+            if (nullptr != csv)
+            {
+                fprintf(
+                    csv,
+                    "%u,%d,%d,%d,%d,%g,%g,%g,%d,%.3f,%.3f,%.3f,%.1f\n",
+                    dial,
+                    spec.clockwise,
+                    spec.radius,
+                    spec.needle_width,
+                    spec.ticks,
+                    spec.noise,
+                    spec.blur,
+                    spec.glare,
+                    spec.dark,
+                    100 * value,
+                    read,
+                    error,
+                    us);
+            }
+        }
+        checks.preprocess_us += gauge->GetPreprocessAvgUs() * positions;
+        delete gauge;
+    }
+
+    printf(
+        "%-18s %7s %8s %8s %8s %8s %7s %9s\n",
+        "",
+        "readings",
+        "p50 deg",
+        "p90 deg",
+        "p99 deg",
+        "max deg",
+        "fail %",
+        "us/read");
+    for (auto &[label, results] : by_property)
+    {
+        Report(label, results);
+    }
+    Report("all", total);
+    ReportChecks(checks, threads);
+
+    if (nullptr != csv)
+    {
+        fclose(csv);
+    }
+    delete pool;
+
+    return 0 < checks.differing || 0 < checks.kernel_mismatches ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,293 @@
+/**
+ * Copyright (C) 2025, Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * Compactness and flash writes of the reading history.
+ *
+ * Feeds simulated gauge readings of a few kinds through the history store,
+ * reopens it as after a respawn and reports the bytes per reading, the write
+ * amplification, the span of time held and the time of range queries.
+ */
+
+#include <chrono>
+#include <cmath>
+#include <map>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <syslog.h>
+#include <unistd.h>
+#include <vector>
+
+#include "Logger.hpp"
+#include "ReadingHistory.hpp"
+
+using namespace std;
+
+// Bytes of a reading stored as is: time, value and status
+#define RAW_READING_BYTES (8 + 8 + 1)
+// Start of the simulated time, Unix time (ms)
+#define START_MS (1767225600000LL)
+
+enum Scenario
+{
+    SCENARIO_STEADY,   // Constant value with a little noise
+    SCENARIO_DRIFTING, // Slow swing over the whole scale
+    SCENARIO_NOISY,    // Constant value with much noise
+    SCENARIO_STEPPING, // A new value every ten minutes
+    SCENARIO_FAILING,  // Steady, with failed and rejected readings
+    SCENARIO_CLOCK,    // Steady, with the clock set back an hour every six hours
+    NUM_SCENARIOS
+};
+static const char *scenario_names[NUM_SCENARIOS] = {"steady", "drifting", "noisy", "stepping", "failing", "clock"};
+
+struct Options
+{
+    double hours;
+    double rate;
+    unsigned int interval_ms;
+    unsigned int flush_period_s;
+    unsigned int blocks;
+    unsigned int seed;
+    string filename;
+};
+
+static void Usage(const char *name)
+{
+    fprintf(
+        stderr,
+        "Usage: %s [-d hours] [-r rate] [-i interval] [-f flush period] [-b blocks] [-s seed] [-o file]\n"
+        "  -d  Simulated hours per scenario (default 24)\n"
+        "  -r  Readings offered per second, the analyzed frame rate (default 10)\n"
+        "  -i  Shortest time (ms) between recorded readings (default %d)\n"
+        "  -f  Longest time (s) readings are kept in memory (default %d)\n"
+        "  -b  Blocks of the file (default %d)\n"
+        "  -s  Random seed (default 1)\n"
+        "  -o  History file, overwritten (default /tmp/historybench.bin)\n",
+        name,
+        HISTORY_INTERVAL_MS,
+        HISTORY_FLUSH_PERIOD_S,
+        HISTORY_BLOCKS);
+}
+
+static double ElapsedUs(const chrono::steady_clock::time_point &start)
+{
+    return chrono::duration<double, micro>(chrono::steady_clock::now() - start).count();
+}
+
+static bool Run(const Scenario scenario, const Options &options)
+{
+    unlink(options.filename.c_str());
+    auto history = new ReadingHistory(options.blocks, options.interval_ms, options.flush_period_s);
+    if (!history->Open(options.filename))
+    {
+        fprintf(stderr, "Failed to open %s\n", options.filename.c_str());
+        delete history;
+        return false;
+    }
+
+    // Frame times jitter around the frame rate
+    mt19937 rng(options.seed);
+    normal_distribution<double> jitter(0, 3);
+    normal_distribution<double> noise(0, SCENARIO_NOISY == scenario ? 2 : 0.05);
+    uniform_real_distribution<double> uniform(0, 1);
+    const auto frame_ms = 1000 / options.rate;
+    const auto end_ms = START_MS + static_cast<int64_t>(options.hours * 3600 * 1000);
+    // The clock set back repeats times
+    multimap<int64_t, pair<double, HistoryStatus>> offered;
+    auto level = 42.0;
+    int64_t step = 0;
+    unsigned long offered_count = 0;
+    const auto start = chrono::steady_clock::now();
+    for (auto t = 0.0; START_MS + t < end_ms; t += frame_ms)
+    {
+        auto time_ms = START_MS + static_cast<int64_t>(t + jitter(rng));
+        auto value = level;
+        auto status = HISTORY_GOOD;
+        switch (scenario)
+        {
+        case SCENARIO_DRIFTING:
+            value = 50 + 45 * sin(2 * M_PI * t / (6 * 3600 * 1000));
+            break;
+        case SCENARIO_STEPPING:
+            if (step != static_cast<int64_t>(t / (600 * 1000)))
+            {
+                step = static_cast<int64_t>(t / (600 * 1000));
+                level = 100 * uniform(rng);
+            }
+            break;
+        case SCENARIO_FAILING:
+        {
+            const auto draw = uniform(rng);
+            status = 0.05 > draw ? HISTORY_FAILED : 0.07 > draw ? HISTORY_REJECTED : HISTORY_GOOD;
+            break;
+        }
+        case SCENARIO_CLOCK:
+            time_ms -= static_cast<int64_t>(t / (6 * 3600 * 1000)) * 3600 * 1000;
+            break;
+        default:
+            break;
+        }
+        value = HISTORY_FAILED == status ? -1 : min(100.0, max(0.0, value + noise(rng)));
+        history->Append(time_ms, value, status);
+        offered.insert({time_ms, {value, status}});
+        offered_count++;
+    }
+    const auto append_us = ElapsedUs(start);
+    const auto stats = history->GetStats();
+
+    // Reopen, as after a respawn, and check what is held against what was offered
+    delete history;
+    history = new ReadingHistory(options.blocks, options.interval_ms, options.flush_period_s);
+    if (!history->Open(options.filename))
+    {
+        fprintf(stderr, "Failed to reopen %s\n", options.filename.c_str());
+        delete history;
+        return false;
+    }
+    vector<HistoryReading> readings;
+    auto query_start = chrono::steady_clock::now();
+    history->Query(0, INT64_MAX, SIZE_MAX, readings);
+    const auto query_all_us = ElapsedUs(query_start);
+    auto max_error = 0.0;
+    unsigned long mismatches = 0;
+    for (const auto &reading : readings)
+    {
+        auto error = -1.0;
+        const auto found = offered.equal_range(reading.time_ms);
+        for (auto i = found.first; found.second != i; i++)
+        {
+            if (i->second.second == reading.status && (0 > error || fabs(i->second.first - reading.value) < error))
+            {
+                error = fabs(i->second.first - reading.value);
+            }
+        }
+        if (0 > error)
+        {
+            mismatches++;
+            continue;
+        }
+        max_error = max(max_error, error);
+    }
+    if (readings.size() != stats.stored || 0 < mismatches)
+    {
+        fprintf(
+            stderr,
+            "%s: %zu readings after reopen, %lu held before, %lu mismatches\n",
+            scenario_names[scenario],
+            readings.size(),
+            stats.stored,
+            mismatches);
+    }
+
+    // An hour from the middle of what is held
+    readings.clear();
+    const auto middle_ms = stats.oldest_ms + (end_ms - stats.oldest_ms) / 2;
+    query_start = chrono::steady_clock::now();
+    history->Query(middle_ms, middle_ms + 3600 * 1000, SIZE_MAX, readings);
+    const auto query_hour_us = ElapsedUs(query_start);
+    delete history;
+
+    printf(
+        "%-9s %9lu %9lu %8.2f %6.1f %8lu %6.2f %8.1f %7.1f %8.0f %8.0f %8.3f %6.2f\n",
+        scenario_names[scenario],
+        offered_count,
+        stats.readings,
+        static_cast<double>(stats.encoded_bytes) / max(stats.readings, 1UL),
+        static_cast<double>(RAW_READING_BYTES * stats.readings) / max(stats.encoded_bytes, 1UL),
+        stats.flushes,
+        static_cast<double>(stats.flushed_bytes) / max(stats.encoded_bytes, 1UL),
+        stats.flushed_bytes / 1024.0 / options.hours * 24,
+        (end_ms - stats.oldest_ms) / 3600e3,
+        query_all_us,
+        query_hour_us,
+        append_us / offered_count,
+        max_error);
+
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    Options options = {24, 10, HISTORY_INTERVAL_MS, HISTORY_FLUSH_PERIOD_S, HISTORY_BLOCKS, 1, "/tmp/historybench.bin"};
+    int opt;
+    while (-1 != (opt = getopt(argc, argv, "d:r:i:f:b:s:o:h")))
+    {
+        switch (opt)
+        {
+        case 'd':
+            options.hours = atof(optarg);
+            break;
+        case 'r':
+            options.rate = atof(optarg);
+            break;
+        case 'i':
+            options.interval_ms = atoi(optarg);
+            break;
+        case 'f':
+            options.flush_period_s = atoi(optarg);
+            break;
+        case 'b':
+            options.blocks = atoi(optarg);
+            break;
+        case 's':
+            options.seed = atoi(optarg);
+            break;
+        case 'o':
+            options.filename = optarg;
+            break;
+        default:
+            Usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (0 >= options.hours || 0 >= options.rate || 2 > options.blocks)
+    {
+        Usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    // Keep the messages of the store out of the report
+    Logger::SetLevel(LOG_CRIT);
+
+    printf(
+        "%-9s %9s %9s %8s %6s %8s %6s %8s %7s %8s %8s %8s %6s\n",
+        "",
+        "offered",
+        "recorded",
+        "B/read",
+        "ratio",
+        "flushes",
+        "WA",
+        "KB/day",
+        "held h",
+        "all us",
+        "hour us",
+        "us/add",
+        "error");
+    for (auto scenario = 0; NUM_SCENARIOS > scenario; scenario++)
+    {
+        if (!Run(static_cast<Scenario>(scenario), options))
+        {
+            return EXIT_FAILURE;
+        }
+    }
+    unlink(options.filename.c_str());
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,92 @@
+#!/bin/sh
+#
+# Copyright (C) 2025, Axis Communications AB, Lund, Sweden
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+# Test of the CPU budget on the replayed recording HOSTSIM_FRAMES.
+#
+# Runs the host simulation without a budget, measures the CPU usage of the
+# process from /proc, then sets CpuBudget in the running application and
+# measures again once the governor has settled. Fails if the usage with the
+# budget is above it by more than the tolerance, and is inconclusive if the
+# usage without one was within the budget already.
+#
+# Usage: budget.sh [BUDGET_PERCENT] [SETTLE_S] [MEASURE_S] [TOLERANCE_PERCENT]
+
+BUDGET=${1:-10}
+SETTLE_S=${2:-30}
+MEASURE_S=${3:-20}
+TOLERANCE=${4:-25}
+DIR=$(cd "$(dirname "$0")" && pwd)
+RUN_DIR=$DIR/run
+TARGET=opcuagaugereader
+
+if [ -z "$HOSTSIM_FRAMES" ] || [ ! -f "$HOSTSIM_FRAMES" ]; then
+    echo "Set HOSTSIM_FRAMES to the raw NV12 recording to replay" >&2
+    exit 2
+fi
+
+# CPU time of a process in clock ticks, user and system
+cpu_ticks() {
+    awk '{ print $14 + $15 }' "/proc/$1/stat"
+}
+
+# CPU usage of a process over MEASURE_S, in percent of one core
+cpu_percent() {
+    start=$(cpu_ticks "$1")
+    sleep "$MEASURE_S"
+    end=$(cpu_ticks "$1")
+    echo "$start $end $(getconf CLK_TCK) $MEASURE_S" | awk '{ printf "%.1f", 100 * ($2 - $1) / $3 / $4 }'
+}
+
+set_budget() {
+    sed -i "s/^CpuBudget=.*/CpuBudget=$1/" "$RUN_DIR/params.conf"
+}
+
+make -C "$DIR" all || exit 2
+mkdir -p "$RUN_DIR"
+cp "$DIR/params.conf" "$RUN_DIR/params.conf"
+set_budget 0
+
+make -C "$DIR" run >"$RUN_DIR/budget.log" 2>&1 &
+RUN=$!
+trap 'kill $RUN 2>/dev/null; pkill -x $TARGET' EXIT
+PID=
+for _ in $(seq 50); do
+    PID=$(pgrep -n -x $TARGET) && break
+    sleep 0.2
+done
+if [ -z "$PID" ]; then
+    echo "$TARGET did not start, see $RUN_DIR/budget.log" >&2
+    exit 2
+fi
+
+sleep "$SETTLE_S"
+UNLIMITED=$(cpu_percent "$PID")
+echo "CPU usage without budget: $UNLIMITED%"
+
+set_budget "$BUDGET"
+sleep "$SETTLE_S"
+BUDGETED=$(cpu_percent "$PID")
+echo "CPU usage with a budget of $BUDGET%: $BUDGETED%"
+
+if awk "BEGIN { exit !($UNLIMITED <= $BUDGET) }"; then
+    echo "Inconclusive: the usage without budget is within it, lower BUDGET_PERCENT"
+    exit 2
+fi
+if awk "BEGIN { exit !($BUDGETED > $BUDGET * (100 + $TOLERANCE) / 100) }"; then
+    echo "FAIL: more than $TOLERANCE% over the budget"
+    exit 1
+fi
+echo "PASS"
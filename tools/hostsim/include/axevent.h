@@ -0,0 +1,98 @@
+/**
+ * Copyright (C) 2025, Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * This header file declares the host stand-in for axevent.
+ *
+ * Events are counted and recorded, see AxEventStandIn.cpp.
+ */
+
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef enum
+{
+    AX_VALUE_TYPE_INT,
+    AX_VALUE_TYPE_BOOL,
+    AX_VALUE_TYPE_DOUBLE,
+    AX_VALUE_TYPE_STRING,
+    AX_VALUE_TYPE_ELEMENT,
+} AXEventValueType;
+
+typedef struct _AXEventHandler AXEventHandler;
+typedef struct _AXEventKeyValueSet AXEventKeyValueSet;
+typedef struct _AXEvent AXEvent;
+typedef void (*AXDeclarationCompleteCallback)(guint declaration, gpointer user_data);
+
+AXEventHandler *ax_event_handler_new(void);
+void ax_event_handler_free(AXEventHandler *event_handler);
+gboolean ax_event_handler_declare(
+    AXEventHandler *event_handler,
+    AXEventKeyValueSet *key_value_set,
+    gboolean stateless,
+    guint *declaration,
+    AXDeclarationCompleteCallback callback,
+    gpointer user_data,
+    GError **error);
+gboolean ax_event_handler_undeclare(AXEventHandler *event_handler, guint declaration, GError **error);
+gboolean ax_event_handler_send_event(
+    AXEventHandler *event_handler,
+    guint declaration,
+    AXEvent *event,
+    GError **error);
+
+AXEventKeyValueSet *ax_event_key_value_set_new(void);
+void ax_event_key_value_set_free(AXEventKeyValueSet *key_value_set);
+gboolean ax_event_key_value_set_add_key_value(
+    AXEventKeyValueSet *key_value_set,
+    const gchar *key,
+    const gchar *name_space,
+    gconstpointer value,
+    AXEventValueType value_type,
+    GError **error);
+gboolean ax_event_key_value_set_add_key_values(AXEventKeyValueSet *key_value_set, GError **error, ...);
+gboolean ax_event_key_value_set_add_nice_names(
+    AXEventKeyValueSet *key_value_set,
+    const gchar *key,
+    const gchar *name_space,
+    const gchar *key_nice_name,
+    const gchar *value_nice_name,
+    GError **error);
+gboolean ax_event_key_value_set_mark_as_source(
+    AXEventKeyValueSet *key_value_set,
+    const gchar *key,
+    const gchar *name_space,
+    GError **error);
+gboolean ax_event_key_value_set_mark_as_data(
+    AXEventKeyValueSet *key_value_set,
+    const gchar *key,
+    const gchar *name_space,
+    GError **error);
+gboolean ax_event_key_value_set_mark_as_user_defined(
+    AXEventKeyValueSet *key_value_set,
+    const gchar *key,
+    const gchar *name_space,
+    const gchar *user_tag,
+    GError **error);
+
+AXEvent *ax_event_new2(AXEventKeyValueSet *key_value_set, GDateTime *time_stamp);
+void ax_event_free(AXEvent *event);
+
+G_END_DECLS
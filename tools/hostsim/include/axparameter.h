@@ -0,0 +1,49 @@
+/**
+ * Copyright (C) 2025, Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * This header file declares the host stand-in for axparameter.
+ *
+ * The parameters are read from a key file, see AxParameterStandIn.cpp.
+ */
+
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _AXParameter AXParameter;
+typedef void (*AXParameterCallback)(const gchar *name, const gchar *value, gpointer data);
+
+AXParameter *ax_parameter_new(const gchar *app_name, GError **error);
+void ax_parameter_free(AXParameter *parameter);
+gboolean ax_parameter_get(AXParameter *parameter, const gchar *name, gchar **value, GError **error);
+gboolean ax_parameter_set(
+    AXParameter *parameter,
+    const gchar *name,
+    const gchar *value,
+    gboolean do_sync,
+    GError **error);
+gboolean ax_parameter_register_callback(
+    AXParameter *parameter,
+    const gchar *name,
+    AXParameterCallback callback,
+    gpointer userdata,
+    GError **error);
+
+G_END_DECLS
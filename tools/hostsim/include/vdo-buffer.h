@@ -0,0 +1,34 @@
+/**
+ * Copyright (C) 2025, Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * This header file declares the host stand-in for the VDO frame buffers.
+ */
+
+#pragma once
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define VDO_TYPE_BUFFER (vdo_buffer_get_type())
+G_DECLARE_FINAL_TYPE(VdoBuffer, vdo_buffer, VDO, BUFFER, GObject)
+
+gpointer vdo_buffer_get_data(VdoBuffer *self);
+gsize vdo_buffer_get_capacity(VdoBuffer *self);
+
+G_END_DECLS
@@ -0,0 +1,36 @@
+/**
+ * Copyright (C) 2025, Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * This header file declares the host stand-in for the VDO settings map.
+ */
+
+#pragma once
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define VDO_TYPE_MAP (vdo_map_get_type())
+G_DECLARE_FINAL_TYPE(VdoMap, vdo_map, VDO, MAP, GObject)
+
+VdoMap *vdo_map_new(void);
+void vdo_map_set_uint32(VdoMap *self, const gchar *name, guint32 value);
+guint32 vdo_map_get_uint32(const VdoMap *self, const gchar *name, guint32 def);
+void vdo_map_dump(const VdoMap *self);
+
+G_END_DECLS
@@ -0,0 +1,45 @@
+/**
+ * Copyright (C) 2025, Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * This header file declares the host stand-in for the VDO streams.
+ */
+
+#pragma once
+
+#include <glib-object.h>
+
+#include "vdo-buffer.h"
+#include "vdo-map.h"
+#include "vdo-types.h"
+
+G_BEGIN_DECLS
+
+#define VDO_TYPE_STREAM (vdo_stream_get_type())
+G_DECLARE_FINAL_TYPE(VdoStream, vdo_stream, VDO, STREAM, GObject)
+
+typedef void (*VdoBufferFinalizer)(VdoBuffer *buffer);
+
+VdoStream *vdo_stream_new(VdoMap *settings, VdoBufferFinalizer fin, GError **error);
+gboolean vdo_stream_start(VdoStream *self, GError **error);
+void vdo_stream_stop(VdoStream *self);
+VdoBuffer *vdo_stream_buffer_alloc(VdoStream *self, gpointer opaque, GError **error);
+gboolean vdo_stream_buffer_enqueue(VdoStream *self, VdoBuffer *buffer, GError **error);
+gboolean vdo_stream_buffer_unref(VdoStream *self, VdoBuffer **buffer, GError **error);
+VdoBuffer *vdo_stream_get_buffer(VdoStream *self, GError **error);
+
+G_END_DECLS
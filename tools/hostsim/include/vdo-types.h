@@ -0,0 +1,59 @@
+/**
+ * Copyright (C) 2025, Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * This header file declares the host stand-in for the VDO types.
+ */
+
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef enum
+{
+    VDO_FORMAT_NONE = -1,
+    VDO_FORMAT_H264 = 0,
+    VDO_FORMAT_H265,
+    VDO_FORMAT_JPEG,
+    VDO_FORMAT_YUV,
+    VDO_FORMAT_RGBA = 7,
+    VDO_FORMAT_RGB,
+    VDO_FORMAT_PLANAR_RGB,
+} VdoFormat;
+
+typedef enum
+{
+    VDO_BUFFER_STRATEGY_NONE = 0,
+    VDO_BUFFER_STRATEGY_INFINITE,
+    VDO_BUFFER_STRATEGY_EXPLICIT,
+} VdoBufferStrategy;
+
+typedef struct
+{
+    guint width;
+    guint height;
+} VdoResolution;
+
+typedef struct
+{
+    gsize count;
+    VdoResolution resolutions[];
+} VdoResolutionSet;
+
+G_END_DECLS
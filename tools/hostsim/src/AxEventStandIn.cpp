@@ -0,0 +1,345 @@
+/**
+ * Copyright (C) 2025, Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * Host stand-in for axevent.
+ *
+ * Sent events are counted per declaration and, if HOSTSIM_EVENTS names a
+ * file, recorded there with one line per event: the time, the declaration and
+ * the declared key/value pairs updated with those of the event.
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <map>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+#include "axevent.h"
+#include "common.hpp"
+
+using namespace std;
+
+struct KeyValue
+{
+    string name_space;
+    AXEventValueType type;
+    string value; // Formatted value, empty for no value
+};
+
+struct _AXEventKeyValueSet
+{
+    map<string, KeyValue> values;
+};
+
+struct _AXEvent
+{
+    map<string, KeyValue> values;
+    GDateTime *time_stamp;
+};
+
+struct Declaration
+{
+    map<string, KeyValue> values;
+    gboolean stateless;
+    guint64 sent; // Events sent for the declaration
+};
+
+struct _AXEventHandler
+{
+    map<guint, Declaration> declarations;
+    guint next_declaration;
+    FILE *record; // Event record, nullptr for none
+};
+
+struct DeclarationComplete
+{
+    AXDeclarationCompleteCallback callback;
+    guint declaration;
+    gpointer user_data;
+};
+
+static GQuark ax_event_error_quark()
+{
+    return g_quark_from_static_string("axevent-standin-error-quark");
+}
+
+static string format_value(gconstpointer value, const AXEventValueType value_type)
+{
+    if (nullptr == value)
+    {
+        return "";
+    }
+    switch (value_type)
+    {
+    case AX_VALUE_TYPE_INT:
+        return to_string(*static_cast<const gint *>(value));
+    case AX_VALUE_TYPE_BOOL:
+        return *static_cast<const gboolean *>(value) ? "1" : "0";
+    case AX_VALUE_TYPE_DOUBLE:
+    {
+        gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+        return g_ascii_dtostr(buf, sizeof(buf), *static_cast<const gdouble *>(value));
+    }
+    case AX_VALUE_TYPE_STRING:
+    case AX_VALUE_TYPE_ELEMENT:
+        return static_cast<const gchar *>(value);
+    }
+    return "";
+}
+
+AXEventHandler *ax_event_handler_new(void)
+{
+    auto event_handler = new AXEventHandler();
+    event_handler->next_declaration = 1;
+    event_handler->record = nullptr;
+    const auto filename = g_getenv("HOSTSIM_EVENTS");
+    if (nullptr != filename)
+    {
+        event_handler->record = fopen(filename, "a");
+        if (nullptr == event_handler->record)
+        {
+            LOG_E("%s: Failed to open %s (%s)", __func__, filename, strerror(errno));
+        }
+    }
+    return event_handler;
+}
+
+void ax_event_handler_free(AXEventHandler *event_handler)
+{
+    if (nullptr == event_handler)
+    {
+        return;
+    }
+    if (nullptr != event_handler->record)
+    {
+        fclose(event_handler->record);
+    }
+    delete event_handler;
+}
+
+static gboolean declaration_complete(gpointer data)
+{
+    auto complete = static_cast<DeclarationComplete *>(data);
+    complete->callback(complete->declaration, complete->user_data);
+    delete complete;
+    return G_SOURCE_REMOVE;
+}
+
+gboolean ax_event_handler_declare(
+    AXEventHandler *event_handler,
+    AXEventKeyValueSet *key_value_set,
+    gboolean stateless,
+    guint *declaration,
+    AXDeclarationCompleteCallback callback,
+    gpointer user_data,
+    GError **error)
+{
+    assert(nullptr != event_handler);
+    assert(nullptr != declaration);
+    if (nullptr == key_value_set)
+    {
+        g_set_error(error, ax_event_error_quark(), 0, "No key/value set");
+        return FALSE;
+    }
+    *declaration = event_handler->next_declaration++;
+    event_handler->declarations[*declaration] = {key_value_set->values, stateless, 0};
+
+    // The event system completes declarations asynchronously, from the main loop
+    if (nullptr != callback)
+    {
+        g_idle_add(declaration_complete, new DeclarationComplete{callback, *declaration, user_data});
+    }
+    return TRUE;
+}
+
+gboolean ax_event_handler_undeclare(AXEventHandler *event_handler, guint declaration, GError **error)
+{
+    assert(nullptr != event_handler);
+    const auto it = event_handler->declarations.find(declaration);
+    if (event_handler->declarations.end() == it)
+    {
+        g_set_error(error, ax_event_error_quark(), 0, "No declaration %u", declaration);
+        return FALSE;
+    }
+    LOG_I("%s: Declaration %u sent %" G_GUINT64_FORMAT " events", __func__, declaration, it->second.sent);
+    event_handler->declarations.erase(it);
+    return TRUE;
+}
+
+gboolean ax_event_handler_send_event(
+    AXEventHandler *event_handler,
+    guint declaration,
+    AXEvent *event,
+    GError **error)
+{
+    assert(nullptr != event_handler);
+    assert(nullptr != event);
+    const auto it = event_handler->declarations.find(declaration);
+    if (event_handler->declarations.end() == it)
+    {
+        g_set_error(error, ax_event_error_quark(), 0, "No declaration %u", declaration);
+        return FALSE;
+    }
+    auto values = it->second.values;
+    for (const auto &[key, value] : event->values)
+    {
+        const auto declared = values.find(key);
+        if (values.end() == declared || declared->second.type != value.type)
+        {
+            g_set_error(error, ax_event_error_quark(), 0, "Key %s is not declared with this type", key.c_str());
+            return FALSE;
+        }
+        declared->second.value = value.value;
+    }
+    it->second.sent++;
+
+    if (nullptr != event_handler->record)
+    {
+        auto time = g_date_time_format_iso8601(event->time_stamp);
+        fprintf(event_handler->record, "%s %u", time, declaration);
+        g_free(time);
+        for (const auto &[key, value] : values)
+        {
+            fprintf(event_handler->record, " %s=%s", key.c_str(), value.value.c_str());
+        }
+        fputc('\n', event_handler->record);
+        fflush(event_handler->record);
+    }
+    return TRUE;
+}
+
+AXEventKeyValueSet *ax_event_key_value_set_new(void)
+{
+    return new AXEventKeyValueSet();
+}
+
+void ax_event_key_value_set_free(AXEventKeyValueSet *key_value_set)
+{
+    delete key_value_set;
+}
+
+gboolean ax_event_key_value_set_add_key_value(
+    AXEventKeyValueSet *key_value_set,
+    const gchar *key,
+    const gchar *name_space,
+    gconstpointer value,
+    AXEventValueType value_type,
+    GError **error)
+{
+    if (nullptr == key_value_set || nullptr == key)
+    {
+        g_set_error(error, ax_event_error_quark(), 0, "No key/value set or key");
+        return FALSE;
+    }
+    key_value_set->values[key] = {nullptr != name_space ? name_space : "", value_type, format_value(value, value_type)};
+    return TRUE;
+}
+
+gboolean ax_event_key_value_set_add_key_values(AXEventKeyValueSet *key_value_set, GError **error, ...)
+{
+    va_list args;
+    va_start(args, error);
+    auto result = TRUE;
+    for (auto key = va_arg(args, const gchar *); nullptr != key && result; key = va_arg(args, const gchar *))
+    {
+        const auto name_space = va_arg(args, const gchar *);
+        const auto value = va_arg(args, gconstpointer);
+        const auto value_type = static_cast<AXEventValueType>(va_arg(args, int));
+        result = ax_event_key_value_set_add_key_value(key_value_set, key, name_space, value, value_type, error);
+    }
+    va_end(args);
+    return result;
+}
+
+static gboolean has_key(AXEventKeyValueSet *key_value_set, const gchar *key, GError **error)
+{
+    if (nullptr == key_value_set || nullptr == key || key_value_set->values.end() == key_value_set->values.find(key))
+    {
+        g_set_error(error, ax_event_error_quark(), 0, "Key %s not in the set", nullptr != key ? key : "(null)");
+        return FALSE;
+    }
+    return TRUE;
+}
+
+// Nice names and markings only matter to the event consumers on a camera
+
+gboolean ax_event_key_value_set_add_nice_names(
+    AXEventKeyValueSet *key_value_set,
+    const gchar *key,
+    const gchar *name_space,
+    const gchar *key_nice_name,
+    const gchar *value_nice_name,
+    GError **error)
+{
+    (void)name_space;
+    (void)key_nice_name;
+    (void)value_nice_name;
+    return has_key(key_value_set, key, error);
+}
+
+gboolean ax_event_key_value_set_mark_as_source(
+    AXEventKeyValueSet *key_value_set,
+    const gchar *key,
+    const gchar *name_space,
+    GError **error)
+{
+    (void)name_space;
+    return has_key(key_value_set, key, error);
+}
+
+gboolean ax_event_key_value_set_mark_as_data(
+    AXEventKeyValueSet *key_value_set,
+    const gchar *key,
+    const gchar *name_space,
+    GError **error)
+{
+    (void)name_space;
+    return has_key(key_value_set, key, error);
+}
+
+gboolean ax_event_key_value_set_mark_as_user_defined(
+    AXEventKeyValueSet *key_value_set,
+    const gchar *key,
+    const gchar *name_space,
+    const gchar *user_tag,
+    GError **error)
+{
+    (void)name_space;
+    (void)user_tag;
+    return has_key(key_value_set, key, error);
+}
+
+AXEvent *ax_event_new2(AXEventKeyValueSet *key_value_set, GDateTime *time_stamp)
+{
+    assert(nullptr != key_value_set);
+    return new AXEvent{
+        key_value_set->values,
+        nullptr != time_stamp ? g_date_time_ref(time_stamp) : g_date_time_new_now_local()};
+}
+
+void ax_event_free(AXEvent *event)
+{
+    if (nullptr == event)
+    {
+        return;
+    }
+    g_date_time_unref(event->time_stamp);
+    delete event;
+}
@@ -0,0 +1,221 @@
+/**
+ * Copyright (C) 2025, Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * Host stand-in for axparameter.
+ *
+ * The parameters are the keys of the group named after the application in
+ * the key file HOSTSIM_PARAMS (default params.conf). The file is watched, and
+ * when it is saved the callbacks of the parameters that changed are called
+ * from the default main context, as on the camera.
+ */
+
+#include <assert.h>
+#include <gio/gio.h>
+#include <map>
+#include <string>
+
+#include "axparameter.h"
+#include "common.hpp"
+
+using namespace std;
+
+struct ParamCallback
+{
+    AXParameterCallback callback;
+    gpointer userdata;
+};
+
+struct _AXParameter
+{
+    string app_name;
+    string filename;
+    GKeyFile *values;                     // Values of the last load
+    GFileMonitor *monitor;                // Watches the file for changes
+    map<string, ParamCallback> callbacks; // Registered callbacks by parameter name
+};
+
+static GQuark ax_parameter_error_quark()
+{
+    return g_quark_from_static_string("axparameter-standin-error-quark");
+}
+
+/**
+ * brief Load the file again and notify the parameters that changed.
+ *
+ * param parameter Parameter handle.
+ */
+static void reload(AXParameter &parameter)
+{
+    GError *error = nullptr;
+    auto values = g_key_file_new();
+    if (!g_key_file_load_from_file(values, parameter.filename.c_str(), G_KEY_FILE_KEEP_COMMENTS, &error))
+    {
+        // Editors may save in steps; the last step triggers a new load
+        LOG_E("%s: Failed to load %s (%s)", __func__, parameter.filename.c_str(), error->message);
+        g_error_free(error);
+        g_key_file_unref(values);
+        return;
+    }
+    const auto group = parameter.app_name.c_str();
+    auto old_values = parameter.values;
+    parameter.values = values;
+
+    for (const auto &[name, callback] : parameter.callbacks)
+    {
+        auto value = g_key_file_get_value(values, group, name.c_str(), nullptr);
+        auto old_value = g_key_file_get_value(old_values, group, name.c_str(), nullptr);
+        if (nullptr != value && (nullptr == old_value || 0 != g_strcmp0(value, old_value)))
+        {
+            const auto full_name = "root." + parameter.app_name + "." + name;
+            callback.callback(full_name.c_str(), value, callback.userdata);
+        }
+        g_free(value);
+        g_free(old_value);
+    }
+    g_key_file_unref(old_values);
+}
+
+static gboolean has_param(const AXParameter &parameter, const gchar *name, GError **error)
+{
+    if (!g_key_file_has_key(parameter.values, parameter.app_name.c_str(), name, nullptr))
+    {
+        g_set_error(error, ax_parameter_error_quark(), 0, "No parameter %s in %s", name, parameter.filename.c_str());
+        return FALSE;
+    }
+    return TRUE;
+}
+
+static void file_changed(
+    GFileMonitor *monitor,
+    GFile *file,
+    GFile *other_file,
+    GFileMonitorEvent event_type,
+    gpointer user_data)
+{
+    (void)monitor;
+    (void)file;
+    (void)other_file;
+    assert(nullptr != user_data);
+    if (G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT == event_type || G_FILE_MONITOR_EVENT_CREATED == event_type)
+    {
+        reload(*static_cast<AXParameter *>(user_data));
+    }
+}
+
+AXParameter *ax_parameter_new(const gchar *app_name, GError **error)
+{
+    assert(nullptr != app_name);
+    const auto filename = g_getenv("HOSTSIM_PARAMS");
+    auto parameter = new AXParameter();
+    parameter->app_name = app_name;
+    parameter->filename = nullptr != filename ? filename : "params.conf";
+    parameter->values = g_key_file_new();
+    parameter->monitor = nullptr;
+    if (!g_key_file_load_from_file(parameter->values, parameter->filename.c_str(), G_KEY_FILE_KEEP_COMMENTS, error))
+    {
+        ax_parameter_free(parameter);
+        return nullptr;
+    }
+    if (!g_key_file_has_group(parameter->values, app_name))
+    {
+        g_set_error(error, ax_parameter_error_quark(), 0, "No [%s] group in %s", app_name, parameter->filename.c_str());
+        ax_parameter_free(parameter);
+        return nullptr;
+    }
+
+    auto file = g_file_new_for_path(parameter->filename.c_str());
+    parameter->monitor = g_file_monitor_file(file, G_FILE_MONITOR_NONE, nullptr, error);
+    g_object_unref(file);
+    if (nullptr == parameter->monitor)
+    {
+        ax_parameter_free(parameter);
+        return nullptr;
+    }
+    g_signal_connect(parameter->monitor, "changed", G_CALLBACK(file_changed), parameter);
+    LOG_I("%s: Parameters of %s from %s", __func__, app_name, parameter->filename.c_str());
+
+    return parameter;
+}
+
+void ax_parameter_free(AXParameter *parameter)
+{
+    if (nullptr == parameter)
+    {
+        return;
+    }
+    if (nullptr != parameter->monitor)
+    {
+        g_file_monitor_cancel(parameter->monitor);
+        g_object_unref(parameter->monitor);
+    }
+    g_key_file_unref(parameter->values);
+    delete parameter;
+}
+
+gboolean ax_parameter_get(AXParameter *parameter, const gchar *name, gchar **value, GError **error)
+{
+    assert(nullptr != parameter);
+    assert(nullptr != value);
+    *value = g_key_file_get_value(parameter->values, parameter->app_name.c_str(), name, error);
+    return nullptr != *value;
+}
+
+/**
+ * brief Store a value in the file; the callbacks run when the change is seen.
+ */
+gboolean ax_parameter_set(
+    AXParameter *parameter,
+    const gchar *name,
+    const gchar *value,
+    gboolean do_sync,
+    GError **error)
+{
+    (void)do_sync;
+    assert(nullptr != parameter);
+    if (!has_param(*parameter, name, error))
+    {
+        return FALSE;
+    }
+    auto values = g_key_file_new();
+    if (!g_key_file_load_from_file(values, parameter->filename.c_str(), G_KEY_FILE_KEEP_COMMENTS, error))
+    {
+        g_key_file_unref(values);
+        return FALSE;
+    }
+    g_key_file_set_value(values, parameter->app_name.c_str(), name, value);
+    const auto saved = g_key_file_save_to_file(values, parameter->filename.c_str(), error);
+    g_key_file_unref(values);
+    return saved;
+}
+
+gboolean ax_parameter_register_callback(
+    AXParameter *parameter,
+    const gchar *name,
+    AXParameterCallback callback,
+    gpointer userdata,
+    GError **error)
+{
+    assert(nullptr != parameter);
+    assert(nullptr != callback);
+    if (!has_param(*parameter, name, error))
+    {
+        return FALSE;
+    }
+    parameter->callbacks[name] = {callback, userdata};
+    return TRUE;
+}
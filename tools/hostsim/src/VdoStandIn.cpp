@@ -0,0 +1,436 @@
+/**
+ * Copyright (C) 2025, Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * Host stand-in for VDO.
+ *
+ * The channel offers a single resolution, HOSTSIM_RESOLUTION (default
+ * 640x360). Streams replay the NV12 frames of the raw file HOSTSIM_FRAMES at
+ * HOSTSIM_FPS (default 30) frames per second, from the start again at the end.
+ * Such a file is made from a recording with, for example,
+ *   ffmpeg -i gauge.mp4 -vf scale=640:360 -pix_fmt nv12 -f rawvideo gauge.nv12
+ * Without HOSTSIM_FRAMES the streams deliver uniform gray frames.
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "common.hpp"
+#include "vdo-channel.h"
+#include "vdo-stream.h"
+
+#define DEFAULT_WIDTH (640)
+#define DEFAULT_HEIGHT (360)
+#define DEFAULT_FPS (30)
+// Longest wait for a buffer to be enqueued, so that the client can shut down
+#define BUFFER_WAIT_US (G_USEC_PER_SEC)
+
+static GQuark vdo_error_quark()
+{
+    return g_quark_from_static_string("vdo-standin-error-quark");
+}
+
+struct _VdoMap
+{
+    GObject parent_instance;
+    GHashTable *values; // Name to guint32
+};
+
+G_DEFINE_TYPE(VdoMap, vdo_map, G_TYPE_OBJECT)
+
+static void vdo_map_finalize(GObject *object)
+{
+    g_hash_table_unref(VDO_MAP(object)->values);
+    G_OBJECT_CLASS(vdo_map_parent_class)->finalize(object);
+}
+
+static void vdo_map_class_init(VdoMapClass *klass)
+{
+    G_OBJECT_CLASS(klass)->finalize = vdo_map_finalize;
+}
+
+static void vdo_map_init(VdoMap *self)
+{
+    self->values = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, nullptr);
+}
+
+VdoMap *vdo_map_new(void)
+{
+    return VDO_MAP(g_object_new(VDO_TYPE_MAP, nullptr));
+}
+
+void vdo_map_set_uint32(VdoMap *self, const gchar *name, guint32 value)
+{
+    g_hash_table_insert(self->values, g_strdup(name), GUINT_TO_POINTER(value));
+}
+
+guint32 vdo_map_get_uint32(const VdoMap *self, const gchar *name, guint32 def)
+{
+    gpointer value;
+    if (!g_hash_table_lookup_extended(self->values, name, nullptr, &value))
+    {
+        return def;
+    }
+    return GPOINTER_TO_UINT(value);
+}
+
+void vdo_map_dump(const VdoMap *self)
+{
+    GHashTableIter iter;
+    gpointer name;
+    gpointer value;
+    g_hash_table_iter_init(&iter, self->values);
+    while (g_hash_table_iter_next(&iter, &name, &value))
+    {
+        LOG_I("%s: %s = %u", __func__, static_cast<const gchar *>(name), GPOINTER_TO_UINT(value));
+    }
+}
+
+struct _VdoBuffer
+{
+    GObject parent_instance;
+    gpointer data;
+    gsize capacity;
+};
+
+G_DEFINE_TYPE(VdoBuffer, vdo_buffer, G_TYPE_OBJECT)
+
+static void vdo_buffer_finalize(GObject *object)
+{
+    g_free(VDO_BUFFER(object)->data);
+    G_OBJECT_CLASS(vdo_buffer_parent_class)->finalize(object);
+}
+
+static void vdo_buffer_class_init(VdoBufferClass *klass)
+{
+    G_OBJECT_CLASS(klass)->finalize = vdo_buffer_finalize;
+}
+
+static void vdo_buffer_init(VdoBuffer *self)
+{
+    self->data = nullptr;
+    self->capacity = 0;
+}
+
+gpointer vdo_buffer_get_data(VdoBuffer *self)
+{
+    return self->data;
+}
+
+gsize vdo_buffer_get_capacity(VdoBuffer *self)
+{
+    return self->capacity;
+}
+
+struct _VdoChannel
+{
+    GObject parent_instance;
+    guint nbr;
+};
+
+G_DEFINE_TYPE(VdoChannel, vdo_channel, G_TYPE_OBJECT)
+
+static void vdo_channel_class_init(VdoChannelClass *klass)
+{
+    (void)klass;
+}
+
+static void vdo_channel_init(VdoChannel *self)
+{
+    self->nbr = 0;
+}
+
+/**
+ * brief Read the simulated sensor resolution from the environment.
+ *
+ * param width Width of the stream.
+ * param height Height of the stream.
+ * return False if HOSTSIM_RESOLUTION is malformed.
+ */
+static gboolean get_resolution(guint &width, guint &height)
+{
+    width = DEFAULT_WIDTH;
+    height = DEFAULT_HEIGHT;
+    const auto resolution = g_getenv("HOSTSIM_RESOLUTION");
+    if (nullptr == resolution)
+    {
+        return TRUE;
+    }
+    if (2 != sscanf(resolution, "%ux%u", &width, &height) || 0 == width || 0 == height || 0 != (width | height) % 2)
+    {
+        LOG_E("%s: HOSTSIM_RESOLUTION '%s' is not an even WIDTHxHEIGHT", __func__, resolution);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+VdoChannel *vdo_channel_get(guint nbr, GError **error)
+{
+    if (1 != nbr)
+    {
+        g_set_error(error, vdo_error_quark(), 0, "Channel %u does not exist", nbr);
+        return nullptr;
+    }
+    auto channel = VDO_CHANNEL(g_object_new(VDO_TYPE_CHANNEL, nullptr));
+    channel->nbr = nbr;
+    return channel;
+}
+
+VdoResolutionSet *vdo_channel_get_resolutions(VdoChannel *self, const VdoMap *filter, GError **error)
+{
+    (void)filter;
+    if (nullptr == self)
+    {
+        g_set_error(error, vdo_error_quark(), 0, "No channel");
+        return nullptr;
+    }
+    guint width;
+    guint height;
+    if (!get_resolution(width, height))
+    {
+        g_set_error(error, vdo_error_quark(), 0, "Invalid HOSTSIM_RESOLUTION");
+        return nullptr;
+    }
+    auto set = static_cast<VdoResolutionSet *>(g_malloc(sizeof(VdoResolutionSet) + sizeof(VdoResolution)));
+    set->count = 1;
+    set->resolutions[0].width = width;
+    set->resolutions[0].height = height;
+    return set;
+}
+
+struct _VdoStream
+{
+    GObject parent_instance;
+    guint width;
+    guint height;
+    gsize frame_size;     // Bytes of one NV12 frame
+    GMappedFile *frames;  // Replayed frames, nullptr for gray frames
+    gsize num_frames;     // Frames in the file
+    gsize next_frame;     // Next frame of the file to deliver
+    gint64 interval_us;   // Time between frames
+    gint64 next_frame_us; // Monotonic time of the next frame
+    gboolean started;
+    GMutex mutex;
+    GCond enqueued;       // Signalled when the client enqueues a buffer
+    GQueue *free_buffers; // Buffers enqueued by the client, not referenced
+    guint64 delivered;    // Frames delivered
+    guint64 waits;        // Frames delayed for lack of an enqueued buffer
+};
+
+G_DEFINE_TYPE(VdoStream, vdo_stream, G_TYPE_OBJECT)
+
+static void vdo_stream_finalize(GObject *object)
+{
+    auto self = VDO_STREAM(object);
+    LOG_I(
+        "%s: Delivered %" G_GUINT64_FORMAT " frames, %" G_GUINT64_FORMAT " waited for a buffer",
+        __func__,
+        self->delivered,
+        self->waits);
+    if (nullptr != self->frames)
+    {
+        g_mapped_file_unref(self->frames);
+    }
+    g_queue_free(self->free_buffers);
+    g_cond_clear(&self->enqueued);
+    g_mutex_clear(&self->mutex);
+    G_OBJECT_CLASS(vdo_stream_parent_class)->finalize(object);
+}
+
+static void vdo_stream_class_init(VdoStreamClass *klass)
+{
+    G_OBJECT_CLASS(klass)->finalize = vdo_stream_finalize;
+}
+
+static void vdo_stream_init(VdoStream *self)
+{
+    g_mutex_init(&self->mutex);
+    g_cond_init(&self->enqueued);
+    self->free_buffers = g_queue_new();
+}
+
+VdoStream *vdo_stream_new(VdoMap *settings, VdoBufferFinalizer fin, GError **error)
+{
+    (void)fin;
+    assert(nullptr != settings);
+    if (VDO_FORMAT_YUV != vdo_map_get_uint32(settings, "format", VDO_FORMAT_NONE))
+    {
+        g_set_error(error, vdo_error_quark(), 0, "Only the YUV (NV12) format is simulated");
+        return nullptr;
+    }
+    guint width;
+    guint height;
+    if (!get_resolution(width, height))
+    {
+        g_set_error(error, vdo_error_quark(), 0, "Invalid HOSTSIM_RESOLUTION");
+        return nullptr;
+    }
+    if (width != vdo_map_get_uint32(settings, "width", width) ||
+        height != vdo_map_get_uint32(settings, "height", height))
+    {
+        g_set_error(error, vdo_error_quark(), 0, "Only the channel resolution %ux%u is simulated", width, height);
+        return nullptr;
+    }
+
+    const auto fps_str = g_getenv("HOSTSIM_FPS");
+    const auto fps = nullptr != fps_str ? g_ascii_strtod(fps_str, nullptr) : DEFAULT_FPS;
+    if (0 >= fps)
+    {
+        g_set_error(error, vdo_error_quark(), 0, "Invalid HOSTSIM_FPS");
+        return nullptr;
+    }
+
+    auto self = VDO_STREAM(g_object_new(VDO_TYPE_STREAM, nullptr));
+    self->width = width;
+    self->height = height;
+    self->frame_size = width * height * 3 / 2;
+    self->interval_us = G_USEC_PER_SEC / fps;
+
+    const auto filename = g_getenv("HOSTSIM_FRAMES");
+    if (nullptr == filename)
+    {
+        LOG_I("%s: HOSTSIM_FRAMES is not set, delivering gray %ux%u frames", __func__, width, height);
+        return self;
+    }
+    self->frames = g_mapped_file_new(filename, FALSE, error);
+    if (nullptr == self->frames)
+    {
+        g_object_unref(self);
+        return nullptr;
+    }
+    self->num_frames = g_mapped_file_get_length(self->frames) / self->frame_size;
+    if (0 == self->num_frames)
+    {
+        g_set_error(error, vdo_error_quark(), 0, "%s holds no %ux%u NV12 frame", filename, width, height);
+        g_object_unref(self);
+        return nullptr;
+    }
+    LOG_I(
+        "%s: Replaying %zu %ux%u frames from %s at %.1f fps",
+        __func__,
+        self->num_frames,
+        width,
+        height,
+        filename,
+        fps);
+
+    return self;
+}
+
+gboolean vdo_stream_start(VdoStream *self, GError **error)
+{
+    (void)error;
+    self->started = TRUE;
+    self->next_frame_us = g_get_monotonic_time();
+    return TRUE;
+}
+
+void vdo_stream_stop(VdoStream *self)
+{
+    self->started = FALSE;
+}
+
+VdoBuffer *vdo_stream_buffer_alloc(VdoStream *self, gpointer opaque, GError **error)
+{
+    (void)opaque;
+    (void)error;
+    auto buffer = VDO_BUFFER(g_object_new(VDO_TYPE_BUFFER, nullptr));
+    buffer->capacity = self->frame_size;
+    // Mid gray luma and neutral chroma
+    buffer->data = g_malloc(buffer->capacity);
+    memset(buffer->data, 128, buffer->capacity);
+    return buffer;
+}
+
+gboolean vdo_stream_buffer_enqueue(VdoStream *self, VdoBuffer *buffer, GError **error)
+{
+    if (nullptr == buffer || self->frame_size != buffer->capacity)
+    {
+        g_set_error(error, vdo_error_quark(), 0, "Not a buffer of this stream");
+        return FALSE;
+    }
+    g_mutex_lock(&self->mutex);
+    g_queue_push_tail(self->free_buffers, buffer);
+    g_cond_signal(&self->enqueued);
+    g_mutex_unlock(&self->mutex);
+    return TRUE;
+}
+
+gboolean vdo_stream_buffer_unref(VdoStream *self, VdoBuffer **buffer, GError **error)
+{
+    (void)error;
+    assert(nullptr != buffer);
+    g_mutex_lock(&self->mutex);
+    g_queue_remove(self->free_buffers, *buffer);
+    g_mutex_unlock(&self->mutex);
+    g_clear_object(buffer);
+    return TRUE;
+}
+
+/**
+ * brief Block until the next frame is due and deliver it in an enqueued buffer.
+ *
+ * return Buffer with an extra reference for the caller, nullptr on failure.
+ */
+VdoBuffer *vdo_stream_get_buffer(VdoStream *self, GError **error)
+{
+    if (!self->started)
+    {
+        g_set_error(error, vdo_error_quark(), 0, "Stream not started");
+        return nullptr;
+    }
+
+    // Pace the frames like a sensor; a late reader does not get a burst
+    const auto now = g_get_monotonic_time();
+    if (self->next_frame_us > now)
+    {
+        g_usleep(self->next_frame_us - now);
+    }
+    self->next_frame_us = MAX(self->next_frame_us, now) + self->interval_us;
+
+    g_mutex_lock(&self->mutex);
+    if (g_queue_is_empty(self->free_buffers))
+    {
+        self->waits++;
+        const auto end_time = g_get_monotonic_time() + BUFFER_WAIT_US;
+        while (g_queue_is_empty(self->free_buffers))
+        {
+            if (!g_cond_wait_until(&self->enqueued, &self->mutex, end_time))
+            {
+                break;
+            }
+        }
+    }
+    auto buffer = static_cast<VdoBuffer *>(g_queue_pop_head(self->free_buffers));
+    g_mutex_unlock(&self->mutex);
+    if (nullptr == buffer)
+    {
+        g_set_error(error, vdo_error_quark(), 0, "No buffer enqueued");
+        return nullptr;
+    }
+
+    if (nullptr != self->frames)
+    {
+        const auto contents = g_mapped_file_get_contents(self->frames);
+        memcpy(buffer->data, contents + self->next_frame * self->frame_size, self->frame_size);
+        self->next_frame = (self->next_frame + 1) % self->num_frames;
+    }
+    self->delivered++;
+
+    return VDO_BUFFER(g_object_ref(buffer));
+}
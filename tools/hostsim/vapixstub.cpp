@@ -0,0 +1,222 @@
+/**
+ * Copyright (C) 2025, Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * Host stand-in for the VAPIX services of the camera.
+ *
+ * Owns com.axis.HTTPConf1 on the session bus to hand out service account
+ * credentials, and serves dynamicoverlay.cgi on 127.0.0.1 so that the
+ * overlay updates of the application can be counted and followed.
+ */
+
+#include <atomic>
+#include <gio/gio.h>
+#include <glib-unix.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace std;
+
+#define DEFAULT_PORT (8012)
+#define SERVICE_THREADS (4)
+
+static const gchar introspection_xml[] = "<node>"
+                                         "  <interface name='com.axis.HTTPConf1.VAPIXServiceAccounts1'>"
+                                         "    <method name='GetCredentials'>"
+                                         "      <arg type='s' name='username' direction='in'/>"
+                                         "      <arg type='s' name='credentials' direction='out'/>"
+                                         "    </method>"
+                                         "  </interface>"
+                                         "</node>";
+
+static atomic<unsigned long> requests_(0);
+static atomic<unsigned long> overlay_updates_(0);
+
+static void handle_method_call(
+    GDBusConnection *connection,
+    const gchar *sender,
+    const gchar *object_path,
+    const gchar *interface_name,
+    const gchar *method_name,
+    GVariant *parameters,
+    GDBusMethodInvocation *invocation,
+    gpointer user_data)
+{
+    (void)connection;
+    (void)sender;
+    (void)object_path;
+    (void)interface_name;
+    (void)user_data;
+    if (0 != g_strcmp0("GetCredentials", method_name))
+    {
+        g_dbus_method_invocation_return_dbus_error(invocation, "org.freedesktop.DBus.Error.UnknownMethod", method_name);
+        return;
+    }
+    const gchar *username;
+    g_variant_get(parameters, "(&s)", &username);
+    printf("Credentials for %s\n", username);
+    auto credentials = g_strdup_printf("%s:hostsim", username);
+    g_dbus_method_invocation_return_value(invocation, g_variant_new("(s)", credentials));
+    g_free(credentials);
+}
+
+static const GDBusInterfaceVTable interface_vtable = {handle_method_call, nullptr, nullptr, {}};
+
+static void bus_acquired(GDBusConnection *connection, const gchar *name, gpointer user_data)
+{
+    (void)name;
+    auto node_info = static_cast<GDBusNodeInfo *>(user_data);
+    GError *error = nullptr;
+    if (0 == g_dbus_connection_register_object(
+                 connection,
+                 "/com/axis/HTTPConf1/VAPIXServiceAccounts1",
+                 node_info->interfaces[0],
+                 &interface_vtable,
+                 nullptr,
+                 nullptr,
+                 &error))
+    {
+        fprintf(stderr, "Failed to register the service accounts object: %s\n", error->message);
+        g_error_free(error);
+    }
+}
+
+static void name_lost(GDBusConnection *connection, const gchar *name, gpointer user_data)
+{
+    (void)connection;
+    (void)user_data;
+    fprintf(stderr, "Could not own %s on the session bus\n", name);
+}
+
+/**
+ * brief Answer one HTTP request, on a thread of the service.
+ */
+static gboolean handle_connection(
+    GThreadedSocketService *service,
+    GSocketConnection *connection,
+    GObject *source_object,
+    gpointer user_data)
+{
+    (void)service;
+    (void)source_object;
+    (void)user_data;
+    auto in = g_data_input_stream_new(g_io_stream_get_input_stream(G_IO_STREAM(connection)));
+    auto out = g_io_stream_get_output_stream(G_IO_STREAM(connection));
+    auto request = g_data_input_stream_read_line(in, nullptr, nullptr, nullptr);
+    // Skip the headers
+    for (auto line = g_data_input_stream_read_line(in, nullptr, nullptr, nullptr);
+         nullptr != line && '\r' != line[0] && '\0' != line[0];
+         line = g_data_input_stream_read_line(in, nullptr, nullptr, nullptr))
+    {
+        g_free(line);
+    }
+    requests_++;
+
+    const gchar *status = "404 Not Found";
+    gchar path[1024];
+    const auto cgi = "/axis-cgi/dynamicoverlay.cgi?";
+    if (nullptr != request && 1 == sscanf(request, "GET %1023s HTTP/", path) && g_str_has_prefix(path, cgi))
+    {
+        auto params = g_uri_parse_params(path + strlen(cgi), -1, "&", G_URI_PARAMS_NONE, nullptr);
+        if (nullptr != params && 0 == g_strcmp0("settext", static_cast<gchar *>(g_hash_table_lookup(params, "action"))))
+        {
+            overlay_updates_++;
+            status = "200 OK";
+            printf(
+                "Overlay %s: %s\n",
+                static_cast<gchar *>(g_hash_table_lookup(params, "text_index")),
+                static_cast<gchar *>(g_hash_table_lookup(params, "text")));
+        }
+        else
+        {
+            status = "400 Bad Request";
+        }
+        if (nullptr != params)
+        {
+            g_hash_table_unref(params);
+        }
+    }
+    auto response = g_strdup_printf("HTTP/1.1 %s\r\nContent-Length: 0\r\nConnection: close\r\n\r\n", status);
+    g_output_stream_write_all(out, response, strlen(response), nullptr, nullptr, nullptr);
+    g_free(response);
+    g_free(request);
+    g_object_unref(in);
+
+    return TRUE;
+}
+
+static gboolean quit(gpointer loop)
+{
+    g_main_loop_quit(static_cast<GMainLoop *>(loop));
+    return G_SOURCE_REMOVE;
+}
+
+int main(int argc, char *argv[])
+{
+    const auto port = 1 < argc ? atoi(argv[1]) : DEFAULT_PORT;
+    if (0 >= port || 65535 < port)
+    {
+        fprintf(stderr, "Usage: %s [port]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    GError *error = nullptr;
+    auto service = g_threaded_socket_service_new(SERVICE_THREADS);
+    auto address = g_inet_socket_address_new_from_string("127.0.0.1", port);
+    if (!g_socket_listener_add_address(
+            G_SOCKET_LISTENER(service),
+            address,
+            G_SOCKET_TYPE_STREAM,
+            G_SOCKET_PROTOCOL_TCP,
+            nullptr,
+            nullptr,
+            &error))
+    {
+        fprintf(stderr, "Failed to listen on port %d: %s\n", port, error->message);
+        return EXIT_FAILURE;
+    }
+    g_object_unref(address);
+    g_signal_connect(service, "run", G_CALLBACK(handle_connection), nullptr);
+    g_socket_service_start(G_SOCKET_SERVICE(service));
+
+    auto node_info = g_dbus_node_info_new_for_xml(introspection_xml, nullptr);
+    const auto owner_id = g_bus_own_name(
+        G_BUS_TYPE_SESSION,
+        "com.axis.HTTPConf1",
+        G_BUS_NAME_OWNER_FLAGS_NONE,
+        bus_acquired,
+        nullptr,
+        name_lost,
+        node_info,
+        nullptr);
+
+    printf("VAPIX stand-in on 127.0.0.1:%d\n", port);
+    auto loop = g_main_loop_new(nullptr, FALSE);
+    g_unix_signal_add(SIGINT, quit, loop);
+    g_unix_signal_add(SIGTERM, quit, loop);
+    g_main_loop_run(loop);
+
+    printf("%lu requests, %lu overlay updates\n", requests_.load(), overlay_updates_.load());
+    g_bus_unown_name(owner_id);
+    g_dbus_node_info_unref(node_info);
+    g_socket_service_stop(G_SOCKET_SERVICE(service));
+    g_object_unref(service);
+    g_main_loop_unref(loop);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,256 @@
+/**
+ * Copyright (C) 2025, Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * Equivalence and speed of the pixel kernels.
+ *
+ * Runs every implementation of the pixel kernels the CPU supports against a
+ * plain reference on random rows of every length up to a limit, at every
+ * alignment, and on rows long enough to flush the lane counters. Then times
+ * each implementation on the rows of a gauge area. Fails if any result
+ * differs from the reference or a pixel outside the row is touched.
+ */
+
+#include <chrono>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <vector>
+
+#include "PixelKernels.hpp"
+
+using namespace std;
+
+// Bytes before and after each row that the kernels must leave alone
+#define GUARD_BYTES (64)
+// Longest row of the check, above the 255 vectors a lane counter holds
+#define MAX_CHECK_LEN (20000)
+// Value of the guard bytes
+#define GUARD_VALUE (0x5a)
+
+static const char *isas[] = {"NEON", "AVX2", "SSE2", "scalar"};
+
+struct Options
+{
+    unsigned int width;
+    unsigned int height;
+    unsigned int loops;
+    unsigned int checks;
+    unsigned int seed;
+};
+
+static void Usage(const char *name)
+{
+    fprintf(
+        stderr,
+        "Usage: %s [-w width] [-r rows] [-l loops] [-c checks] [-s seed]\n"
+        "  -w  Width (pixels) of the timed rows (default 640)\n"
+        "  -r  Rows per timed frame (default 480)\n"
+        "  -l  Timed frames per kernel (default 2000)\n"
+        "  -c  Random rows of the check (default 10000)\n"
+        "  -s  Random seed (default 1)\n",
+        name);
+}
+
+static unsigned int CountLightReference(const uint8_t *img, const size_t len, const uint8_t threshold)
+{
+    unsigned int light = 0;
+    for (size_t i = 0; i < len; i++)
+    {
+        light += threshold < img[i] ? 1 : 0;
+    }
+    return light;
+}
+
+static bool GuardsIntact(const vector<uint8_t> &buf, const size_t offset, const size_t len)
+{
+    for (size_t i = 0; i < buf.size(); i++)
+    {
+        if ((i < GUARD_BYTES + offset || i >= GUARD_BYTES + offset + len) && GUARD_VALUE != buf[i])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * brief Compare the selected kernels with the reference on one row.
+ *
+ * return Number of mismatches, 0 to 2.
+ */
+static unsigned int CheckRow(mt19937 &rng, const size_t len, const size_t offset, const uint8_t threshold, const int fill)
+{
+    vector<uint8_t> buf(GUARD_BYTES + offset + len + GUARD_BYTES, GUARD_VALUE);
+    const auto row = buf.data() + GUARD_BYTES + offset;
+    for (size_t i = 0; i < len; i++)
+    {
+        row[i] = 0 > fill ? rng() & 0xff : fill;
+    }
+    const vector<uint8_t> original(row, row + len);
+
+    unsigned int mismatches = 0;
+    if (CountLightReference(row, len, threshold) != PixelKernels::CountLight(row, len, threshold))
+    {
+        mismatches++;
+    }
+    PixelKernels::InvertRow(row, len);
+    auto inverted = GuardsIntact(buf, offset, len);
+    for (size_t i = 0; inverted && i < len; i++)
+    {
+        inverted = (original[i] ^ 0xff) == row[i];
+    }
+    if (!inverted)
+    {
+        mismatches++;
+    }
+    return mismatches;
+}
+
+static unsigned int Check(const Options &options, unsigned int &rows)
+{
+    mt19937 rng(options.seed);
+    unsigned int mismatches = 0;
+    rows = 0;
+    // Every short length at every alignment of the widest vector
+    for (size_t len = 0; len <= 256; len++)
+    {
+        for (size_t offset = 0; offset < 32; offset++)
+        {
+            mismatches += CheckRow(rng, len, offset, rng() & 0xff, -1);
+            rows++;
+        }
+    }
+    // Rows of one value: every pixel light, so the lane counters are full when flushed
+    const size_t long_lens[] = {255 * 16, 255 * 16 + 1, 255 * 32, 255 * 32 + 17, MAX_CHECK_LEN};
+    for (const auto len : long_lens)
+    {
+        for (const auto threshold : {0, 254, 255})
+        {
+            mismatches += CheckRow(rng, len, rng() % 32, threshold, 255);
+            mismatches += CheckRow(rng, len, rng() % 32, threshold, 0);
+            rows += 2;
+        }
+    }
+    for (auto n = 0U; n < options.checks; n++)
+    {
+        mismatches += CheckRow(rng, rng() % (MAX_CHECK_LEN + 1), rng() % 32, rng() & 0xff, -1);
+        rows++;
+    }
+    return mismatches;
+}
+
+/**
+ * brief Time the selected kernels on frames of random pixels.
+ *
+ * param count_ns Returns the time (ns) of CountLight over a frame.
+ * param invert_ns Returns the time (ns) of InvertRow over a frame.
+ */
+static void Time(const Options &options, double &count_ns, double &invert_ns)
+{
+    mt19937 rng(options.seed);
+    vector<uint8_t> frame(options.width * options.height);
+    for (auto &pixel : frame)
+    {
+        pixel = rng() & 0xff;
+    }
+
+    unsigned long light = 0;
+    auto start = chrono::steady_clock::now();
+    for (auto loop = 0U; loop < options.loops; loop++)
+    {
+        for (auto y = 0U; y < options.height; y++)
+        {
+            light += PixelKernels::CountLight(frame.data() + y * options.width, options.width, loop & 0xff);
+        }
+    }
+    count_ns = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / options.loops;
+
+    start = chrono::steady_clock::now();
+    for (auto loop = 0U; loop < options.loops; loop++)
+    {
+        for (auto y = 0U; y < options.height; y++)
+        {
+            PixelKernels::InvertRow(frame.data() + y * options.width, options.width);
+        }
+    }
+    invert_ns = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / options.loops;
+    // Keep the results alive
+    if (0 == light && 0 == frame[0])
+    {
+        fprintf(stderr, " ");
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    Options options = {640, 480, 2000, 10000, 1};
+    int opt;
+    while (-1 != (opt = getopt(argc, argv, "w:r:l:c:s:h")))
+    {
+        switch (opt)
+        {
+        case 'w':
+            options.width = atoi(optarg);
+            break;
+        case 'r':
+            options.height = atoi(optarg);
+            break;
+        case 'l':
+            options.loops = atoi(optarg);
+            break;
+        case 'c':
+            options.checks = atoi(optarg);
+            break;
+        case 's':
+            options.seed = atoi(optarg);
+            break;
+        default:
+            Usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (0 == options.width || 0 == options.height || 0 == options.loops)
+    {
+        Usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    const auto selected = PixelKernels::Isa();
+    printf("Selected at runtime: %s\n", selected);
+    printf("Timed frame: %ux%u pixels\n\n", options.width, options.height);
+    printf("%-8s %10s %10s %14s %15s\n", "", "rows", "mismatches", "count ns/frame", "invert ns/frame");
+    auto failed = false;
+    for (const auto isa : isas)
+    {
+        if (!PixelKernels::SelectIsa(isa))
+        {
+            printf("%-8s %s\n", isa, "not supported");
+            continue;
+        }
+        unsigned int rows;
+        const auto mismatches = Check(options, rows);
+        double count_ns;
+        double invert_ns;
+        Time(options, count_ns, invert_ns);
+        printf("%-8s %10u %10u %14.0f %15.0f\n", isa, rows, mismatches, count_ns, invert_ns);
+        failed = failed || 0 != mismatches;
+    }
+    PixelKernels::SelectIsa(selected);
+
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
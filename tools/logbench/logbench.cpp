@@ -0,0 +1,230 @@
+/**
+ * Copyright (C) 2025, Axis Communications AB, Lund, Sweden
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * Cost of a log line to the thread that logs it.
+ *
+ * Logs the line the application logs for every reading, the way the LOG
+ * macros did before the Logger (syslog() and printf() on every call) and
+ * through the Logger: queued for the writer thread, dropped by the rate limit
+ * of the call site and dropped by the log level. Reports the time of a call
+ * on the logging thread and the CPU time of the whole process per call, which
+ * includes the writer thread.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <sys/resource.h>
+#include <syslog.h>
+#include <unistd.h>
+#include <vector>
+
+#include "common.hpp"
+
+using namespace std;
+
+// The log line of a reading
+#define READING_FORMAT "%s/%s: Value was %s, filtered %s (confidence %.2f%s)"
+
+enum Scenario
+{
+    SCENARIO_DIRECT,   // syslog() and printf() on every call, as before the Logger
+    SCENARIO_QUEUED,   // Through the Logger, every call queued for the writer
+    SCENARIO_LIMITED,  // Through the Logger, one call site over its rate limit
+    SCENARIO_FILTERED, // Through the Logger, below the log level
+    NUM_SCENARIOS
+};
+static const char *scenario_names[NUM_SCENARIOS] = {"direct", "queued", "rate limited", "below level"};
+
+struct Options
+{
+    unsigned int lines;
+    unsigned int burst;
+    unsigned int burst_interval_ms;
+    unsigned int loops;
+    const char *output;
+};
+
+static void Usage(const char *name)
+{
+    fprintf(
+        stderr,
+        "Usage: %s [-n lines] [-b burst] [-i interval] [-l loops] [-o file]\n"
+        "  -n  Lines logged by the direct and queued scenarios (default 2000)\n"
+        "  -b  Lines logged back to back in those scenarios (default 16)\n"
+        "  -i  Time (ms) between the bursts, for the writer to keep up (default 50)\n"
+        "  -l  Calls of the rate limited and below level scenarios (default 1000000)\n"
+        "  -o  File that receives the log lines written to stdout (default /dev/null)\n",
+        name);
+}
+
+static double CpuUs()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return 1e6 * (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) + usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+}
+
+static void LogReading(const Scenario scenario, const char *value)
+{
+    const auto confidence = 0.9;
+    const auto rejected = "";
+    switch (scenario)
+    {
+    case SCENARIO_DIRECT:
+        // The LOG macro before the Logger
+        syslog(LOG_INFO, READING_FORMAT, __FILE__, __FUNCTION__, value, value, confidence, rejected);
+        printf(READING_FORMAT, __FILE__, __FUNCTION__, value, value, confidence, rejected);
+        printf("\n");
+        break;
+    case SCENARIO_QUEUED:
+    {
+        // A call site that is never over its rate limit
+        LogSite site = {};
+        Logger::Write(LOG_INFO, site, READING_FORMAT, __FILE__, __FUNCTION__, value, value, confidence, rejected);
+        break;
+    }
+    default:
+        LOG_I(READING_FORMAT, __FILE__, __FUNCTION__, value, value, confidence, rejected);
+        break;
+    }
+}
+
+static void Run(const Scenario scenario, const Options &options)
+{
+    const auto paced = SCENARIO_DIRECT == scenario || SCENARIO_QUEUED == scenario;
+    const auto calls = paced ? options.lines : options.loops;
+    Logger::SetLevel(SCENARIO_FILTERED == scenario ? LOG_ERR : LOG_INFO);
+    vector<double> call_ns;
+    call_ns.reserve(calls);
+    // The values are formatted by the application before it logs them
+    vector<string> values;
+    for (auto i = 0; i < 100; i++)
+    {
+        values.push_back(to_string(40 + i / 10.0));
+    }
+
+    const auto cpu_start = CpuUs();
+    for (auto line = 0U; line < calls; line++)
+    {
+        const auto start = chrono::steady_clock::now();
+        LogReading(scenario, values[line % values.size()].c_str());
+        call_ns.push_back(chrono::duration<double, nano>(chrono::steady_clock::now() - start).count());
+        if (paced && 0 == (line + 1) % options.burst)
+        {
+            usleep(1000 * options.burst_interval_ms);
+        }
+    }
+    if (SCENARIO_DIRECT == scenario)
+    {
+        fflush(stdout);
+    }
+    else
+    {
+        // Let the writer flush what was queued, which is part of the cost
+        usleep(1000 * 2 * options.burst_interval_ms + 200000);
+    }
+    const auto cpu_us = CpuUs() - cpu_start;
+
+    double total_ns = 0;
+    for (const auto ns : call_ns)
+    {
+        total_ns += ns;
+    }
+    sort(call_ns.begin(), call_ns.end());
+    fprintf(
+        stderr,
+        "%-14s %9u %10.0f %10.0f %10.0f %12.0f\n",
+        scenario_names[scenario],
+        calls,
+        total_ns / calls,
+        call_ns[call_ns.size() / 2],
+        call_ns[call_ns.size() * 99 / 100],
+        1000 * cpu_us / calls);
+}
+
+int main(int argc, char *argv[])
+{
+    Options options = {2000, 16, 50, 1000000, "/dev/null"};
+    int opt;
+    while (-1 != (opt = getopt(argc, argv, "n:b:i:l:o:h")))
+    {
+        switch (opt)
+        {
+        case 'n':
+            options.lines = atoi(optarg);
+            break;
+        case 'b':
+            options.burst = atoi(optarg);
+            break;
+        case 'i':
+            options.burst_interval_ms = atoi(optarg);
+            break;
+        case 'l':
+            options.loops = atoi(optarg);
+            break;
+        case 'o':
+            options.output = optarg;
+            break;
+        default:
+            Usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (0 == options.lines || 0 == options.burst || 0 == options.loops)
+    {
+        Usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    // The log lines go to stdout, so the report goes to stderr
+    const auto fd = open(options.output, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (0 > fd || 0 > dup2(fd, STDOUT_FILENO))
+    {
+        fprintf(stderr, "Failed to open %s\n", options.output);
+        return EXIT_FAILURE;
+    }
+    close(fd);
+    if (0 != access("/dev/log", W_OK))
+    {
+        fprintf(stderr, "No syslog daemon at /dev/log, syslog() costs less than on the camera\n");
+    }
+
+    openlog("logbench", LOG_PID, LOG_USER);
+    fprintf(
+        stderr,
+        "%-14s %9s %10s %10s %10s %12s\n",
+        "",
+        "calls",
+        "mean ns",
+        "p50 ns",
+        "p99 ns",
+        "cpu ns/call");
+    Run(SCENARIO_DIRECT, options);
+    Logger::Start();
+    for (auto scenario = SCENARIO_QUEUED; NUM_SCENARIOS > scenario; scenario = static_cast<Scenario>(scenario + 1))
+    {
+        Run(scenario, options);
+    }
+    Logger::Stop();
+    closelog();
+
+    return EXIT_SUCCESS;
+}